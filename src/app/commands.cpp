@@ -79,11 +79,11 @@ public:
     virtual QString iconName() const override	{ return (QString()); }
 
 private:
-    static int containerCounter;
+    static QAtomicInt containerCounter;
 };
 
 
-int ItemContainer::containerCounter = 0;
+QAtomicInt ItemContainer::containerCounter(0);
 
 
 ItemContainer::ItemContainer()
@@ -178,7 +178,9 @@ void ImportFileCommand::redo()
         while (mImportData->childCount()>0)
         {
             TrackDataItem *tdi = mImportData->takeFirstChildItem();
-            if (tdi!=nullptr) root->addChildItem(tdi);
+            if (tdi==nullptr) continue;
+            root->addChildItem(tdi);
+            model()->addedItem(tdi);
         }
 
         model()->endLayoutChange();
@@ -208,6 +210,7 @@ void ImportFileCommand::undo()
         {						// remove each from model
             TrackDataItem *item = root->takeLastChildItem();
             if (item==nullptr) continue;		// and re-add to saved file item
+            model()->removedItem(item);
             mImportData->addChildItem(item, 0);		// in the original order
         }
 
@@ -353,7 +356,7 @@ void SplitSegmentCommand::redo()
     controller()->view()->clearSelection();
     model()->startLayoutChange();
 
-    TrackDataAbstractPoint *splitPoint = dynamic_cast<TrackDataAbstractPoint *>(mParentSegment->childAt(mSplitIndex));
+    TrackDataAbstractPoint *splitPoint = TrackData::cast<TrackDataAbstractPoint>(mParentSegment->childAt(mSplitIndex));
     Q_ASSERT(splitPoint!=nullptr);
 
     if (mNewSegmentContainer==nullptr)
@@ -363,12 +366,12 @@ void SplitSegmentCommand::redo()
         TrackDataItem *copySegment;
         TrackDataAbstractPoint *copyPoint;
 
-        if (dynamic_cast<TrackDataTrackpoint *>(splitPoint)!=nullptr)
+        if (TrackData::cast<TrackDataTrackpoint>(splitPoint)!=nullptr)
         {
             copySegment = new TrackDataSegment;
             copyPoint = new TrackDataTrackpoint;
         }
-        else if (dynamic_cast<TrackDataRoutepoint *>(splitPoint)!=nullptr)
+        else if (TrackData::cast<TrackDataRoutepoint>(splitPoint)!=nullptr)
         {
             copySegment = new TrackDataRoute;
             copyPoint = new TrackDataRoutepoint;
@@ -405,6 +408,7 @@ void SplitSegmentCommand::redo()
     Q_ASSERT(parentItem!=nullptr);
     qDebug() << "add" << newSegment->name() << "to" << parentItem->name() << "as index" << parentIndex;
     parentItem->addChildItem(newSegment, parentIndex);
+    model()->addedItem(newSegment->childAt(0));		// only the copied split point is new
 
     model()->endLayoutChange();
     controller()->view()->selectItem(mParentSegment);
@@ -444,6 +448,7 @@ void SplitSegmentCommand::undo()
     // Remove and reclaim the now (effectively) empty source item
     qDebug() << "remove" << newSegment->name() << "from" << parentItem->name();
     parentItem->removeChildItem(newSegment);
+    model()->removedItem(newSegment);			// only the copied split point
     mNewSegmentContainer->addChildItem(newSegment);
     Q_ASSERT(mNewSegmentContainer->childCount()==1);
 
@@ -653,7 +658,7 @@ void AddContainerCommand::redo()
 
         Q_ASSERT(addedItem!=nullptr);
         if (!mAddName.isEmpty()) addedItem->setName(mAddName, true);
-        addedItem->setMetadata("creator", QApplication::applicationDisplayName());
+        addedItem->setMetadata(DataIndexer::IndexCreator, QApplication::applicationDisplayName());
 
         qDebug() << "created" << addedItem->name();
         mNewItemContainer->addChildItem(addedItem);
@@ -711,7 +716,7 @@ AddTrackpointCommand::~AddTrackpointCommand()
 
 void AddTrackpointCommand::setData(TrackDataItem *item)
 {
-    mAtPoint = dynamic_cast<TrackDataTrackpoint *>(item);
+    mAtPoint = TrackData::cast<TrackDataTrackpoint>(item);
     Q_ASSERT(mAtPoint!=nullptr);
 }
 
@@ -734,7 +739,7 @@ void AddTrackpointCommand::redo()
 
         const int idx = parent->childIndex(mAtPoint);
         Q_ASSERT(idx>0);				// not allowed at first point
-        const TrackDataTrackpoint *prevPoint = dynamic_cast<const TrackDataTrackpoint *>(parent->childAt(idx-1));
+        const TrackDataTrackpoint *prevPoint = TrackData::cast<TrackDataTrackpoint>(parent->childAt(idx-1));
         Q_ASSERT(prevPoint!=nullptr);
 
         double lat = (mAtPoint->latitude()+prevPoint->latitude())/2;
@@ -748,6 +753,7 @@ void AddTrackpointCommand::redo()
     Q_ASSERT(mNewPointContainer->childCount()==1);
     TrackDataItem *newPoint = mNewPointContainer->takeFirstChildItem();
     parent->addChildItem(newPoint, parent->childIndex(mAtPoint));
+    model()->addedItem(newPoint);
 
     model()->endLayoutChange();
     controller()->view()->selectItem(newPoint);
@@ -770,6 +776,7 @@ void AddTrackpointCommand::undo()
 
     TrackDataItem *newPoint = parent->childAt(idx-1);	// the one we added
     parent->removeChildItem(newPoint);
+    model()->removedItem(newPoint);
     mNewPointContainer->addChildItem(newPoint);
     Q_ASSERT(mNewPointContainer->childCount()==1);
 
@@ -992,6 +999,7 @@ void DeleteItemsCommand::redo()
         mParentIndexes[i] = parent->childIndex(item);
 
         parent->removeChildItem(item);
+        model()->removedItem(item);
         mDeletedItemsContainer->addChildItem(item);
     }
 
@@ -1015,6 +1023,7 @@ void DeleteItemsCommand::undo()
         TrackDataItem *item = mDeletedItemsContainer->takeLastChildItem();
         TrackDataItem *parent = mParentItems[i];
         parent->addChildItem(item, mParentIndexes[i]);
+        model()->addedItem(item);
 
         controller()->view()->selectItem(item, true);
     }
@@ -1047,7 +1056,7 @@ void MovePointsCommand::redo()
     Q_ASSERT(!mItems.isEmpty());
     for (int i = 0; i<mItems.count(); ++i)
     {
-        TrackDataAbstractPoint *item = dynamic_cast<TrackDataAbstractPoint *>(mItems[i]);
+        TrackDataAbstractPoint *item = TrackData::cast<TrackDataAbstractPoint>(mItems[i]);
         if (item==nullptr) continue;
         item->setLatLong(item->latitude()+mLatOff, item->longitude()+mLonOff);
         model()->changedItem(item);
@@ -1062,7 +1071,7 @@ void MovePointsCommand::undo()
     Q_ASSERT(!mItems.isEmpty());
     for (int i = 0; i<mItems.count(); ++i)
     {
-        TrackDataAbstractPoint *item = dynamic_cast<TrackDataAbstractPoint *>(mItems[i]);
+        TrackDataAbstractPoint *item = TrackData::cast<TrackDataAbstractPoint>(mItems[i]);
         if (item==nullptr) continue;
         item->setLatLong(item->latitude()-mLatOff, item->longitude()-mLonOff);
         model()->changedItem(item);
@@ -1123,19 +1132,19 @@ void AddWaypointCommand::redo()
         newWaypoint->setLatLong(mLatitude, mLongitude);
         if (mSourcePoint!=nullptr)
         {
-            int idx = DataIndexer::index("ele");
+            int idx = DataIndexer::IndexEle;
             newWaypoint->setMetadata(idx, mSourcePoint->metadata(idx));
-            idx = DataIndexer::index("time");
+            idx = DataIndexer::IndexTime;
             newWaypoint->setMetadata(idx, mSourcePoint->metadata(idx));
 
             // Only set the source metadata if the mSourcePoint point has
             // a name.  See StopDetectDialogue::slotCommitResults() for the
             // situation where it may not.
             const QString sourceName = mSourcePoint->name();
-            if (!sourceName.isEmpty()) newWaypoint->setMetadata("source", sourceName);
+            if (!sourceName.isEmpty()) newWaypoint->setMetadata(DataIndexer::IndexSource, sourceName);
 
-            const QVariant stopData = mSourcePoint->metadata("stop");
-            if (!stopData.isNull()) newWaypoint->setMetadata("stop", stopData);
+            const QVariant stopData = mSourcePoint->metadata(DataIndexer::IndexStop);
+            if (!stopData.isNull()) newWaypoint->setMetadata(DataIndexer::IndexStop, stopData);
         }
 
         mNewWaypointContainer->addChildItem(newWaypoint);
@@ -1144,6 +1153,7 @@ void AddWaypointCommand::redo()
     Q_ASSERT(mNewWaypointContainer->childCount()==1);
     TrackDataItem *newPoint = mNewWaypointContainer->takeFirstChildItem();
     mWaypointFolder->addChildItem(newPoint);
+    model()->addedItem(newPoint);
 
     model()->endLayoutChange();
     controller()->view()->selectItem(newPoint);
@@ -1161,6 +1171,7 @@ void AddWaypointCommand::undo()
     model()->startLayoutChange();
 
     TrackDataItem *newPoint = mWaypointFolder->takeLastChildItem();
+    model()->removedItem(newPoint);
     mNewWaypointContainer->addChildItem(newPoint);
     Q_ASSERT(mNewWaypointContainer->childCount()==1);
 
@@ -1219,7 +1230,7 @@ void AddRoutepointCommand::redo()
         TrackDataRoutepoint *newRoutepoint = new TrackDataRoutepoint;
         if (!mRoutepointName.isEmpty()) newRoutepoint->setName(mRoutepointName, true);
         newRoutepoint->setLatLong(mLatitude, mLongitude);
-        if (mSourcePoint!=nullptr) newRoutepoint->setMetadata("source", mSourcePoint->name());
+        if (mSourcePoint!=nullptr) newRoutepoint->setMetadata(DataIndexer::IndexSource, mSourcePoint->name());
 
         mNewRoutepointContainer->addChildItem(newRoutepoint);
     }
@@ -1227,6 +1238,7 @@ void AddRoutepointCommand::redo()
     Q_ASSERT(mNewRoutepointContainer->childCount()==1);
     TrackDataItem *newPoint = mNewRoutepointContainer->takeFirstChildItem();
     mRoutepointRoute->addChildItem(newPoint);
+    model()->addedItem(newPoint);
 
     model()->endLayoutChange();
     controller()->view()->selectItem(newPoint);
@@ -1244,6 +1256,7 @@ void AddRoutepointCommand::undo()
     model()->startLayoutChange();
 
     TrackDataItem *newPoint = mRoutepointRoute->takeLastChildItem();
+    model()->removedItem(newPoint);
     mNewRoutepointContainer->addChildItem(newPoint);
     Q_ASSERT(mNewRoutepointContainer->childCount()==1);
 
@@ -1271,10 +1284,10 @@ void AddPhotoCommand::redo()
 
     AddWaypointCommand::redo();				// add the basic waypoint
 
-    TrackDataWaypoint *tdw = dynamic_cast<TrackDataWaypoint *>(mWaypointFolder->childAt(mWaypointFolder->childCount()-1));
+    TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(mWaypointFolder->childAt(mWaypointFolder->childCount()-1));
     Q_ASSERT(tdw!=nullptr);				// retrieve the just added point
-    if (mLinkUrl.isValid()) tdw->setMetadata("link", mLinkUrl.toDisplayString());
-    if (mDateTime.isValid()) tdw->setMetadata("time", mDateTime);
+    if (mLinkUrl.isValid()) tdw->setMetadata(DataIndexer::IndexLink, mLinkUrl.toDisplayString());
+    if (mDateTime.isValid()) tdw->setMetadata(DataIndexer::IndexTime, mDateTime);
 }
 
 
@@ -36,6 +36,13 @@
 #include <qmimetype.h>
 #include <qmimedatabase.h>
 #include <qtimer.h>
+#include <qfileinfo.h>
+#include <qprogressdialog.h>
+#include <qeventloop.h>
+#include <qhash.h>
+#include <qfuturewatcher.h>
+#include <qtconcurrentmap.h>
+#include <qtconcurrentrun.h>
 #ifdef HAVE_KEXIV2
 #include <qtimezone.h>
 #endif
@@ -56,6 +63,10 @@ using namespace KExiv2Iface;
 #include "commands.h"
 #include "gpximporter.h"
 #include "gpxexporter.h"
+#include "snapshotimporter.h"
+#include "snapshotexporter.h"
+#include "nmeaimporter.h"
+#include "csvimporter.h"
 #include "mainwindow.h"
 #include "trackpropertiesdialogue.h"
 #include "moveitemdialogue.h"
@@ -66,6 +77,7 @@ using namespace KExiv2Iface;
 #include "settings.h"
 #include "metadatamodel.h"
 #include "dataindexer.h"
+#include "timeindex.h"
 
 #define GROUP_FILES		"Files"
 
@@ -291,28 +303,44 @@ case ErrorReporter::Fatal:
 }
 
 
-FilesController::Status FilesController::importFile(const QUrl &importFrom)
+// Create an importer for the format of a file, as indicated by its
+// file name.  Returns null if the format is not recognised.
+static ImporterBase *createImporter(const QUrl &importFrom, QString *typeRet)
 {
-    if (!importFrom.isValid()) return (FilesController::StatusFailed);
+    // A compressed file is imported according to the type of the
+    // file that it contains, which is indicated by the suffix before
+    // the compression suffix.  The importer will decompress it.
+    QString fileName = importFrom.fileName();
+    const QString compSuffix = ImporterBase::compressedSuffix(fileName);
+    if (!compSuffix.isEmpty()) fileName.chop(compSuffix.length()+1);
 
     QMimeDatabase db;
-    QString importType = db.suffixForFileName(importFrom.path());
+    QString importType = db.suffixForFileName(fileName);
     if (importType.isEmpty())
     {
-        QString fileName = importFrom.fileName();
         int i = fileName.lastIndexOf('.');
         if (i>0) importType = fileName.mid(i+1);
     }
 
     importType = importType.toUpper();
     qDebug() << "from" << importFrom << "type" << importType;
+    if (typeRet!=nullptr) *typeRet = importType;
+
+    if (importType=="GPX") return (new GpxImporter);	// import from GPX file
+    if (importType=="UMBRAIL") return (new SnapshotImporter);
+							// import from snapshot
+    if (importType=="NMEA") return (new NmeaImporter);	// import from NMEA log
+    if (importType=="CSV") return (new CsvImporter);	// import from CSV log
+    return (nullptr);
+}
 
-    QScopedPointer<ImporterBase> imp;			// importer for requested format
-    if (importType=="GPX")				// import from GPX file
-    {
-        imp.reset(new GpxImporter);
-    }
 
+FilesController::Status FilesController::importFile(const QUrl &importFrom)
+{
+    if (!importFrom.isValid()) return (FilesController::StatusFailed);
+
+    QString importType;
+    QScopedPointer<ImporterBase> imp(createImporter(importFrom, &importType));
     if (imp.isNull())					// could not create importer
     {
         qDebug() << "Unknown import format" << importType;
@@ -321,7 +349,19 @@ FilesController::Status FilesController::importFile(const QUrl &importFrom)
     }
 
     emit statusMessage(i18n("Loading %1 from <filename>%2</filename>...", importType, importFrom.toDisplayString()));
-    TrackDataFile *tdf = imp->load(importFrom);		// do the import
+
+    // Remote files need to be fetched using KIO, which can only be
+    // done from the GUI thread.  Local files are loaded in the background.
+    TrackDataFile *tdf;
+    if (importFrom.isLocalFile() && importFrom.host().isEmpty()) tdf = loadInBackground(importFrom, imp.data());
+    else tdf = imp->load(importFrom);			// do the import
+
+    if (imp->isCancelled())				// load was cancelled
+    {
+        delete tdf;					// in case it finished anyway
+        emit statusMessage(xi18nc("@info", "Loading <filename>%1</filename> cancelled", importFrom.toDisplayString()));
+        return (FilesController::StatusCancelled);
+    }
 
     const ErrorReporter *rep = imp->reporter();
     if (!reportFileError(false, importFrom, rep))
@@ -331,6 +371,151 @@ FilesController::Status FilesController::importFile(const QUrl &importFrom)
     }
 
     Q_ASSERT(tdf!=nullptr);
+    addImportedFile(importFrom, tdf);			// takes ownership of tree
+
+    if (imp->needsResave() && !fileWarningIgnored(importFrom, "warnings")) return (FilesController::StatusResave);
+    return (FilesController::StatusOk);
+}
+
+
+// Load a local file in a worker thread, showing a progress dialogue
+// which allows the load to be cancelled.  While the load is in progress,
+// completed tracks and routes are added to the model so that they can
+// be seen straight away.  When it has finished they are taken back out
+// again and returned as part of the loaded data, so that it can then be
+// added to the model (and undone) in exactly the same way as if it had
+// been loaded directly.  This all happens without returning to the event
+// loop, so the items do not visibly disappear and reappear.
+//
+// Completed segments of a track that is still being loaded are shown
+// as well, so that a file containing only one long track does not
+// appear empty until the end.  The track itself cannot be shown while
+// the worker thread is still adding to it, so they are added to a
+// placeholder track created here with the same name.  When the real
+// track is completed the placeholder continues to stand in for it.
+//
+// The progress dialogue is window modal, so the user cannot change the
+// model while the load is in progress.  It must be shown straight away,
+// not after the usual QProgressDialog delay, because otherwise the event
+// loop would process user input (for example, an undo) while items are
+// already being shown in the model.
+
+TrackDataFile *FilesController::loadInBackground(const QUrl &importFrom, ImporterBase *imp)
+{
+    imp->setIncremental(true);
+
+    QProgressDialog progress(xi18nc("@info", "Loading <filename>%1</filename>...", importFrom.fileName()),
+                             i18n("Cancel"), 0, 1000, mainWidget());
+    progress.setWindowTitle(i18n("Import File"));
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    progress.show();
+
+    QList<TrackDataItem *> shownItems;			// items added to root so far
+    QList<TrackDataItem *> takenItems;			// all completed items taken
+    QHash<const TrackDataItem *, TrackDataTrack *> placeholders;
+    TrackDataFile *tempRoot = nullptr;			// root created for them
+
+    auto showCompleted = [&]()
+    {
+        progress.setValue(imp->progress());
+        const QVector<ImporterBase::CompletedItem> items = imp->takeCompletedItems();
+        if (items.isEmpty()) return;			// nothing new to show
+
+        TrackDataFile *root = model()->rootFileItem();
+        const bool newRoot = (root==nullptr);		// no data in model yet
+        if (newRoot)
+        {
+            tempRoot = new TrackDataFile;		// temporary root to show them
+            tempRoot->setFileName(importFrom);
+            root = tempRoot;
+        }
+        else model()->startLayoutChange();
+
+        for (const ImporterBase::CompletedItem &ci : items)
+        {
+            takenItems.append(ci.item);
+            if (ci.parent!=nullptr)			// segment of unfinished track
+            {
+                TrackDataTrack *holder = placeholders.value(ci.parent);
+                if (holder==nullptr)			// first segment of that track
+                {
+                    holder = new TrackDataTrack;
+                    holder->setName(ci.parentName, true);
+                    root->addChildItem(holder);
+                    shownItems.append(holder);
+                    placeholders.insert(ci.parent, holder);
+                }
+                holder->addChildItem(ci.item);
+            }
+            else if (!placeholders.contains(ci.item))	// not already standing in
+            {
+                root->addChildItem(ci.item);
+                shownItems.append(ci.item);
+            }
+            else continue;				// nothing new to show
+
+            if (!newRoot) model()->addedItem(ci.item);
+        }
+
+        if (newRoot) model()->setRootFileItem(tempRoot);
+        else model()->endLayoutChange();
+        doUpdateMap();
+    };
+
+    QFutureWatcher<TrackDataFile *> watcher;
+    QEventLoop loop;
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, this, showCompleted);
+    connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+    connect(&progress, &QProgressDialog::canceled, this, [imp]() { imp->cancel(); });
+
+    watcher.setFuture(QtConcurrent::run(imp, &ImporterBase::load, importFrom));
+    timer.start(200);
+    if (!watcher.isFinished()) loop.exec();
+    timer.stop();
+    progress.reset();
+
+    TrackDataFile *tdf = watcher.result();		// now finished loading
+    const QVector<ImporterBase::CompletedItem> notShown = imp->takeCompletedItems();
+
+    if (!shownItems.isEmpty())				// take back items shown
+    {
+        if (tempRoot!=nullptr)				// remove temporary root
+        {
+            TrackDataFile *root = model()->takeRootFileItem();
+            Q_ASSERT(root==tempRoot);
+            while (root->childCount()>0) root->takeFirstChildItem();
+            delete root;
+        }
+        else						// remove from existing root
+        {
+            TrackDataFile *root = model()->rootFileItem();
+            model()->startLayoutChange();
+            for (int i = 0; i<shownItems.count(); ++i) model()->removedItem(root->takeLastChildItem());
+            model()->endLayoutChange();
+        }
+    }
+
+    for (TrackDataTrack *holder : qAsConst(placeholders))
+    {							// segments are not ours now
+        while (holder->childCount()>0) holder->takeFirstChildItem();
+        delete holder;
+    }
+
+    if (tdf!=nullptr) imp->restoreCompletedItems();	// back into loaded data
+    else						// load failed or cancelled
+    {
+        qDeleteAll(takenItems);
+        for (const ImporterBase::CompletedItem &ci : notShown) delete ci.item;
+    }
+
+    return (tdf);
+}
+
+
+void FilesController::addImportedFile(const QUrl &importFrom, TrackDataFile *tdf)
+{
     ImportFileCommand *cmd = new ImportFileCommand(this);
     cmd->setText(i18n("Import"));
     cmd->setData(tdf);					// takes ownership of tree
@@ -348,9 +533,176 @@ FilesController::Status FilesController::importFile(const QUrl &importFrom)
     }
 
     emit modified();					// done, finished with importer
+}
 
-    if (imp->needsResave() && !fileWarningIgnored(importFrom, "warnings")) return (FilesController::StatusResave);
-    return (FilesController::StatusOk);
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Importing multiple files						//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// The state of a file being imported by importFiles().  The 'done' flag
+// is set by the worker thread when the import has finished, after which
+// the importer and data may be used by the GUI thread.
+
+struct ImportJob
+{
+    QUrl url;
+    ImporterBase *importer;
+    qint64 size;					// for overall progress
+    TrackDataFile *data;
+    QAtomicInt done;
+    bool merged;
+};
+
+
+// Called in a worker thread for each file.
+static void runImportJob(ImportJob *job)
+{
+    job->data = job->importer->load(job->url);
+    job->done.storeRelease(1);
+}
+
+
+FilesController::Status FilesController::importFiles(const QList<QUrl> &urls)
+{
+    if (urls.count()==1) return (importFile(urls.first()));
+							// nothing to parallelise
+    FilesController::Status result = FilesController::StatusOk;
+    QVector<ImportJob *> jobs;
+    QList<QUrl> remoteFiles;
+
+    for (const QUrl &url : urls)
+    {
+        if (!url.isValid()) continue;
+
+        // Remote files need to be fetched using KIO, which can only be
+        // done from the GUI thread.  They are imported individually after
+        // the local files.
+        if (!url.isLocalFile() || !url.host().isEmpty())
+        {
+            remoteFiles.append(url);
+            continue;
+        }
+
+        ImporterBase *imp = createImporter(url, nullptr);
+        if (imp==nullptr)				// could not create importer
+        {
+            reportFileError(false, url, i18n("Unknown import format"));
+            result = FilesController::StatusFailed;
+            continue;
+        }
+
+        ImportJob *job = new ImportJob;
+        job->url = url;
+        job->importer = imp;
+        job->size = qMax(QFileInfo(url.toLocalFile()).size(), Q_INT64_C(1));
+        job->data = nullptr;
+        job->merged = false;
+        jobs.append(job);
+    }
+
+    if (!jobs.isEmpty())
+    {
+        emit statusMessage(i18np("Loading %1 file...", "Loading %1 files...", jobs.count()));
+
+        // The progress dialogue must be shown straight away so that it
+        // blocks user input, because files are added to the model and
+        // the undo stack while the load is in progress.  See the comment
+        // for loadInBackground().
+        QProgressDialog progress(i18n("Loading files..."), i18n("Cancel"), 0, 1000, mainWidget());
+        progress.setWindowTitle(i18n("Import Files"));
+        progress.setWindowModality(Qt::WindowModal);
+        progress.setMinimumDuration(0);
+        progress.show();
+
+        // The overall progress is the proportion of the total size of
+        // all of the files that has been read so far, so that one large
+        // file does not leave it stuck while the others finish.
+        qint64 totalSize = 0;
+        for (const ImportJob *job : qAsConst(jobs)) totalSize += job->size;
+
+        // Add each file to the model, in order of completion, as soon as
+        // it has been loaded.  Errors are reported after all of the files
+        // have been loaded, so that the import is not held up.
+        auto mergeCompleted = [&]()
+        {
+            qint64 readSize = 0;
+            for (const ImportJob *job : qAsConst(jobs))
+            {
+                if (job->done.loadAcquire()) readSize += job->size;
+                else readSize += (job->size*job->importer->progress())/1000;
+            }
+            progress.setValue(int((readSize*1000)/totalSize));
+
+            for (ImportJob *job : qAsConst(jobs))
+            {
+                if (job->merged || !job->done.loadAcquire()) continue;
+                job->merged = true;
+                if (job->data==nullptr) continue;	// failed to load
+                if (job->importer->reporter()->severity()==ErrorReporter::Fatal) continue;
+                addImportedFile(job->url, job->data);
+                job->data = nullptr;			// now owned by model
+            }
+        };
+
+        QFutureWatcher<void> watcher;
+        QEventLoop loop;
+        QTimer timer;
+        connect(&timer, &QTimer::timeout, this, mergeCompleted);
+        connect(&watcher, &QFutureWatcherBase::progressValueChanged, this, mergeCompleted);
+        connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+        connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcherBase::cancel);
+        connect(&progress, &QProgressDialog::canceled, this, [&jobs]()
+        {
+            // Also stop any files that are already being loaded
+            for (ImportJob *job : qAsConst(jobs)) job->importer->cancel();
+        });
+
+        watcher.setFuture(QtConcurrent::map(jobs, &runImportJob));
+        timer.start(200);
+        if (!watcher.isFinished()) loop.exec();
+        timer.stop();
+        watcher.waitForFinished();			// in case cancelled
+        mergeCompleted();				// any remaining files
+        progress.reset();
+
+        // Files that were not started because the import was cancelled
+        // will not be done, and those that were will have been merged.
+        // Now report any errors for each file in turn.
+        bool cancelled = watcher.isCanceled();
+        for (ImportJob *job : qAsConst(jobs))
+        {
+            if (job->done.loadAcquire() && !job->importer->isCancelled())
+            {
+                if (!reportFileError(false, job->url, job->importer->reporter())) result = FilesController::StatusFailed;
+                else if (job->importer->needsResave() && !fileWarningIgnored(job->url, "warnings"))
+                {
+                    if (result==FilesController::StatusOk) result = FilesController::StatusResave;
+                }
+            }
+
+            delete job->data;				// only if not merged
+            delete job->importer;
+            delete job;
+        }
+
+        if (cancelled)
+        {
+            emit statusMessage(i18n("Loading files cancelled"));
+            return (FilesController::StatusCancelled);
+        }
+    }
+
+    for (const QUrl &url : qAsConst(remoteFiles))
+    {
+        const FilesController::Status status = importFile(url);
+        if (status==FilesController::StatusFailed) result = status;
+        else if (status==FilesController::StatusResave && result==FilesController::StatusOk) result = status;
+    }
+
+    return (result);
 }
 
 
@@ -403,6 +755,10 @@ FilesController::Status FilesController::exportFile(const QUrl &exportTo, const
     {
         exp.reset(new GpxExporter);
     }
+    else if (exportType=="UMBRAIL")			// save as snapshot
+    {
+        exp.reset(new SnapshotExporter);
+    }
 
     if (exp.isNull())					// could not create exporter
     {
@@ -498,33 +854,6 @@ FilesController::Status FilesController::exportFile(const QUrl &exportTo, const
 }
 
 
-static int closestDiff;
-static const TrackDataTrackpoint *closestPoint;
-
-
-static void findChildWithTime(const TrackDataItem *pnt, const QDateTime &dt)
-{
-    const TrackDataTrackpoint *p = dynamic_cast<const TrackDataTrackpoint *>(pnt);
-    if (p!=nullptr)
-    {
-        QDateTime pt = p->time();
-        const int diff = abs(dt.secsTo(pt));
-        //qDebug() << "  " << p->name() << pt << "diff" << diff;
-        if (diff<closestDiff)
-        {
-            //qDebug() << "  closest" << p->name() << "diff" << diff;
-            closestPoint = p;
-            closestDiff = diff;
-        }
-    }
-    else
-    {
-        const int cnt = pnt->childCount();
-        for (int i = 0; i<cnt; ++i) findChildWithTime(pnt->childAt(i), dt);
-    }
-}
-
-
 // true => time OK, false => needs conversion but can't
 bool FilesController::adjustTimeSpec(QDateTime &dt)
 {
@@ -638,9 +967,9 @@ FilesController::Status FilesController::importPhoto(const QList<QUrl> &urls)
         {
             if (dt.isValid() && Settings::photoUseTime())
             {
-                closestDiff = INT_MAX;
-                closestPoint = nullptr;
-                findChildWithTime(model()->rootFileItem(), dt);
+                qint64 diffMSecs = 0;
+                const TrackDataTrackpoint *closestPoint = model()->timeIndex()->nearest(dt.toMSecsSinceEpoch(), &diffMSecs);
+                const int closestDiff = static_cast<int>(qMin(diffMSecs/1000, qint64(INT_MAX)));
 
                 if (closestPoint!=nullptr && closestDiff<=Settings::photoTimeThreshold())
                 {
@@ -778,7 +1107,7 @@ case TrackData::Trackpoint: if (selCount==1) msg = i18n("Selected point '%1'", n
 case TrackData::Waypoint:   if (selCount==1)
                             {
                                 const QString wptStatus = TrackData::formattedWaypointStatus(
-                                    static_cast<TrackData::WaypointStatus>(tdi->metadata("status").toInt()), true);
+                                    static_cast<TrackData::WaypointStatus>(tdi->metadata(DataIndexer::IndexStatus).toInt()), true);
                                 if (!wptStatus.isEmpty()) msg = i18n("Selected waypoint '%1' (%2)", name, wptStatus);
                                 else msg = i18n("Selected waypoint '%1'", name);
                             }
@@ -868,7 +1197,7 @@ void FilesController::slotTrackProperties()
     // usual way.
     if (wasSettingTimeZone && isReadOnly())		// setting time zone only
     {
-        const int idx = DataIndexer::index("timezone");
+        const int idx = DataIndexer::IndexTimezone;
         const QVariant oldData = item->metadata(idx);
         const QVariant newData = model->data(idx);
         if (newData==oldData) return;			// time zone has not changed
@@ -881,7 +1210,7 @@ void FilesController::slotTrackProperties()
     }
 
     // Item name
-    const QString newItemName = model->data(DataIndexer::index("name")).toString();
+    const QString newItemName = model->data(DataIndexer::IndexName).toString();
     if (!newItemName.isEmpty() && newItemName!=item->name())
     {							// changing the name
         qDebug() << "name change" << item->name() << "->" << newItemName;
@@ -891,11 +1220,11 @@ void FilesController::slotTrackProperties()
     }
 
     // Point position
-    const QVariant &latData = model->data(DataIndexer::index("latitude"));
-    const QVariant &lonData = model->data(DataIndexer::index("longitude"));
+    const QVariant &latData = model->data(DataIndexer::IndexLatitude);
+    const QVariant &lonData = model->data(DataIndexer::IndexLongitude);
     if (!latData.isNull() && !lonData.isNull())		// if applies to this point
     {
-        TrackDataAbstractPoint *tdp = dynamic_cast<TrackDataAbstractPoint *>(item);
+        TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item);
         Q_ASSERT(tdp!=nullptr);
 
         const double newLat = latData.toDouble();
@@ -914,18 +1243,18 @@ void FilesController::slotTrackProperties()
     const int num = model->rowCount();			// same as DataIndexer::count()
     for (int idx = 0; idx<num; ++idx)
     {
-        const QByteArray name = DataIndexer::name(idx);
-        if (MetadataModel::isInternalTag(name)) continue;
+        if (MetadataModel::isInternalTag(idx)) continue;
 							// these handled specially above
         if (!model->isChanged(idx)) continue;		// data not changed in dialogue
         QVariant newData = model->data(idx);		// the new changed data
+        const QByteArray name = DataIndexer::name(idx);
 
-        if (name=="status")				// changing waypoint status
+        if (idx==DataIndexer::IndexStatus)		// changing waypoint status
         {						// ignore if "No change"
             const TrackData::WaypointStatus wptstatus = static_cast<TrackData::WaypointStatus>(newData.toInt());
             if (wptstatus==TrackData::StatusInvalid) continue;
         }
-        else if (name=="linecolor" || name=="pointcolor")
+        else if (idx==DataIndexer::IndexLinecolor || idx==DataIndexer::IndexPointcolor)
         {						// changing item colour
             // Alpha value encodes the inherit flag, see TrackItemStylePage
             QColor col = newData.value<QColor>();
@@ -936,7 +1265,7 @@ void FilesController::slotTrackProperties()
         ChangeItemDataCommand *cmd3 = new ChangeItemDataCommand(this, cmd);
         cmd3->setDataItems(items);
         // TODO: overload setData() to take an index
-        cmd3->setData(DataIndexer::name(idx), newData);
+        cmd3->setData(name, newData);
     }
 
     if (cmd->childCount()==0)				// anything to actually do?
@@ -996,9 +1325,9 @@ static bool compareSegmentTimes(const TrackDataItem *item1, const TrackDataItem
     if (item1->childCount()==0) return (true);		// empty always sorts first
     if (item2->childCount()==0) return (false);
 
-    const TrackDataAbstractPoint *pnt1 = dynamic_cast<TrackDataAbstractPoint *>(item1->childAt(0));
+    const TrackDataAbstractPoint *pnt1 = TrackData::cast<TrackDataAbstractPoint>(item1->childAt(0));
     Q_ASSERT(pnt1!=nullptr);
-    const TrackDataAbstractPoint *pnt2 = dynamic_cast<TrackDataAbstractPoint *>(item2->childAt(0));
+    const TrackDataAbstractPoint *pnt2 = TrackData::cast<TrackDataAbstractPoint>(item2->childAt(0));
     Q_ASSERT(pnt2!=nullptr);
 
     return (pnt1->time()<pnt2->time());
@@ -1019,7 +1348,7 @@ void FilesController::slotMergeSegments()
     QList<TrackDataItem *> items = view()->selectedItems();
     if (items.count()<2) return;
 
-    if (dynamic_cast<const TrackDataSegment *>(items.first())!=nullptr)
+    if (TrackData::cast<TrackDataSegment>(items.first())!=nullptr)
     {							// operating on segments
         std::sort(items.begin(), items.end(), &compareSegmentTimes);
 
@@ -1027,9 +1356,9 @@ void FilesController::slotMergeSegments()
         QDateTime prevEnd;
         for (int i = 0; i<items.count(); ++i)
         {
-            const TrackDataSegment *tds = dynamic_cast<const TrackDataSegment *>(items[i]);
-            const TrackDataTrackpoint *pnt1 = dynamic_cast<TrackDataTrackpoint *>(tds->childAt(0));
-            const TrackDataTrackpoint *pnt2 = dynamic_cast<TrackDataTrackpoint *>(tds->childAt(tds->childCount()-1));
+            const TrackDataSegment *tds = TrackData::cast<TrackDataSegment>(items[i]);
+            const TrackDataTrackpoint *pnt1 = TrackData::cast<TrackDataTrackpoint>(tds->childAt(0));
+            const TrackDataTrackpoint *pnt2 = TrackData::cast<TrackDataTrackpoint>(tds->childAt(tds->childCount()-1));
             qDebug() << "  " << tds->name() << "start" << pnt1->formattedTime() << "end" << pnt2->formattedTime();
 
             if (i>0 && pnt1->time()<prevEnd)		// check no time overlap
@@ -1063,9 +1392,9 @@ void FilesController::slotMoveItem()
     d.setSource(&items);
 
     QString capt;
-    if (dynamic_cast<const TrackDataSegment *>(item)!=nullptr) capt = i18nc("@title:window", "Move Segment");
-    else if (dynamic_cast<const TrackDataFolder *>(item)!=nullptr) capt = i18nc("@title:window", "Move Folder");
-    else if (dynamic_cast<const TrackDataWaypoint *>(item)!=nullptr) capt = i18nc("@title:window", "Move Waypoint");
+    if (TrackData::cast<TrackDataSegment>(item)!=nullptr) capt = i18nc("@title:window", "Move Segment");
+    else if (TrackData::cast<TrackDataFolder>(item)!=nullptr) capt = i18nc("@title:window", "Move Folder");
+    else if (TrackData::cast<TrackDataWaypoint>(item)!=nullptr) capt = i18nc("@title:window", "Move Waypoint");
     if (!capt.isEmpty()) d.setWindowTitle(capt);
 
     if (!d.exec()) return;
@@ -1083,7 +1412,7 @@ void FilesController::slotAddTrack()
     QList<TrackDataItem *> items = view()->selectedItems();
     if (items.count()!=1) return;
     TrackDataItem *pnt = items.first();			// parent item (must be file)
-    Q_ASSERT(dynamic_cast<TrackDataFile *>(pnt)!=nullptr);
+    Q_ASSERT(TrackData::cast<TrackDataFile>(pnt)!=nullptr);
 
     AddContainerCommand *cmd = new AddContainerCommand(this);
     cmd->setSenderText(sender());
@@ -1097,7 +1426,7 @@ void FilesController::slotAddRoute()
     QList<TrackDataItem *> items = view()->selectedItems();
     if (items.count()!=1) return;
     TrackDataItem *pnt = items.first();			// parent item (must be file)
-    Q_ASSERT(dynamic_cast<TrackDataFile *>(pnt)!=nullptr);
+    Q_ASSERT(TrackData::cast<TrackDataFile>(pnt)!=nullptr);
 
     AddContainerCommand *cmd = new AddContainerCommand(this);
     cmd->setSenderText(sender());
@@ -1111,7 +1440,7 @@ void FilesController::slotAddFolder()
     QList<TrackDataItem *> items = view()->selectedItems();
     if (items.count()!=1) return;
     TrackDataItem *pnt = items.first();			// parent item (file or folder)
-    Q_ASSERT(dynamic_cast<TrackDataFile *>(pnt)!=nullptr || dynamic_cast<TrackDataFolder *>(pnt)!=nullptr);
+    Q_ASSERT(TrackData::cast<TrackDataFile>(pnt)!=nullptr || TrackData::cast<TrackDataFolder>(pnt)!=nullptr);
 
     AddContainerCommand *cmd = new AddContainerCommand(this);
     cmd->setSenderText(sender());
@@ -1194,9 +1523,9 @@ void FilesController::slotAddWaypoint(qreal lat, qreal lon)
     const QList<TrackDataItem *> items = view()->selectedItems();
 
     const TrackDataItem *sel = (items.count()==1 ? items.first() : nullptr);
-    const TrackDataAbstractPoint *selPoint = dynamic_cast<const TrackDataAbstractPoint *>(sel);
-    const TrackDataFolder *selFolder = dynamic_cast<const TrackDataFolder *>(sel);
-    const TrackDataWaypoint *selWaypoint = dynamic_cast<const TrackDataWaypoint *>(sel);
+    const TrackDataAbstractPoint *selPoint = TrackData::cast<TrackDataAbstractPoint>(sel);
+    const TrackDataFolder *selFolder = TrackData::cast<TrackDataFolder>(sel);
+    const TrackDataWaypoint *selWaypoint = TrackData::cast<TrackDataWaypoint>(sel);
 
     // Select where the new waypoint is to be placed.  If a single
     // folder is selected, then add it to that folder.  Otherwise, if a
@@ -1204,7 +1533,7 @@ void FilesController::slotAddWaypoint(qreal lat, qreal lon)
     // Otherwise, allow the user to select where it is to go.
     if (selWaypoint!=nullptr)
     {
-        selFolder = dynamic_cast<const TrackDataFolder *>(sel->parent());
+        selFolder = TrackData::cast<TrackDataFolder>(sel->parent());
         selPoint = nullptr;			// don't want this as source
     }
     if (selFolder!=nullptr) d.setDestinationContainer(selFolder);
@@ -1219,7 +1548,7 @@ void FilesController::slotAddWaypoint(qreal lat, qreal lon)
 
     d.pointPosition(&lat, &lon);
     const QString name = d.pointName();
-    TrackDataFolder *destFolder = dynamic_cast<TrackDataFolder *>(d.selectedContainer());
+    TrackDataFolder *destFolder = TrackData::cast<TrackDataFolder>(d.selectedContainer());
     Q_ASSERT(destFolder!=nullptr);
 
     qDebug() << "create" << name << "in" << destFolder->name() << "at" << lat << lon;
@@ -1249,9 +1578,9 @@ void FilesController::slotAddRoutepoint(qreal lat, qreal lon)
     const QList<TrackDataItem *> items = view()->selectedItems();
 
     const TrackDataItem *sel = (items.count()==1 ? items.first() : nullptr);
-    const TrackDataAbstractPoint *selPoint = dynamic_cast<const TrackDataAbstractPoint *>(sel);
-    const TrackDataRoute *selRoute = dynamic_cast<const TrackDataRoute *>(sel);
-    const TrackDataRoutepoint *selRoutepoint = dynamic_cast<const TrackDataRoutepoint *>(sel);
+    const TrackDataAbstractPoint *selPoint = TrackData::cast<TrackDataAbstractPoint>(sel);
+    const TrackDataRoute *selRoute = TrackData::cast<TrackDataRoute>(sel);
+    const TrackDataRoutepoint *selRoutepoint = TrackData::cast<TrackDataRoutepoint>(sel);
 
     // Select where the new route point is to be placed.  If a single
     // route is selected, then add it to that route.  Otherwise, if a
@@ -1259,7 +1588,7 @@ void FilesController::slotAddRoutepoint(qreal lat, qreal lon)
     // Otherwise, allow the user to select where it is to go.
     if (selRoutepoint!=nullptr)
     {
-        selRoute = dynamic_cast<const TrackDataRoute *>(sel->parent());
+        selRoute = TrackData::cast<TrackDataRoute>(sel->parent());
         selPoint = nullptr;			// don't want this as source
     }
     if (selRoute!=nullptr) d.setDestinationContainer(selRoute);
@@ -1274,7 +1603,7 @@ void FilesController::slotAddRoutepoint(qreal lat, qreal lon)
 
     d.pointPosition(&lat, &lon);
     const QString name = d.pointName();
-    TrackDataRoute *destRoute = dynamic_cast<TrackDataRoute *>(d.selectedContainer());
+    TrackDataRoute *destRoute = TrackData::cast<TrackDataRoute>(d.selectedContainer());
     Q_ASSERT(destRoute!=nullptr);
 
     qDebug() << "create" << name << "in" << destRoute->name() << "at" << lat << lon;
@@ -1339,6 +1668,10 @@ QString FilesController::allImportFilters()
 {
     QStringList filters;
     filters << GpxImporter::filter();
+    filters << GpxImporter::compressedFilter();
+    filters << SnapshotImporter::filter();
+    filters << NmeaImporter::filter();
+    filters << CsvImporter::filter();
     filters << allFilter;
     return (filters.join(";;"));
 }
@@ -1348,6 +1681,7 @@ QString FilesController::allProjectFilters(bool includeAllFiles)
 {
     QStringList filters;
     filters << GpxImporter::filter();
+    filters << SnapshotImporter::filter();
     if (includeAllFiles) filters << allFilter;
     return (filters.join(";;"));
 }
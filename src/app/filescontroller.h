@@ -41,6 +41,7 @@ class FilesModel;
 class TrackDataFile;
 class ErrorReporter;
 class TrackDataItem;
+class ImporterBase;
 
 
 class DialogueConstraintFilter : public QObject
@@ -80,6 +81,7 @@ public:
     void saveProperties();
 
     FilesController::Status importFile(const QUrl &importFrom);
+    FilesController::Status importFiles(const QList<QUrl> &urls);
     FilesController::Status exportFile(const QUrl &exportTo, const TrackDataFile *tdf, ImporterExporterBase::Options options);
     FilesController::Status importPhoto(const QList<QUrl> &urls);
     void initNew();
@@ -123,6 +125,9 @@ private:
     static bool fileWarningIgnored(const QUrl &file, const QByteArray &type);
     static void setFileWarningIgnored(const QUrl &file, const QByteArray &type);
 
+    void addImportedFile(const QUrl &importFrom, TrackDataFile *tdf);
+    TrackDataFile *loadInBackground(const QUrl &importFrom, ImporterBase *imp);
+
     bool adjustTimeSpec(QDateTime &dt);
     FilesController::Status importPhotoInternal(const QUrl &importFrom, bool multiple);
 
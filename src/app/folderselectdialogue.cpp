@@ -102,8 +102,8 @@ void FolderSelectDialogue::slotNewFolder()
 void FolderSelectDialogue::slotUpdateButtonStates()
 {
     const TrackDataItem *item = selectedItem();
-    const bool isFolder = (dynamic_cast<const TrackDataFolder *>(item)!=nullptr);
-    const bool isFile = (dynamic_cast<const TrackDataFile *>(item)!=nullptr);
+    const bool isFolder = (TrackData::cast<TrackDataFolder>(item)!=nullptr);
+    const bool isFile = (TrackData::cast<TrackDataFile>(item)!=nullptr);
 
     setButtonEnabled(QDialogButtonBox::Ok, isFolder);
     setButtonEnabled(QDialogButtonBox::Yes, (isFolder || isFile) && !isReadOnly());
@@ -64,7 +64,7 @@ void FolderSelectWidget::slotSelectFolder()
     d.setPath(mDestFolder->text());
     if (!d.exec()) return;
 
-    const TrackDataFolder *selectedFolder = dynamic_cast<const TrackDataFolder *>(d.selectedItem());
+    const TrackDataFolder *selectedFolder = TrackData::cast<TrackDataFolder>(d.selectedItem());
     if (selectedFolder==nullptr) mDestFolder->clear();
     else mDestFolder->setText(selectedFolder->path());
 
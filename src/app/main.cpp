@@ -104,6 +104,7 @@ int main(int argc,char *argv[])
 
     parser.addPositionalArgument("file", i18n("File to load"), i18n("[file...]"));
     parser.addOption(QCommandLineOption((QStringList() << "r" << "readonly"), i18n("Open files as read-only.")));
+    parser.addOption(QCommandLineOption((QStringList() << "i" << "import"), i18n("Import all of the files into a single new window.")));
 
     aboutData.setupCommandLine(&parser);
     parser.process(app);
@@ -111,6 +112,7 @@ int main(int argc,char *argv[])
 
     MainWindow *w = nullptr;
     QStringList args = parser.positionalArguments();
+    QList<QUrl> importUrls;
     for (int i = 0; i<args.count(); ++i)		// load project or data files
     {
         // Parsing file arguments as URLs, as recommended at
@@ -122,12 +124,29 @@ int main(int argc,char *argv[])
             continue;
         }
 
+        if (parser.isSet("import"))			// collect files to import
+        {
+            importUrls.append(u);
+            continue;
+        }
+
         w = new MainWindow(nullptr);
         const bool ok = w->loadProject(u, parser.isSet("readonly"));
         if (!ok) w->deleteLater();
         else w->show();
     }
 
+    if (!importUrls.isEmpty())				// import files together
+    {							// (possibly in parallel)
+        w = new MainWindow(nullptr);
+        if (w->importFiles(importUrls)) w->show();
+        else
+        {
+            w->deleteLater();
+            w = nullptr;				// start with empty window
+        }
+    }
+
     if (w==nullptr)					// no project or file loaded
     {
         w = new MainWindow(nullptr);
@@ -597,11 +597,11 @@ bool MainWindow::save(const QUrl &to, ImporterExporterBase::Options options)
     if (tdf==nullptr) return (false);			// should never happen
 
     // metadata from map controller
-    tdf->setMetadata("position", mapController()->view()->currentPosition());
+    tdf->setMetadata(DataIndexer::IndexPosition, mapController()->view()->currentPosition());
 
     // metadata for save file
-    tdf->setMetadata("creator", QApplication::applicationDisplayName());
-    tdf->setMetadata("time", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    tdf->setMetadata(DataIndexer::IndexCreator, QApplication::applicationDisplayName());
+    tdf->setMetadata(DataIndexer::IndexTime, QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
 
     return (filesController()->exportFile(to, tdf, options)==FilesController::StatusOk);
 }
@@ -617,10 +617,18 @@ FilesController::Status MainWindow::load(const QUrl &from)
     FilesController::Status status = filesController()->importFile(from);
     if (status!=FilesController::StatusOk && status!=FilesController::StatusResave) return (status);
 
+    showLoadedData();
+    return (status);
+}
+
+
+// Show the newly loaded data on the map and in the tree view.
+void MainWindow::showLoadedData()
+{
     TrackDataFile *tdf = filesController()->model()->rootFileItem();
     if (tdf!=nullptr)
     {
-        QVariant s = tdf->metadata("position");
+        QVariant s = tdf->metadata(DataIndexer::IndexPosition);
         qDebug() << "pos metadata" << s;
         QSignalBlocker block(mapController()->view());	// no status bar update from zooming
         if (!s.isNull()) mapController()->view()->setCurrentPosition(s.toString());
@@ -632,7 +640,6 @@ FilesController::Status MainWindow::load(const QUrl &from)
     {
         QTimer::singleShot(0, filesController(), &FilesController::slotCheckTimeZone);
     }
-    return (status);
 }
 
 
@@ -679,6 +686,24 @@ void MainWindow::slotOpenProject()
 }
 
 
+// Import a number of data files into a new window, for example as given
+// on the command line.  Unlike loadProject() no file name is set, the
+// data is treated as a new project.
+bool MainWindow::importFiles(const QList<QUrl> &files)
+{
+    qDebug() << files.count() << "files";
+
+    FilesController::Status status = filesController()->importFiles(files);
+    if (filesController()->model()->isEmpty()) return (false);
+							// nothing was loaded
+    showLoadedData();
+    mUndoStack->clear();				// clear undo history
+    Q_UNUSED(status);					// errors already reported
+    slotSetModified(true);				// data not yet saved
+    return (true);
+}
+
+
 bool MainWindow::loadProject(const QUrl &loadFrom, bool readOnly)
 {
     if (!loadFrom.isValid()) return (false);
@@ -761,17 +786,17 @@ void MainWindow::slotSaveCopy()
 void MainWindow::slotImportFile()
 {
     RecentSaver saver("import");
-    QUrl file = QFileDialog::getOpenFileUrl(this,					// parent
-                                            i18n("Import File"),			// caption
-                                            saver.recentUrl(),				// dir
-                                            FilesController::allImportFilters(),	// filter
-                                            nullptr,					// selectedFilter,
-                                            QFileDialog::Options(),			// options
-                                            QStringList());				// supportedSchemes
+    QList<QUrl> files = QFileDialog::getOpenFileUrls(this,				// parent
+                                                     i18n("Import File"),		// caption
+                                                     saver.recentUrl(),			// dir
+                                                     FilesController::allImportFilters(),	// filter
+                                                     nullptr,				// selectedFilter,
+                                                     QFileDialog::Options(),		// options
+                                                     QStringList());			// supportedSchemes
 
-    if (!file.isValid()) return;			// didn't get a file name
-    saver.save(file);
-    filesController()->importFile(file);
+    if (files.isEmpty()) return;			// didn't get any file names
+    saver.save(files.first());
+    filesController()->importFiles(files);
 }
 
 
@@ -929,7 +954,7 @@ case TrackData::Waypoint:
 
         if (selCount==1)
         {
-            const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(filesController()->view()->selectedItem());
+            const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(filesController()->view()->selectedItem());
             if (tdw!=nullptr)
             {
                 switch (tdw->waypointType())
@@ -949,7 +974,7 @@ case TrackData::WaypointPhoto:		playEnabled = true;
 default:				break;
                 }
 
-                statusValue = tdw->metadata("status").toInt();
+                statusValue = tdw->metadata(DataIndexer::IndexStatus).toInt();
             }
         }
         break;
@@ -1122,7 +1147,7 @@ void MainWindow::slotTrackStatistics()
 // TODO: status messages from player
 void MainWindow::slotPlayMedia()
 {
-    const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(filesController()->view()->selectedItem());
+    const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(filesController()->view()->selectedItem());
     Q_ASSERT(tdw!=nullptr);
     switch (tdw->waypointType())
     {
@@ -1142,7 +1167,7 @@ default:				break;
 
 void MainWindow::slotOpenMedia()
 {
-    const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(filesController()->view()->selectedItem());
+    const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(filesController()->view()->selectedItem());
     Q_ASSERT(tdw!=nullptr);
     if (tdw->isMediaType()) MediaPlayer::openMediaFile(tdw);
 }
@@ -1150,7 +1175,7 @@ void MainWindow::slotOpenMedia()
 
 void MainWindow::slotSaveMedia()
 {
-    const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(filesController()->view()->selectedItem());
+    const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(filesController()->view()->selectedItem());
     Q_ASSERT(tdw!=nullptr);
     if (tdw->isMediaType()) MediaPlayer::saveMediaFile(tdw);
 }
@@ -64,6 +64,7 @@ public:
     virtual ~MainWindow();
 
     bool loadProject(const QUrl &loadFrom, bool readOnly = false);
+    bool importFiles(const QList<QUrl> &files);
 
 public slots:               
     void slotStatusMessage(const QString &text);
@@ -119,6 +120,7 @@ private:
 
     bool save(const QUrl &to, ImporterExporterBase::Options options);
     FilesController::Status load(const QUrl &from);
+    void showLoadedData();
 
     bool acceptMimeData(const QMimeData *mimeData);
 
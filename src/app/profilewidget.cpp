@@ -52,6 +52,8 @@
 #include "filesview.h"
 #include "filesmodel.h"
 #include "trackdata.h"
+#include "dataindexer.h"
+#include "pointindex.h"
 #include "variableunitcombo.h"
 #include "units.h"
 #include "elevationmanager.h"
@@ -141,12 +143,12 @@ void WaypointLayerable::setShowPoints(WaypointSelectDialogue::SelectionSet sel)
 
 bool WaypointLayerable::isShowingPoint(const TrackDataAbstractPoint *pnt) const
 {
-    if (dynamic_cast<const TrackDataRoutepoint *>(pnt)!=nullptr)
+    if (TrackData::cast<TrackDataRoutepoint>(pnt)!=nullptr)
     {							// is this a route point?
         return (mSelection & WaypointSelectDialogue::SelectRoutepoints);
     }
 
-    const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(pnt);
+    const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(pnt);
     if (tdw==nullptr) return (false);			// otherwise, should be a waypoint
 
     const TrackData::WaypointType type = tdw->waypointType();
@@ -253,7 +255,7 @@ ProfileWidget::ProfileWidget(QWidget *pnt)
 
     // See if the first of those is a route point.  If so, assume that all of them are
     // and the plot is in route mode (interpolated points, limited options).
-    const TrackDataRoutepoint *tdr = dynamic_cast<const TrackDataRoutepoint *>(mPoints.first());
+    const TrackDataRoutepoint *tdr = TrackData::cast<TrackDataRoutepoint>(mPoints.first());
     mRouteMode = (tdr!=nullptr);
     qDebug() << "route mode?" << mRouteMode;
 
@@ -266,7 +268,7 @@ ProfileWidget::ProfileWidget(QWidget *pnt)
 
     // Resolve the file time zone.
     mTimeZone = nullptr;
-    QVariant zoneName = filesController()->model()->rootFileItem()->metadata("timezone");
+    QVariant zoneName = filesController()->model()->rootFileItem()->metadata(DataIndexer::IndexTimezone);
     if (!zoneName.isNull())
     {
         QTimeZone *tz = new QTimeZone(zoneName.toByteArray());
@@ -429,7 +431,16 @@ ProfileWidget::ProfileWidget(QWidget *pnt)
     Q_ASSERT(waypointLayer!=nullptr);
     mWaypointLayerable = new WaypointLayerable(mPlot, "waypoints");
 							// only needs to be done once
-    associateWaypoints(filesController()->model()->rootFileItem());
+    {
+        // Index the plotted points, so that the closest one to each
+        // waypoint can be found quickly.
+        PointIndex index;
+        index.build(mPoints);
+        QHash<const TrackDataAbstractPoint *, int> pointRows;
+        pointRows.reserve(mPoints.count());
+        for (int i = mPoints.count()-1; i>=0; --i) pointRows.insert(mPoints.at(i), i);
+        associateWaypoints(filesController()->model()->rootFileItem(), &index, pointRows);
+    }
     qDebug() << "found" << mWaypoints.count() << "associated waypoints";
     mWaypointSelection = WaypointSelectDialogue::SelectWaypoints|WaypointSelectDialogue::SelectRoutepoints;
 
@@ -509,8 +520,23 @@ void ProfileWidget::getPlotData(const TrackDataAbstractPoint *point)
 
     if (mPrevPoint!=nullptr)
     {
-        distStep = mPrevPoint->distanceTo(point, true);	// distance travelled this step
-        timeStep = mPrevPoint->timeTo(point);		// time interval this step
+        // If the previous point is the one immediately before this in the
+        // same segment or route, then the step can be obtained from the
+        // cumulative values of the container.  Otherwise, for example
+        // between segments or for interpolated route points, calculate it.
+        const TrackDataItem *pnt = point->parent();
+        const PointColumns *cols = (mPrevPoint->parent()==pnt ? TrackData::pointColumns(pnt) : nullptr);
+        const int idx = (cols!=nullptr ? pnt->childIndex(point) : -1);
+        if (idx>0 && pnt->childAt(idx-1)==mPrevPoint)
+        {
+            distStep = cols->distanceBetween(idx-1, idx);
+            timeStep = cols->timeBetween(idx-1, idx);
+        }
+        else
+        {
+            distStep = mPrevPoint->distanceTo(point, true);	// distance travelled this step
+            timeStep = mPrevPoint->timeTo(point);	// time interval this step
+        }
     }
 
     mCumulativeTravel += Units::internalToLength(distStep, mDistanceUnit->unit());
@@ -585,14 +611,14 @@ void ProfileWidget::getPlotData(const TrackDataAbstractPoint *point)
     {
         if (mSpeedSource==SpeedSourceGPS)		// GPS speed
         {
-            // Get the speed from the track metadata.
-            const QVariant speedMeta = point->metadata("speed");
-            if (speedMeta.isNull()) spd = NAN;
+            // Get the speed as recorded in the track.
+            const double speedGps = point->speed();
+            if (ISNAN(speedGps)) spd = NAN;
             else
             {
                 // First convert the GPS speed (in metres/second, defined in
                 // the GPX specification) into internal units.
-                spd = Units::speedToInternal(speedMeta.toDouble(), Units::SpeedMetresSecond);
+                spd = Units::speedToInternal(speedGps, Units::SpeedMetresSecond);
                 // Then convert that speed back to the requested unit.
                 spd = Units::internalToSpeed(spd, mSpeedUnit->unit());
             }
@@ -728,12 +754,13 @@ void ProfileWidget::slotUpdatePlot()
 }
 
 
-void ProfileWidget::associateWaypoints(const TrackDataItem *item)
+void ProfileWidget::associateWaypoints(const TrackDataItem *item, const PointIndex *index,
+                                       const QHash<const TrackDataAbstractPoint *, int> &pointRows)
 {
     const TrackDataAbstractPoint *tdp = nullptr;
-    const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(item);
+    const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(item);
     if (tdw!=nullptr) tdp = tdw;
-    const TrackDataRoutepoint *tdr = dynamic_cast<const TrackDataRoutepoint *>(item);
+    const TrackDataRoutepoint *tdr = TrackData::cast<TrackDataRoutepoint>(item);
     if (tdr!=nullptr) tdp = tdr;
 
     if (tdp!=nullptr)
@@ -741,24 +768,8 @@ void ProfileWidget::associateWaypoints(const TrackDataItem *item)
 #ifdef DEBUG_WAYPOINTS
         qDebug() << "trying" << tdp->name();
 #endif
-        const TrackDataAbstractPoint *closestPoint = nullptr;
-        double closestDist = FLT_MAX;
-        // Should always get set because of the above,
-        // but initialise to avoid a compiler warning.
-        int closestIndex = -1;
-
-        for (int i = 0; i<mPoints.count(); ++i)
-        {
-            const TrackDataAbstractPoint *pnt = mPoints.at(i);
-            double dist = tdp->distanceTo(pnt);
-            if (dist<closestDist)			// closest approach so far?
-            {
-                closestPoint = pnt;
-                closestDist = dist;
-                closestIndex = i;
-            }
-        }
-
+        const TrackDataAbstractPoint *closestPoint = index->nearestPoint(tdp->latitude(), tdp->longitude(),
+                                                                      TrackData::None, ASSOCIATE_DISTANCE);
         if (closestPoint==nullptr)			// couldn't find anything
         {
 #ifdef DEBUG_WAYPOINTS
@@ -767,6 +778,8 @@ void ProfileWidget::associateWaypoints(const TrackDataItem *item)
         }
         else
         {
+            const double closestDist = tdp->distanceTo(closestPoint);
+            const int closestIndex = pointRows.value(closestPoint);
 #ifdef DEBUG_WAYPOINTS
             qDebug() << "  closest point" << closestPoint->name() << "dist" << closestDist;
 #endif
@@ -787,7 +800,7 @@ void ProfileWidget::associateWaypoints(const TrackDataItem *item)
         }
     }
 
-    for (int i = 0; i<item->childCount(); ++i) associateWaypoints(item->childAt(i));
+    for (int i = 0; i<item->childCount(); ++i) associateWaypoints(item->childAt(i), index, pointRows);
 }
 
 
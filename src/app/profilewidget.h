@@ -31,6 +31,7 @@
 
 #include <qvector.h>
 #include <qmap.h>
+#include <qhash.h>
 
 #include "applicationdatainterface.h"
 #include "waypointselectdialogue.h"
@@ -46,6 +47,7 @@ class KConfigGroup;
 
 class TrackDataItem;
 class TrackDataAbstractPoint;
+class PointIndex;
 class VariableUnitCombo;
 class ElevationTile;
 
@@ -74,7 +76,8 @@ private slots:
 
 private:
     void getPlotData(const TrackDataAbstractPoint *point);
-    void associateWaypoints(const TrackDataItem *item);
+    void associateWaypoints(const TrackDataItem *item, const PointIndex *index,
+                            const QHash<const TrackDataAbstractPoint *, int> &pointRows);
     void getRoutePoints();
 
 private:
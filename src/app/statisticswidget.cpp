@@ -41,6 +41,7 @@
 #include "filescontroller.h"
 #include "filesview.h"
 #include "trackdata.h"
+#include "dataindexer.h"
 
 
 StatisticsWidget::StatisticsWidget(QWidget *pnt)
@@ -133,7 +134,7 @@ void StatisticsWidget::addRow(const QString &text, int num, bool withPercent)
 
 void StatisticsWidget::getPointData(const TrackDataAbstractPoint *point)
 {
-    const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(point);
+    const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(point);
     if (tdp!=nullptr)					// is this a point?
     {
         ++mTotalPoints;					// count up total points
@@ -144,13 +145,10 @@ void StatisticsWidget::getPointData(const TrackDataAbstractPoint *point)
         const double ele = tdp->elevation();		// elevation available
         if (!ISNAN(ele) && ele!=0) ++mWithElevation;	// (and also nozero)
 
-        const QVariant speedMeta = tdp->metadata("speed");
-        if (!speedMeta.isNull()) ++mWithGpsSpeed;	// GPS speed recorded
+        if (!ISNAN(tdp->speed())) ++mWithGpsSpeed;	// GPS speed recorded
+        if (!ISNAN(tdp->hdop())) ++mWithGpsHdop;	// GPS HDOP recorded
 
-        const QVariant hdopMeta = tdp->metadata("hdop");
-        if (!hdopMeta.isNull()) ++mWithGpsHdop;		// GPS HDOP recorded
-
-        const QVariant headingMeta = tdp->metadata("heading");
+        const QVariant headingMeta = tdp->metadata(DataIndexer::IndexHeading);
         if (!headingMeta.isNull()) ++mWithGpsHeading;	// GPS heading recorded
     }
 }
@@ -51,6 +51,7 @@
 #include "filescontroller.h"
 #include "filesview.h"
 #include "filesmodel.h"
+#include "pointindex.h"
 #include "mapcontroller.h"
 #include "mapview.h"
 #include "trackdata.h"
@@ -92,7 +93,7 @@ StopDetectDialogue::StopDetectDialogue(QWidget *pnt)
     filesController()->view()->selectedPoints().swap(mInputPoints);
 
     mTimeZone = QTimeZone::utc();			// a sensible default
-    QString zoneName = filesController()->model()->rootFileItem()->metadata("timezone").toString();
+    QString zoneName = filesController()->model()->rootFileItem()->metadata(DataIndexer::IndexTimezone).toString();
     if (!zoneName.isEmpty())				// resolve from file time zone
     {
         QTimeZone tz(zoneName.toLatin1());
@@ -271,9 +272,9 @@ static void setStopData(TrackDataWaypoint *tdw, const QDateTime &dt, int dur)
                                      QString("%1:%2:%3").arg(hrs).arg(min, 2, 10, QLatin1Char('0')).arg(sec, 2, 10, QLatin1Char('0'));
 
     tdw->setName(i18n("Stop at %1 for %2", text1, text2), true);
-    tdw->setMetadata("time", dt);
-    tdw->setMetadata("duration", QVariant(dur));
-    tdw->setMetadata("stop", QString(text1+' '+text2));
+    tdw->setMetadata(DataIndexer::IndexTime, dt);
+    tdw->setMetadata(DataIndexer::IndexDuration, QVariant(dur));
+    tdw->setMetadata(DataIndexer::IndexStop, QString(text1+' '+text2));
 }
 
 
@@ -438,7 +439,13 @@ void StopDetectDialogue::slotDetectStops()
                 TrackDataWaypoint *tdw = new TrackDataWaypoint;
                 setStopData(tdw, dt1, dur);
                 tdw->setLatLong(runLat, runLon);	// want explicit name here
-                mResultPoints.append(tdw);
+
+                if (isCommittedStop(tdw, maxDist))	// already in data tree?
+                {
+                    qDebug() << "already committed";
+                    delete tdw;
+                }
+                else mResultPoints.append(tdw);
 
                 startIndex = currentIndex;		// start search again after stop
             }
@@ -456,6 +463,35 @@ void StopDetectDialogue::slotDetectStops()
 }
 
 
+// A stop detected again, for example with slightly different settings
+// or from a different selection of points, may already have been committed
+// as a waypoint.  Look for any existing stop waypoint with the same start
+// time and duration near to the new one.
+
+bool StopDetectDialogue::isCommittedStop(const TrackDataWaypoint *tdw, int maxDist) const
+{
+    const double lat = tdw->latitude();
+    const double lon = tdw->longitude();
+    const QVariant stopData = tdw->metadata(DataIndexer::IndexStop);
+
+    // The area to search, converted from the distance tolerance
+    const double dLat = RADIANS_TO_DEGREES(Units::lengthToInternal(maxDist, Units::LengthMetres));
+    const double dLon = dLat/qMax(cos(DEGREES_TO_RADIANS(lat)), 0.01);
+
+    const PointIndex *index = filesController()->model()->pointIndex();
+    const QVector<const TrackDataAbstractPoint *> points = index->pointsWithin(lat-dLat, lon-dLon,
+                                                                               lat+dLat, lon+dLon,
+                                                                               TrackData::Waypoint);
+    for (const TrackDataAbstractPoint *tdp : points)
+    {
+        if (tdp->metadata(DataIndexer::IndexStop)!=stopData) continue;
+        if (withinDistance(tdp, lat, lon, maxDist)) return (true);
+    }
+
+    return (false);
+}
+
+
 void StopDetectDialogue::slotMergeStops()
 {
     QList<QListWidgetItem *> items = mResultsList->selectedItems();
@@ -471,8 +507,8 @@ void StopDetectDialogue::slotMergeStops()
 
     double avgLat = firstPoint->latitude();
     double avgLon = firstPoint->longitude();
-    qint64 startTime = firstPoint->metadata("time").toDateTime().toSecsSinceEpoch();
-    qint64 endTime = startTime+firstPoint->metadata("duration").toInt();
+    qint64 startTime = firstPoint->metadata(DataIndexer::IndexTime).toDateTime().toSecsSinceEpoch();
+    qint64 endTime = startTime+firstPoint->metadata(DataIndexer::IndexDuration).toInt();
 
     for (int i = idx1+1; i<=idx2; ++i)
     {							// data for current point
@@ -481,8 +517,8 @@ void StopDetectDialogue::slotMergeStops()
 
         double thisLat = thisPoint->latitude();
         double thisLon = thisPoint->longitude();
-        qint64 thisStartTime = thisPoint->metadata("time").toDateTime().toSecsSinceEpoch();
-        qint64 thisEndTime = thisStartTime+thisPoint->metadata("duration").toInt();
+        qint64 thisStartTime = thisPoint->metadata(DataIndexer::IndexTime).toDateTime().toSecsSinceEpoch();
+        qint64 thisEndTime = thisStartTime+thisPoint->metadata(DataIndexer::IndexDuration).toInt();
 
         // Check that the stops to be merged are not too far apart in distance.
         if (!withinDistance(firstPoint, thisLat, thisLon, mergeMaxDistance))
@@ -520,7 +556,7 @@ void StopDetectDialogue::slotMergeStops()
     // The start time of the merged point is the same as the start time of the
     // original first point.
     const int dur = endTime-startTime;
-    setStopData(firstPoint, firstPoint->metadata("time").toDateTime(), dur);
+    setStopData(firstPoint, firstPoint->metadata(DataIndexer::IndexTime).toDateTime(), dur);
     firstPoint->setLatLong((avgLat/num), (avgLon/num));
 
     // Remove the other points that were merged into the first one,
@@ -533,7 +569,7 @@ void StopDetectDialogue::slotMergeStops()
     }
 
     // Record the former names of all the merged points
-    firstPoint->setMetadata("source", sourceList.join(';'));
+    firstPoint->setMetadata(DataIndexer::IndexSource, sourceList.join(';'));
 
     updateResults();
     // Select the merged point in the results list.
@@ -653,12 +689,12 @@ void StopDetectDialogue::slotCommitResults()
         TrackDataWaypoint *tdw = const_cast<TrackDataWaypoint *>(mResultPoints[i]);
         const QString sourceName = tdw->name();
 
-        const QString sources = tdw->metadata("source").toString();
+        const QString sources = tdw->metadata(DataIndexer::IndexSource).toString();
         tdw->setName(sources, true);			// present only for merged points
 
         AddWaypointCommand *cmd2 = new AddWaypointCommand(filesController(), cmd);
         cmd2->setData(sourceName, tdw->latitude(), tdw->longitude(),
-                      dynamic_cast<TrackDataFolder *>(destFolder), tdw);
+                      destFolder, tdw);
     }
 
     if (cmd->childCount()==0)				// anything to actually do?
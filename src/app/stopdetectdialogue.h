@@ -67,6 +67,7 @@ private slots:
 
 private:
     void updateResults();
+    bool isCommittedStop(const TrackDataWaypoint *tdw, int maxDist) const;
 
 private:
     QListWidget *mResultsList;
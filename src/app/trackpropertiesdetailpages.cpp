@@ -52,12 +52,12 @@ unsigned sumTotalTravelTime2(const TrackDataItem *item)
     // Only consider segments (containing recorded tracks) for travel time.
     // Get the time from the first contained point to the last.
 
-    const TrackDataSegment *tds = dynamic_cast<const TrackDataSegment *>(item);
+    const TrackDataSegment *tds = TrackData::cast<TrackDataSegment>(item);
     if (tds!=nullptr && num>=2)				// segment with enough points
     {
-        const TrackDataAbstractPoint *tdp1 = dynamic_cast<const TrackDataAbstractPoint *>(item->childAt(0));
+        const TrackDataAbstractPoint *tdp1 = TrackData::cast<TrackDataAbstractPoint>(item->childAt(0));
         Q_ASSERT(tdp1!=nullptr);
-        const TrackDataAbstractPoint *tdp2 = dynamic_cast<const TrackDataAbstractPoint *>(item->childAt(num-1));
+        const TrackDataAbstractPoint *tdp2 = TrackData::cast<TrackDataAbstractPoint>(item->childAt(num-1));
         Q_ASSERT(tdp2!=nullptr);
         tt = tdp1->timeTo(tdp2);
     }
@@ -66,8 +66,8 @@ unsigned sumTotalTravelTime2(const TrackDataItem *item)
         // For any container that can contain segments (file or track),
         // recurse into its children.
 
-        if (dynamic_cast<const TrackDataFile *>(item)!=nullptr ||
-            dynamic_cast<const TrackDataTrack *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataFile>(item)!=nullptr ||
+            TrackData::cast<TrackDataTrack>(item)!=nullptr)
         {
             for (int i = 0; i<num; ++i)
             {
@@ -96,14 +96,14 @@ unsigned sumTotalTravelTime(const QList<TrackDataItem *> *items)
     const TrackDataItem *item1 = items->first();	// first item
     unsigned tt = 0;					// running total
 
-    const TrackDataAbstractPoint *tdp1 = dynamic_cast<const TrackDataAbstractPoint *>(item1);
+    const TrackDataAbstractPoint *tdp1 = TrackData::cast<TrackDataAbstractPoint>(item1);
 
     // If two or more points are selected (in a segment), get the time span
     // between the first and last.
 
     if (num>=2 && tdp1!=nullptr)
     {
-        const TrackDataAbstractPoint *tdp2 = dynamic_cast<TrackDataAbstractPoint *>(items->last());
+        const TrackDataAbstractPoint *tdp2 = TrackData::cast<TrackDataAbstractPoint>(items->last());
         Q_ASSERT(tdp2!=nullptr);
         tt = tdp1->timeTo(tdp2);
         return (tt);
@@ -127,30 +127,23 @@ double sumTotalTravelDistance2(const TrackDataItem *item, bool tracksOnly)
 
     // Ignore folders.  Waypoints are not considered to be in either time or
     // file order, so the concept of travel distance for them is meaningless.
-    const TrackDataFolder *tdf = dynamic_cast<const TrackDataFolder *>(item);
+    const TrackDataFolder *tdf = TrackData::cast<TrackDataFolder>(item);
     if (tdf!=nullptr) return (0.0);			// don't want folders here
 
     // See whether the item is a ordered container (segment or route).
     // If it is a route, but a higher level has decided that routes are
     // not wanted, then finish here.
-    const TrackDataSegment *tds = dynamic_cast<const TrackDataSegment *>(item);
-    const TrackDataRoute *tdr = dynamic_cast<const TrackDataRoute *>(item);
+    const TrackDataSegment *tds = TrackData::cast<TrackDataSegment>(item);
+    const TrackDataRoute *tdr = TrackData::cast<TrackDataRoute>(item);
     if (tdr!=nullptr && tracksOnly) return (0.0);	// don't want routes here
 
     double dist = 0.0;					// running total
 
     if (tds!=nullptr || tdr!=nullptr)			// this is a point container
     {
-        // For any ordered container (segment or route), sum all of its
-        // contained points.
-        const TrackDataAbstractPoint *prev = nullptr;
-        for (int i = 0; i<num; ++i)
-        {
-            const TrackDataAbstractPoint *tdp = dynamic_cast<TrackDataAbstractPoint *>(item->childAt(i));
-            Q_ASSERT(tdp!=nullptr);
-            if (prev!=nullptr) dist += prev->distanceTo(tdp);
-            prev = tdp;
-        }
+        // For any ordered container (segment or route), the total of
+        // all of its contained points is already available.
+        dist = TrackData::pointColumns(item)->totalDistance();
     }
     else						// any other container
     {
@@ -187,7 +180,7 @@ double sumTotalTravelDistance(const QList<TrackDataItem *> *items)
     const TrackDataItem *item1 = items->first();	// first item
     double dist = 0.0;					// running total
 
-    const TrackDataAbstractPoint *tdp1 = dynamic_cast<const TrackDataAbstractPoint *>(item1);
+    const TrackDataAbstractPoint *tdp1 = TrackData::cast<TrackDataAbstractPoint>(item1);
 
     // If two points are selected in an ordered container (segment or
     // route), look at all of the points between them.  This works
@@ -199,14 +192,21 @@ double sumTotalTravelDistance(const QList<TrackDataItem *> *items)
         Q_ASSERT(pnt!=nullptr);
         const int idx1 = pnt->childIndex(tdp1);
 
-        const TrackDataAbstractPoint *tdp2 = dynamic_cast<TrackDataAbstractPoint *>(items->last());
+        const TrackDataAbstractPoint *tdp2 = TrackData::cast<TrackDataAbstractPoint>(items->last());
         Q_ASSERT(tdp2!=nullptr);
 
-        const TrackDataAbstractPoint *prev = tdp1;
         const int idx2 = pnt->childIndex(tdp2);
+        const PointColumns *cols = TrackData::pointColumns(pnt);
+        if (cols!=nullptr)				// segment or route,
+        {						// use cumulative distance
+            if (idx2>idx1) dist = cols->distanceBetween(idx1, idx2);
+            return (dist);
+        }
+
+        const TrackDataAbstractPoint *prev = tdp1;
         for (int i = idx1+1; i<=idx2; ++i)
         {
-            const TrackDataAbstractPoint *tdp = dynamic_cast<TrackDataAbstractPoint *>(pnt->childAt(i));
+            const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(pnt->childAt(i));
             Q_ASSERT(tdp!=nullptr);
             dist += prev->distanceTo(tdp);
             prev = tdp;
@@ -224,7 +224,7 @@ double sumTotalTravelDistance(const QList<TrackDataItem *> *items)
         const TrackDataAbstractPoint *prev = nullptr;
         for (const TrackDataItem *item : qAsConst(*items))
         {
-            const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(item);
+            const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item);
             Q_ASSERT(tdp!=nullptr);
             if (prev!=nullptr) dist += prev->distanceTo(tdp);
             prev = tdp;
@@ -239,14 +239,14 @@ double sumTotalTravelDistance(const QList<TrackDataItem *> *items)
     // will be considered.
 
     bool tracksOnly = false;				// assume so to start
-    if (dynamic_cast<const TrackDataFile *>(item1)!=nullptr)
+    if (TrackData::cast<TrackDataFile>(item1)!=nullptr)
     {							// file at top level
         for (const TrackDataItem *item : qAsConst(*items))
         {
             for (int i = 0; i<item->childCount(); ++i)
             {
                 const TrackDataItem *childItem = item->childAt(i);
-                const TrackDataTrack *tdt = dynamic_cast<const TrackDataTrack *>(childItem);
+                const TrackDataTrack *tdt = TrackData::cast<TrackDataTrack>(childItem);
                 if (tdt!=nullptr)			// have found a track
                 {
                     tracksOnly = true;
@@ -281,8 +281,8 @@ static void getTwoPoints(const QList<TrackDataItem *> *items,
     int idx2 = parentContainer->childIndex(item2);
     if (idx1>idx2) qSwap(idx1, idx2);			// order by index = time
 
-    TrackDataAbstractPoint *pnt1 = dynamic_cast<TrackDataAbstractPoint *>(parentContainer->childAt(idx1));
-    TrackDataAbstractPoint *pnt2 = dynamic_cast<TrackDataAbstractPoint *>(parentContainer->childAt(idx2));
+    TrackDataAbstractPoint *pnt1 = TrackData::cast<TrackDataAbstractPoint>(parentContainer->childAt(idx1));
+    TrackDataAbstractPoint *pnt2 = TrackData::cast<TrackDataAbstractPoint>(parentContainer->childAt(idx2));
     Q_ASSERT(pnt1!=nullptr && pnt2!=nullptr);
 
     *ppt1 = pnt1;
@@ -337,7 +337,7 @@ void TrackItemDetailPage::addDisplayFields(const QList<TrackDataItem *> *items,
         }
     }
 
-    const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(items->first());
+    const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(items->first());
 
     TrackDataLabel *l;
     VariableUnitDisplay *vl;
@@ -581,7 +581,7 @@ void TrackItemDetailPage::refreshData()
     const QTimeZone *tz = dataModel()->timeZone();
     if (mTimeLabel!=nullptr)
     {
-        mTimeLabel->setDateTime(dataModel()->data("time").toDateTime());
+        mTimeLabel->setDateTime(dataModel()->data(DataIndexer::IndexTime).toDateTime());
         mTimeLabel->setTimeZone(tz);
     }
 
@@ -590,7 +590,7 @@ void TrackItemDetailPage::refreshData()
 
     if (mElevationLabel!=nullptr)
     {							// blanks display for NAN
-        const QVariant &v = dataModel()->data("ele");
+        const QVariant &v = dataModel()->data(DataIndexer::IndexEle);
         mElevationLabel->setValue(v.isValid() ? v.toDouble() : NAN);
     }
 
@@ -600,7 +600,7 @@ void TrackItemDetailPage::refreshData()
         const QVariant &v = dataModel()->data(idx);
         QWidget *l = mMetadataMap[idx];
 
-        if (idx==DataIndexer::index("time"))	// special conversion for this
+        if (idx==DataIndexer::IndexTime)	// special conversion for this
         {
             TrackDataLabel *tl = qobject_cast<TrackDataLabel *>(l);
             Q_ASSERT(tl!=nullptr);
@@ -608,7 +608,7 @@ void TrackItemDetailPage::refreshData()
             tl->setDateTime(dt);
             tl->setTimeZone(tz);
         }
-        else if (idx==DataIndexer::index("speed"))
+        else if (idx==DataIndexer::IndexSpeed)
         {						// special 'double' value
             QLabel *ql = qobject_cast<QLabel *>(l);
             Q_ASSERT(ql!=nullptr);
@@ -644,9 +644,9 @@ TrackFileDetailPage::TrackFileDetailPage(const QList<TrackDataItem *> *items, QW
         for (int j = 0; j<item->childCount(); ++j)
         {
             const TrackDataItem *childItem = item->childAt(j);
-            if (dynamic_cast<const TrackDataTrack *>(childItem)!=nullptr) ++nTracks;
-            else if (dynamic_cast<const TrackDataFolder *>(childItem)!=nullptr) ++nFolders;
-            else if (dynamic_cast<const TrackDataRoute *>(childItem)!=nullptr) ++nRoutes;
+            if (TrackData::cast<TrackDataTrack>(childItem)!=nullptr) ++nTracks;
+            else if (TrackData::cast<TrackDataFolder>(childItem)!=nullptr) ++nFolders;
+            else if (TrackData::cast<TrackDataRoute>(childItem)!=nullptr) ++nRoutes;
         }
     }
 
@@ -714,14 +714,14 @@ TrackSegmentDetailPage::TrackSegmentDetailPage(const QList<TrackDataItem *> *ite
 
     if (items->count()==1)				// show interval if only one
     {
-        const TrackDataSegment *tds = dynamic_cast<const TrackDataSegment *>(items->first());
+        const TrackDataSegment *tds = TrackData::cast<TrackDataSegment>(items->first());
         Q_ASSERT(tds!=nullptr);
 
         int cnt = tds->childCount();
         if (cnt>1)					// if more than one point
         {
-            const TrackDataTrackpoint *first = dynamic_cast<const TrackDataTrackpoint *>(tds->childAt(0));
-            const TrackDataTrackpoint *last = dynamic_cast<const TrackDataTrackpoint *>(tds->childAt(cnt-1));
+            const TrackDataTrackpoint *first = TrackData::cast<TrackDataTrackpoint>(tds->childAt(0));
+            const TrackDataTrackpoint *last = TrackData::cast<TrackDataTrackpoint>(tds->childAt(cnt-1));
             Q_ASSERT(first!=nullptr && last!=nullptr);
             int tt = qRound(double(first->timeTo(last))/(cnt-1));
             QLabel *l = new TrackDataLabel(TrackData::formattedDuration(tt), this);
@@ -776,8 +776,8 @@ TrackFolderDetailPage::TrackFolderDetailPage(const QList<TrackDataItem *> *items
         for (int j = 0; j<item->childCount(); ++j)
         {
             const TrackDataItem *childItem = item->childAt(j);
-            if (dynamic_cast<const TrackDataWaypoint *>(childItem)!=nullptr) ++nWaypoints;
-            else if (dynamic_cast<const TrackDataFolder *>(childItem)!=nullptr) ++nFolders;
+            if (TrackData::cast<TrackDataWaypoint>(childItem)!=nullptr) ++nWaypoints;
+            else if (TrackData::cast<TrackDataFolder>(childItem)!=nullptr) ++nFolders;
         }
     }
 
@@ -794,7 +794,7 @@ TrackFolderDetailPage::TrackFolderDetailPage(const QList<TrackDataItem *> *items
 
     if (items->count()==1)				// a single item
     {
-        TrackDataFolder *folderItem = dynamic_cast<TrackDataFolder *>(items->first());
+        TrackDataFolder *folderItem = TrackData::cast<TrackDataFolder>(items->first());
         Q_ASSERT(folderItem!=nullptr);
         mFolderParent = folderItem->path();
         const int idx = mFolderParent.lastIndexOf('/');
@@ -809,7 +809,7 @@ void TrackFolderDetailPage::refreshData()
 {
     TrackItemDetailPage::refreshData();
 
-    const QString name = dataModel()->data("name").toString();
+    const QString name = dataModel()->data(DataIndexer::IndexName).toString();
     mPathDisplay->setText(mFolderParent.isEmpty() ? name : (mFolderParent+'/'+name));
 }
 
@@ -828,7 +828,7 @@ TrackWaypointDetailPage::TrackWaypointDetailPage(const QList<TrackDataItem *> *i
     addDisplayFields(items, DisplayPosition|DisplayTime|DisplayElevation);
     if (items->count()==1)				// single selection
     {
-        const TrackDataWaypoint *tdp = dynamic_cast<const TrackDataWaypoint *>(items->first());
+        const TrackDataWaypoint *tdp = TrackData::cast<TrackDataWaypoint>(items->first());
         Q_ASSERT(tdp!=nullptr);
 
         addSeparatorField();
@@ -837,7 +837,7 @@ TrackWaypointDetailPage::TrackWaypointDetailPage(const QList<TrackDataItem *> *i
         pathDisplay->setTextInteractionFlags(Qt::TextSelectableByMouse|Qt::TextSelectableByKeyboard);
         mFormLayout->addRow(i18nc("@label:textbox", "Folder:"), pathDisplay);
 
-        TrackDataFolder *folderItem = dynamic_cast<TrackDataFolder *>(tdp->parent());
+        TrackDataFolder *folderItem = TrackData::cast<TrackDataFolder>(tdp->parent());
         Q_ASSERT(folderItem!=nullptr);
         pathDisplay->setText(folderItem->path());
     }
@@ -82,7 +82,7 @@ TrackItemGeneralPage::TrackItemGeneralPage(const QList<TrackDataItem *> *items,
 
 bool TrackItemGeneralPage::isDataValid() const
 {
-    const QString &name = dataModel()->data("name").toString();
+    const QString &name = dataModel()->data(DataIndexer::IndexName).toString();
     qDebug() << "name" << name << "enabled?" << mNameEdit->isEnabled();
     if (!mNameEdit->isEnabled()) return (true);		// multiple items, entry ignored
     if (!mHasExplicitName) return (true);		// no explicit name, null allowed
@@ -93,7 +93,7 @@ bool TrackItemGeneralPage::isDataValid() const
 void TrackItemGeneralPage::refreshData()
 {
     mNameEdit->setPlaceholderText(i18n("Specify an item name..."));
-    const QString &name = dataModel()->data("name").toString();
+    const QString &name = dataModel()->data(DataIndexer::IndexName).toString();
     if (!mHasExplicitName)				// no explicit name set
     {
         mNameEdit->setText("");
@@ -104,11 +104,11 @@ void TrackItemGeneralPage::refreshData()
         mNameEdit->setText(name);
     }
 
-    if (mTypeCombo!=nullptr) mTypeCombo->setType(dataModel()->data("type").toString());
+    if (mTypeCombo!=nullptr) mTypeCombo->setType(dataModel()->data(DataIndexer::IndexType).toString());
 
     if (mDescEdit!=nullptr && mDescEdit->isEnabled())
     {
-        QString desc = dataModel()->data("desc").toString();
+        QString desc = dataModel()->data(DataIndexer::IndexDesc).toString();
         if (!desc.isEmpty() && !desc.endsWith('\n')) desc += '\n';
         mDescEdit->setPlainText(desc);
     }
@@ -122,7 +122,7 @@ void TrackItemGeneralPage::refreshData()
     const QTimeZone *tz = dataModel()->timeZone();
     if (mTimeLabel!=nullptr)
     {
-        mTimeLabel->setDateTime(dataModel()->data("time").toDateTime());
+        mTimeLabel->setDateTime(dataModel()->data(DataIndexer::IndexTime).toDateTime());
         mTimeLabel->setTimeZone(tz);
     }
 
@@ -134,13 +134,13 @@ void TrackItemGeneralPage::refreshData()
 void TrackItemGeneralPage::slotNameChanged(const QString &text)
 {
     if (!mNameEdit->isEnabled()) return;		// name is read only
-    dataModel()->setData(DataIndexer::index("name"), text);
+    dataModel()->setData(DataIndexer::IndexName, text);
 }
 
 
 void TrackItemGeneralPage::slotTypeChanged(const QString &text)
 {							// do not use 'text', it could be "none"
-    dataModel()->setData(DataIndexer::index("type"), mTypeCombo->typeText());
+    dataModel()->setData(DataIndexer::IndexType, mTypeCombo->typeText());
 }
 
 
@@ -148,7 +148,7 @@ void TrackItemGeneralPage::slotDescChanged()
 {
     const QString desc = mDescEdit->toPlainText().trimmed();
     qDebug() << desc;
-    dataModel()->setData(DataIndexer::index("desc"), desc);
+    dataModel()->setData(DataIndexer::IndexDesc, desc);
 }
 
 
@@ -160,8 +160,8 @@ void TrackItemGeneralPage::slotChangePosition()
 
     if (!d.exec()) return;
 
-    dataModel()->setData(DataIndexer::index("latitude"), d.latitude());
-    dataModel()->setData(DataIndexer::index("longitude"), d.longitude());
+    dataModel()->setData(DataIndexer::IndexLatitude, d.latitude());
+    dataModel()->setData(DataIndexer::IndexLongitude, d.longitude());
     refreshData();					// update the position display
 }
 
@@ -278,7 +278,7 @@ TrackFileGeneralPage::TrackFileGeneralPage(const QList<TrackDataItem *> *items,
 
     if (items->count()==1)				// a single item
     {
-        TrackDataFile *fileItem = dynamic_cast<TrackDataFile *>(items->first());
+        TrackDataFile *fileItem = TrackData::cast<TrackDataFile>(items->first());
         Q_ASSERT(fileItem!=nullptr);
         mUrlRequester->setText(fileItem->fileName().toDisplayString());
         mTimeZoneSel->setItems(items);			// use these to get timezone
@@ -320,7 +320,7 @@ void TrackFileGeneralPage::refreshData()
 
     if (mTimeZoneSel!=nullptr)
     {
-        const QString zoneName = dataModel()->data("timezone").toString();
+        const QString zoneName = dataModel()->data(DataIndexer::IndexTimezone).toString();
         mTimeZoneSel->setTimeZone(zoneName);
     }
 }
@@ -328,7 +328,7 @@ void TrackFileGeneralPage::refreshData()
 
 void TrackFileGeneralPage::slotTimeZoneChanged(const QString &zoneName)
 {
-    dataModel()->setData(DataIndexer::index("timezone"), zoneName);
+    dataModel()->setData(DataIndexer::IndexTimezone, zoneName);
     refreshData();					// update times on this page
 }
 
@@ -439,7 +439,7 @@ TrackWaypointGeneralPage::TrackWaypointGeneralPage(const QList<TrackDataItem *>
         // TODO: The "Media" field and the media that is output when the play
         // button is pressed is not automatically updated from the metadata.
 
-        theWaypoint = dynamic_cast<const TrackDataWaypoint *>(items->first());
+        theWaypoint = TrackData::cast<TrackDataWaypoint>(items->first());
         Q_ASSERT(theWaypoint!=nullptr);
 
         QString typeName;
@@ -541,7 +541,7 @@ void TrackWaypointGeneralPage::refreshData()
 {
     TrackItemGeneralPage::refreshData();
 
-    mStatusCombo->setCurrentIndex(dataModel()->data("status").toInt());
+    mStatusCombo->setCurrentIndex(dataModel()->data(DataIndexer::IndexStatus).toInt());
 }
 
 
@@ -573,7 +573,7 @@ void TrackWaypointGeneralPage::slotStatusChanged(int idx)
     qDebug() << idx;
 
     const int status = mStatusCombo->itemData(idx).toInt();
-    dataModel()->setData(DataIndexer::index("status"), (status==0 ? QVariant() : status));
+    dataModel()->setData(DataIndexer::IndexStatus, (status==0 ? QVariant() : status));
 }
 
 //////////////////////////////////////////////////////////////////////////
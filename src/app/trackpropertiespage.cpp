@@ -49,7 +49,7 @@ TrackPropertiesPage::TrackPropertiesPage(const QList<TrackDataItem *> *items, QW
     mIsEmpty = (TrackData::sumTotalChildCount(items)==0);
     if (mIsEmpty && !items->isEmpty())
     {
-        if (dynamic_cast<const TrackDataAbstractPoint *>(items->first())!=nullptr) mIsEmpty = false;
+        if (TrackData::cast<TrackDataAbstractPoint>(items->first())!=nullptr) mIsEmpty = false;
     }
 }
 
@@ -80,16 +80,16 @@ void TrackWaypointPlotPage::slotPlotDataChanged()
     Q_ASSERT(plot!=nullptr);
 
     const QString pd = plot->plotData();
-    if (plot==mBearingEdit) dataModel()->setData(DataIndexer::index("bearingline"), pd);
-    else if (plot==mRangeEdit) dataModel()->setData(DataIndexer::index("rangering"), pd);
+    if (plot==mBearingEdit) dataModel()->setData(DataIndexer::IndexBearingline, pd);
+    else if (plot==mRangeEdit) dataModel()->setData(DataIndexer::IndexRangering, pd);
     else Q_ASSERT(false);
 }
 
 
 void TrackWaypointPlotPage::refreshData()
 {
-    mBearingEdit->setPlotData(dataModel()->data("bearingline").toString());
-    mRangeEdit->setPlotData(dataModel()->data("rangering").toString());
+    mBearingEdit->setPlotData(dataModel()->data(DataIndexer::IndexBearingline).toString());
+    mRangeEdit->setPlotData(dataModel()->data(DataIndexer::IndexRangering).toString());
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -61,19 +61,19 @@ TrackItemStylePage::TrackItemStylePage(const QList<TrackDataItem *> *items, QWid
     const TrackDataItem *item = items->first();
     mIsTopLevel = (item->parent()==nullptr);
 
-    const QVariant v = item->metadata("color");		// get old compatibility value
+    const QVariant v = item->metadata(DataIndexer::IndexColor);	// get old compatibility value
     if (!v.isNull())
     {
         qWarning() << "item" << item->name() << "uses old COLOR data";
-        if (dynamic_cast<const TrackDataAbstractPoint *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataAbstractPoint>(item)!=nullptr)
         {						// colour for a point
-            dataModel()->setData(DataIndexer::index("pointcolor"), v);
-            dataModel()->setData(DataIndexer::index("color"), QVariant());
+            dataModel()->setData(DataIndexer::IndexPointcolor, v);
+            dataModel()->setData(DataIndexer::IndexColor, QVariant());
         }
         else						// colour for a line/container
         {
-            dataModel()->setData(DataIndexer::index("linecolor"), v);
-            dataModel()->setData(DataIndexer::index("color"), QVariant());
+            dataModel()->setData(DataIndexer::IndexLinecolor, v);
+            dataModel()->setData(DataIndexer::IndexColor, QVariant());
         }
     }
 }
@@ -0,0 +1,385 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Include files							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+
+#include <qcoreapplication.h>
+#include <qcommandlineparser.h>
+#include <qelapsedtimer.h>
+#include <qtemporarydir.h>
+#include <qdatetime.h>
+#include <qrandom.h>
+#include <qvector.h>
+#include <qfile.h>
+#include <qdir.h>
+#include <qscopedpointer.h>
+#include <qurl.h>
+#include <qdebug.h>
+
+#include "trackdata.h"
+#include "errorreporter.h"
+#include "gpximporter.h"
+#include "gpxexporter.h"
+#include "snapshotimporter.h"
+#include "snapshotexporter.h"
+#include "gpxgenerator.h"
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Memory usage							//
+//									//
+//  The peak resident memory is the "VmHWM" value from the process	//
+//  status.  Writing "5" to "clear_refs" (supported since Linux 4.0)	//
+//  resets it, so that the peak of each step can be measured		//
+//  separately.  On other systems nothing is shown.			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+static void resetPeakMemory()
+{
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) file.write("5");
+}
+
+
+static qint64 peakMemory()				// in kilobytes
+{
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly)) return (-1);
+
+    // The size of a /proc file is not known, so it must all be read
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines)
+    {
+        if (!line.startsWith("VmHWM:")) continue;
+        return (line.mid(6).simplified().split(' ').first().toLongLong());
+    }
+
+    return (-1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Results								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+struct PointCounts
+{
+    int trackpoints = 0;
+    int waypoints = 0;
+    int routepoints = 0;
+
+    bool operator==(const PointCounts &other) const
+    {
+        return (trackpoints==other.trackpoints && waypoints==other.waypoints && routepoints==other.routepoints);
+    }
+};
+
+
+// Segments and routes are not descended into, so that the points of
+// deferred segments (see DeferredPointSource) are not loaded.
+
+static void countPoints(const TrackDataItem *item, PointCounts *counts)
+{
+    switch (item->type())
+    {
+case TrackData::Segment:	counts->trackpoints += item->childCount();	return;
+case TrackData::Route:		counts->routepoints += item->childCount();	return;
+case TrackData::Waypoint:	++counts->waypoints;				return;
+default:			break;
+    }
+
+    for (int i = 0; i<item->childCount(); ++i) countPoints(item->childAt(i), counts);
+}
+
+
+static void printHeading()
+{
+    printf("%10s  %-16s %10s %12s %10s  %s\n", "points", "step", "time ms", "points/sec", "peak MB", "notes");
+}
+
+
+static void printResult(int size, const char *step, qint64 msecs, qint64 peakKb, const QString &notes = QString())
+{
+    const QByteArray rate = (msecs>0 ? QByteArray::number(qint64(size)*1000/msecs) : QByteArray("-"));
+    const QByteArray peak = (peakKb>=0 ? QByteArray::number(peakKb/1024.0, 'f', 1) : QByteArray("-"));
+    printf("%10d  %-16s %10lld %12s %10s  %s\n", size, step, msecs,
+           rate.constData(), peak.constData(), qPrintable(notes));
+    fflush(stdout);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Import and export							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+static QString countsString(const PointCounts &counts)
+{
+    return (QString("%1 trk %2 wpt %3 rte").arg(counts.trackpoints).arg(counts.waypoints).arg(counts.routepoints));
+}
+
+
+static TrackDataFile *timeImport(ImporterBase *importer, const QString &path, int size,
+                                 const char *step, const PointCounts &expected)
+{
+    resetPeakMemory();
+    QElapsedTimer timer;
+    timer.start();
+    TrackDataFile *tdf = importer->load(QUrl::fromLocalFile(path));
+    const qint64 msecs = timer.elapsed();
+    const qint64 peak = peakMemory();
+
+    if (tdf==nullptr || importer->reporter()->severity()>=ErrorReporter::Error)
+    {
+        printResult(size, step, msecs, peak, "FAILED: "+importer->reporter()->messageList().join("; "));
+        delete tdf;
+        return (nullptr);
+    }
+
+    PointCounts counts;
+    countPoints(tdf, &counts);
+    if (!(counts==expected))
+    {
+        printResult(size, step, msecs, peak, "MISMATCH: "+countsString(counts)+", expected "+countsString(expected));
+        delete tdf;
+        return (nullptr);
+    }
+
+    printResult(size, step, msecs, peak, countsString(counts));
+    return (tdf);
+}
+
+
+static bool timeExport(ExporterBase *exporter, const QString &path, const TrackDataFile *tdf,
+                       int size, const char *step)
+{
+    resetPeakMemory();
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = exporter->save(QUrl::fromLocalFile(path), tdf, ImporterExporterBase::NoOption);
+    const qint64 msecs = timer.elapsed();
+    const qint64 peak = peakMemory();
+
+    if (!ok)
+    {
+        printResult(size, step, msecs, peak, "FAILED: "+exporter->reporter()->messageList().join("; "));
+        return (false);
+    }
+
+    printResult(size, step, msecs, peak, QString("%1 MB").arg(QFile(path).size()/(1024.0*1024.0), 0, 'f', 1));
+    return (true);
+}
+
+
+// Time importing the generated file, exporting it again and importing
+// the exported file.  The same is then done for the snapshot format.
+
+static bool benchmarkSteps(int size, const QString &base, const PointCounts &expected)
+{
+    GpxImporter gpxImp;
+    QScopedPointer<TrackDataFile> tdf(timeImport(&gpxImp, base+".gpx", size, "gpx import", expected));
+    if (tdf.isNull()) return (false);
+
+    GpxExporter gpxExp;
+    if (!timeExport(&gpxExp, base+"-export.gpx", tdf.data(), size, "gpx export")) return (false);
+
+    GpxImporter roundImp;
+    QScopedPointer<TrackDataFile> roundTdf(timeImport(&roundImp, base+"-export.gpx", size, "gpx round trip", expected));
+    if (roundTdf.isNull()) return (false);
+    roundTdf.reset();
+
+    SnapshotExporter snapExp;
+    if (!timeExport(&snapExp, base+".umbrail", tdf.data(), size, "snapshot export")) return (false);
+
+    SnapshotImporter snapImp;
+    QScopedPointer<TrackDataFile> snapTdf(timeImport(&snapImp, base+".umbrail", size, "snapshot import", expected));
+    return (!snapTdf.isNull());
+}
+
+
+// Generate a file of the specified size and run the benchmark steps on it.
+
+static bool benchmarkSize(int size, const QString &dir, quint32 seed, bool keep)
+{
+    const QString base = QDir(dir).absoluteFilePath(QString("bench-%1").arg(size));
+
+    QFile file(base+".gpx");
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "cannot create" << file.fileName() << file.errorString();
+        return (false);
+    }
+
+    resetPeakMemory();
+    QElapsedTimer timer;
+    timer.start();
+    GpxGenerator gen(seed);
+    bool ok = gen.generate(&file, size);
+    file.close();
+    const qint64 msecs = timer.elapsed();
+    const qint64 peak = peakMemory();
+
+    if (ok)
+    {
+        printResult(size, "generate", msecs, peak, QString("%1 MB").arg(file.size()/(1024.0*1024.0), 0, 'f', 1));
+
+        PointCounts expected;
+        expected.trackpoints = gen.trackpointCount();
+        expected.waypoints = gen.waypointCount();
+        expected.routepoints = gen.routepointCount();
+        ok = benchmarkSteps(size, base, expected);
+    }
+
+    if (!keep)
+    {
+        QFile::remove(base+".gpx");
+        QFile::remove(base+"-export.gpx");
+        QFile::remove(base+".umbrail");
+    }
+
+    return (ok);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Time parsing							//
+//									//
+//  Compares TrackData::parseIsoTime() with QDateTime::fromString(),	//
+//  which is what GpxImporter used previously, for the forms of time	//
+//  generated by GpxGenerator.						//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+static bool benchmarkTimeParse(int num, quint32 seed)
+{
+    QRandomGenerator rand(seed);
+    QVector<QByteArray> strings;
+    strings.reserve(num);
+    for (int i = 0; i<num; ++i)
+    {
+        const qint64 t = Q_INT64_C(946684800000)+qint64(rand.bounded(900000000))*1000+rand.bounded(1000);
+        strings.append(GpxGenerator::isoTime(t, i));
+    }
+
+    QVector<qint64> direct(num);
+    QVector<qint64> viaQt(num);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i<num; ++i) direct[i] = TrackData::parseIsoTime(strings[i].constData(), strings[i].size());
+    const qint64 directNs = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i<num; ++i) viaQt[i] = QDateTime::fromString(QString::fromLatin1(strings[i]), Qt::ISODate).toMSecsSinceEpoch();
+    const qint64 viaQtNs = timer.nsecsElapsed();
+
+    int mismatches = 0;
+    for (int i = 0; i<num; ++i)
+    {
+        if (direct[i]==viaQt[i]) continue;
+        if (mismatches==0) qWarning() << "mismatch for" << strings[i] << direct[i] << viaQt[i];
+        ++mismatches;
+    }
+
+    printf("\nTime parsing, %d strings:\n", num);
+    printf("  parseIsoTime()          %8.1f ns each\n", double(directNs)/num);
+    printf("  QDateTime::fromString() %8.1f ns each\n", double(viaQtNs)/num);
+    if (directNs>0) printf("  speedup                 %8.1fx\n", double(viaQtNs)/directNs);
+    if (mismatches>0) printf("  MISMATCH for %d strings\n", mismatches);
+    fflush(stdout);
+    return (mismatches==0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Main								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(PROJECT_NAME "benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate GPX files and time importing and exporting them");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("sizes", "Numbers of track points to generate, separated by commas", "list", "1000,10000,100000,1000000"));
+    parser.addOption(QCommandLineOption("dir", "Directory for generated files (default: temporary)", "path"));
+    parser.addOption(QCommandLineOption("keep", "Do not delete the generated files"));
+    parser.addOption(QCommandLineOption("seed", "Seed for generating files", "number", "1"));
+    parser.addOption(QCommandLineOption("times", "Number of strings for the time parsing test, 0 to skip", "number", "1000000"));
+    parser.process(app);
+
+    QVector<int> sizes;
+    const QStringList sizeList = parser.value("sizes").split(',', Qt::SkipEmptyParts);
+    for (const QString &s : sizeList)
+    {
+        bool ok;
+        const int size = s.trimmed().toInt(&ok);
+        if (!ok || size<1)
+        {
+            fprintf(stderr, "Invalid size '%s'\n", qPrintable(s));
+            return (EXIT_FAILURE);
+        }
+        sizes.append(size);
+    }
+
+    const quint32 seed = parser.value("seed").toUInt();
+    const int times = parser.value("times").toInt();
+
+    QTemporaryDir tempDir;
+    QString dir = parser.value("dir");
+    if (dir.isEmpty())
+    {
+        if (!tempDir.isValid())
+        {
+            fprintf(stderr, "Cannot create temporary directory\n");
+            return (EXIT_FAILURE);
+        }
+        dir = tempDir.path();
+        tempDir.setAutoRemove(!parser.isSet("keep"));
+    }
+
+    qDebug() << "sizes" << sizes << "in" << dir;
+    bool ok = true;
+
+    printHeading();
+    for (int size : qAsConst(sizes))
+    {
+        if (!benchmarkSize(size, dir, seed, parser.isSet("keep"))) ok = false;
+    }
+
+    if (times>0 && !benchmarkTimeParse(times, seed)) ok = false;
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
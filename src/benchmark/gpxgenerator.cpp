@@ -0,0 +1,266 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "gpxgenerator.h"
+
+#include <qiodevice.h>
+#include <qdatetime.h>
+#include <qdebug.h>
+
+
+static const int bufferSize = 1024*1024;		// buffered before writing
+static const int pointsPerSegment = 2000;
+static const int segmentsPerTrack = 5;
+static const int routepointsPerRoute = 20;
+static const qint64 startTime = Q_INT64_C(1590998400000);	// 2020-06-01T08:00:00Z
+
+static const char *trackTypes[] = { "Walk", "Cycle", "Drive", "Boat" };
+
+
+GpxGenerator::GpxGenerator(quint32 seed)
+    : mRandom(seed)
+{
+    mDevice = nullptr;
+    mBuffer.reserve(bufferSize+4096);			// retained when cleared
+    mWriteOk = true;
+}
+
+
+QByteArray GpxGenerator::isoTime(qint64 msecs, int variant)
+{
+    QDateTime dt;
+    switch (variant%4)
+    {
+case 0:							// "2020-06-01T08:00:00Z"
+case 1:							// "2020-06-01T08:00:00.250Z"
+        dt = QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC);
+        break;
+
+case 2:							// "2020-06-01T09:00:00+01:00"
+        dt = QDateTime::fromMSecsSinceEpoch(msecs, Qt::OffsetFromUTC, 3600);
+        break;
+
+case 3:							// "2020-06-01T03:00:00.250-05:00"
+        dt = QDateTime::fromMSecsSinceEpoch(msecs, Qt::OffsetFromUTC, -5*3600);
+        break;
+    }
+
+    return (dt.toString((variant%2)==0 ? Qt::ISODate : Qt::ISODateWithMs).toLatin1());
+}
+
+
+bool GpxGenerator::flush(bool force)
+{
+    if (!force && mBuffer.size()<bufferSize) return (mWriteOk);
+
+    if (mWriteOk && mDevice->write(mBuffer)!=mBuffer.size())
+    {
+        qWarning() << "write failed," << mDevice->errorString();
+        mWriteOk = false;
+    }
+
+    mBuffer.resize(0);
+    return (mWriteOk);
+}
+
+
+void GpxGenerator::writeLatLong(const char *tag, double lat, double lon)
+{
+    mBuffer += '<';
+    mBuffer += tag;
+    mBuffer += " lat=\"";
+    mBuffer += QByteArray::number(lat, 'f', 7);
+    mBuffer += "\" lon=\"";
+    mBuffer += QByteArray::number(lon, 'f', 7);
+    mBuffer += "\">\n";
+}
+
+
+void GpxGenerator::writeElement(const char *tag, const QByteArray &value)
+{
+    mBuffer += '<';
+    mBuffer += tag;
+    mBuffer += '>';
+    mBuffer += value;
+    mBuffer += "</";
+    mBuffer += tag;
+    mBuffer += ">\n";
+}
+
+
+bool GpxGenerator::generate(QIODevice *dev, int numPoints)
+{
+    qDebug() << "points" << numPoints;
+
+    mDevice = dev;
+    mBuffer.resize(0);
+    mWriteOk = true;
+
+    mLatitude = 51.4;					// somewhere near London
+    mLongitude = -0.3;
+    mElevation = 50.0;
+    mTime = startTime;
+
+    mTrackpointCount = 0;
+    mWaypointCount = 0;
+    mRoutepointCount = 0;
+
+    mBuffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<gpx version=\"1.1\" creator=\"" PROJECT_NAME "benchmark\"\n"
+               " xmlns=\"http://www.topografix.com/GPX/1/1\"\n"
+               " xmlns:gpxtpx=\"http://www.garmin.com/xmlschemas/TrackPointExtension/v1\"\n"
+               " xmlns:gpxx=\"http://www.garmin.com/xmlschemas/GpxExtensions/v3\">\n";
+
+    mBuffer += "<metadata>\n";
+    writeElement("name", "Generated "+QByteArray::number(numPoints)+" points");
+    writeElement("time", isoTime(startTime));
+    mBuffer += "</metadata>\n";
+
+    // The order of elements is as required by the GPX schema
+    writeWaypoints(numPoints/1000+1);
+    writeRoutes(numPoints/100000+1);
+
+    const int pointsPerTrack = pointsPerSegment*segmentsPerTrack;
+    for (int track = 1; numPoints>0; ++track)
+    {
+        const int num = qMin(numPoints, pointsPerTrack);
+        writeTrack(track, num);
+        numPoints -= num;
+    }
+
+    mBuffer += "</gpx>\n";
+    return (flush(true));
+}
+
+
+void GpxGenerator::writeTrack(int num, int numPoints)
+{
+    mBuffer += "<trk>\n";
+    writeElement("name", "Track "+QByteArray::number(num));
+    writeElement("type", trackTypes[num%(sizeof(trackTypes)/sizeof(trackTypes[0]))]);
+
+    while (numPoints>0)
+    {
+        const int n = qMin(numPoints, pointsPerSegment);
+        writeSegment(n);
+        numPoints -= n;
+
+        mTime += 600000;				// a gap between segments
+        mLatitude += 0.01;
+    }
+
+    mBuffer += "</trk>\n";
+}
+
+
+void GpxGenerator::writeSegment(int numPoints)
+{
+    mBuffer += "<trkseg>\n";
+    for (int i = 0; i<numPoints; ++i) writeTrackpoint();
+    mBuffer += "</trkseg>\n";
+}
+
+
+void GpxGenerator::writeTrackpoint()
+{
+    const int n = mTrackpointCount++;
+
+    mLatitude += (mRandom.generateDouble()-0.5)*0.0002;
+    mLongitude += (mRandom.generateDouble()-0.5)*0.0002;
+    mElevation = qBound(-10.0, mElevation+(mRandom.generateDouble()-0.5)*2.0, 3000.0);
+    mTime += 1000;
+
+    writeLatLong("trkpt", mLatitude, mLongitude);
+    writeElement("ele", QByteArray::number(mElevation, 'f', 1));
+
+    // Only the forms with milliseconds show a fraction of a second
+    const int variant = mRandom.bounded(4);
+    writeElement("time", isoTime(mTime+((variant%2)==0 ? 0 : mRandom.bounded(1000)), variant));
+
+    if ((n%3)==0) writeElement("hdop", QByteArray::number(0.5+mRandom.generateDouble()*3.0, 'f', 1));
+    if ((n%10)==0) writeElement("sat", QByteArray::number(4+mRandom.bounded(9)));
+
+    if ((n%5)==0)
+    {
+        mBuffer += "<extensions>\n<gpxtpx:TrackPointExtension>\n";
+        writeElement("gpxtpx:hr", QByteArray::number(90+mRandom.bounded(80)));
+        if ((n%10)==0) writeElement("gpxtpx:cad", QByteArray::number(60+mRandom.bounded(40)));
+        writeElement("gpxtpx:atemp", QByteArray::number(10.0+mRandom.generateDouble()*15.0, 'f', 1));
+        mBuffer += "</gpxtpx:TrackPointExtension>\n</extensions>\n";
+    }
+
+    mBuffer += "</trkpt>\n";
+    flush();
+}
+
+
+void GpxGenerator::writeWaypoints(int num)
+{
+    for (int i = 0; i<num; ++i)
+    {
+        writeLatLong("wpt", 51.0+mRandom.generateDouble(), -1.0+mRandom.generateDouble());
+        writeElement("ele", QByteArray::number(mRandom.bounded(200)));
+        writeElement("time", isoTime(startTime+qint64(i)*60000, i));
+        writeElement("name", "Waypoint "+QByteArray::number(i+1));
+        if ((i%3)==0) writeElement("desc", "Description of waypoint "+QByteArray::number(i+1));
+        writeElement("sym", ((i%2)==0 ? "Flag" : "Pin"));
+
+        if ((i%2)==0)					// in a category
+        {
+            mBuffer += "<extensions>\n<gpxx:WaypointExtension>\n<gpxx:Categories>\n";
+            writeElement("gpxx:Category", "Category "+QByteArray::number(i%5));
+            mBuffer += "</gpxx:Categories>\n</gpxx:WaypointExtension>\n</extensions>\n";
+        }
+
+        mBuffer += "</wpt>\n";
+        ++mWaypointCount;
+        flush();
+    }
+}
+
+
+void GpxGenerator::writeRoutes(int num)
+{
+    for (int i = 0; i<num; ++i)
+    {
+        mBuffer += "<rte>\n";
+        writeElement("name", "Route "+QByteArray::number(i+1));
+
+        double lat = 51.0+mRandom.generateDouble();
+        double lon = -1.0+mRandom.generateDouble();
+        for (int j = 0; j<routepointsPerRoute; ++j)
+        {
+            lat += (mRandom.generateDouble()-0.5)*0.01;
+            lon += (mRandom.generateDouble()-0.5)*0.01;
+            writeLatLong("rtept", lat, lon);
+            writeElement("name", "RP"+QByteArray::number(j+1));
+            mBuffer += "</rtept>\n";
+            ++mRoutepointCount;
+        }
+
+        mBuffer += "</rte>\n";
+        flush();
+    }
+}
@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef GPXGENERATOR_H
+#define GPXGENERATOR_H
+
+#include <qbytearray.h>
+#include <qrandom.h>
+
+class QIODevice;
+
+
+// Generates a GPX file with a specified number of track points, for
+// benchmarking.  The output depends only on the number of points and
+// the seed, so that results from different runs can be compared.
+//
+// The tracks are divided into a number of segments, and some of the
+// points have optional elements and extensions.  There are also some
+// waypoints (some in categories, which become folders when imported)
+// and routes, in proportion to the number of track points.  The times
+// of the points use a mixture of the ISO 8601 forms found in real files.
+
+class GpxGenerator
+{
+public:
+    explicit GpxGenerator(quint32 seed = 1);
+    ~GpxGenerator() = default;
+
+    bool generate(QIODevice *dev, int numPoints);
+
+    // The number of each type of point written by generate()
+    int trackpointCount() const				{ return (mTrackpointCount); }
+    int waypointCount() const				{ return (mWaypointCount); }
+    int routepointCount() const				{ return (mRoutepointCount); }
+
+    // Format a time in one of the forms used in the generated file.
+    // The variant selects the form, any value is accepted.
+    static QByteArray isoTime(qint64 msecs, int variant = 0);
+
+private:
+    void writeTrack(int num, int numPoints);
+    void writeSegment(int numPoints);
+    void writeTrackpoint();
+    void writeWaypoints(int num);
+    void writeRoutes(int num);
+    void writeLatLong(const char *tag, double lat, double lon);
+    void writeElement(const char *tag, const QByteArray &value);
+    bool flush(bool force = false);
+
+private:
+    QRandomGenerator mRandom;
+    QIODevice *mDevice;
+    QByteArray mBuffer;
+    bool mWriteOk;
+
+    double mLatitude;					// current track position
+    double mLongitude;
+    double mElevation;
+    qint64 mTime;					// current track time
+
+    int mTrackpointCount;
+    int mWaypointCount;
+    int mRoutepointCount;
+};
+
+#endif							// GPXGENERATOR_H
@@ -26,16 +26,32 @@
 #include "dataindexer.h"
 
 #include <qhash.h>
+#include <qvector.h>
+#include <qreadwritelock.h>
 #include <qdebug.h>
 
 
-// These are not POD, but they will not be used
-// until the application is fully initialised
-// so should be safe.
+// Protects all of the hashes and vectors below, apart from
+// sKnownNameArray which is never changed after it is set up.
+// The lock is defined first in this source file, so it will have
+// been constructed before the registrar below uses it.
+static QReadWriteLock sLock;
+
 static QHash<QByteArray,int> sIndexHash;
 static QHash<int,QByteArray> sNamespaceHash;
 static QHash<QByteArray,QByteArray> sUriHash;
 
+// The reverse mapping from index to name, maintained alongside
+// sIndexHash so that name() does not need to search the hash.
+static QVector<QByteArray> sNameVector;
+// The name with namespace for each index, generated when it is first
+// needed.  A null entry means that it has not been generated yet.
+static QVector<QByteArray> sQualifiedNames;
+
+// The names of the fixed indexes.  These are set up at program start
+// and not changed afterwards, so they can be read without locking.
+static QByteArray sKnownNameArray[DataIndexer::IndexKnownCount];
+
 // The XML namespace prefix used by this application.
 // The namespace URI is only used by and is set in GpxExporter.
 static const char *sApplicationNamespace = PROJECT_NAME;
@@ -55,6 +71,65 @@ static const char *sApplicationTags[] =
     nullptr
 };
 
+// Names for the fixed indexes, in the order of DataIndexer::KnownIndex.
+static const char *sKnownNames[] =
+{
+    "name",
+    "latitude",
+    "longitude",
+    "ele",
+    "time",
+    "speed",
+    "hdop",
+    "heading",
+    "desc",
+    "type",
+    "category",
+    "color",
+    "link",
+    "media",
+    "creator",
+    "version",
+    "timezone",
+    "position",
+    "duration",
+    "status",
+    "source",
+    "stop",
+    "folder",
+    "linecolor",
+    "pointcolor",
+    "bearingline",
+    "rangering",
+    nullptr
+};
+
+
+// Allocate the fixed indexes when the program starts.  The hashes
+// above are defined within this source file, so they are guaranteed
+// to have been constructed by the time that this is done.
+struct KnownIndexRegistrar
+{
+    KnownIndexRegistrar();
+};
+
+static KnownIndexRegistrar sRegistrar;
+
+
+KnownIndexRegistrar::KnownIndexRegistrar()
+{
+    int expected = 0;
+    for (const char **nm = &sKnownNames[0]; *nm!=nullptr; ++nm)
+    {
+        const int idx = DataIndexer::index(*nm);
+        Q_ASSERT(idx==expected);
+        sKnownNameArray[idx] = *nm;
+        ++expected;
+    }
+
+    Q_ASSERT(expected==DataIndexer::IndexKnownCount);
+}
+
 
 int DataIndexer::index(const QByteArray &nm)
 {
@@ -64,11 +139,22 @@ int DataIndexer::index(const QByteArray &nm)
         return (indexWithNamespace(nm));		// should not recurse
     }
 
+    {
+        QReadLocker locker(&sLock);
+        const int idx = sIndexHash.value(nm, -1);
+        if (idx!=-1) return (idx);			// already allocated
+    }
+
+    // Not found with the shared lock, so get the exclusive lock to
+    // allocate it.  Another thread may have done so in the meantime.
+    QWriteLocker locker(&sLock);
     int idx = sIndexHash.value(nm, -1);
     if (idx==-1)					// nothing allocated yet
     {
         idx = sIndexHash.count();			// next integer value
         sIndexHash.insert(nm, idx);
+        sNameVector.append(nm);				// record reverse mapping
+        sQualifiedNames.append(QByteArray());		// not generated yet
         qDebug() << "allocated index" << idx << "for" << nm;
 
         // See if this name belongs to our application namespace.
@@ -91,31 +177,47 @@ int DataIndexer::index(const QByteArray &nm)
 
 QByteArray DataIndexer::name(int idx)
 {
-    return (sIndexHash.key(idx));
+    if (idx>=0 && idx<DataIndexer::IndexKnownCount) return (sKnownNameArray[idx]);
+
+    QReadLocker locker(&sLock);
+    return (sNameVector.value(idx));			// performs the bounds checking
 }
 
 
 int DataIndexer::indexWithNamespace(const QByteArray &nm, const QByteArray &nsp)
 {
     const int idx = index(nm);				// look up index as before
-    const QByteArray &curnsp = sNamespaceHash.value(idx);
-							// get existing namespace
-    if (curnsp.isEmpty())				// no existing namespace
-    {
-        if (!nsp.isEmpty())				// and a new one provided
-        {
-            sNamespaceHash.insert(idx, nsp);
-            qDebug() << "associated namespace" << nsp << "for tag" << nm;
-        }
-    }
-    else						// there is an existing namespace
+
+    // This is called for every extension element in a file, so in the
+    // usual case where the namespace is already associated (or none
+    // is provided) only a shared lock is needed.
     {
-        if (nsp!=curnsp)				// if not the same as current
+        QReadLocker locker(&sLock);
+        const QByteArray curnsp = sNamespaceHash.value(idx);
+							// get existing namespace
+        if (nsp.isEmpty() || nsp==curnsp) return (idx);	// nothing to change
+        if (!curnsp.isEmpty())				// a different existing one
         {						// then ignore the new namespace
             qWarning() << "ignoring namespace" << nsp << "because tag" << nm << "already has" << curnsp;
+            return (idx);
         }
     }
 
+    // No existing namespace, so get the exclusive lock to associate it.
+    // Another thread may have done so in the meantime.
+    QWriteLocker locker(&sLock);
+    const QByteArray curnsp = sNamespaceHash.value(idx);
+    if (curnsp.isEmpty())				// still no existing namespace
+    {
+        sNamespaceHash.insert(idx, nsp);
+        sQualifiedNames[idx] = QByteArray();		// regenerate when next needed
+        qDebug() << "associated namespace" << nsp << "for tag" << nm;
+    }
+    else if (nsp!=curnsp)				// associated by another thread
+    {
+        qWarning() << "ignoring namespace" << nsp << "because tag" << nm << "already has" << curnsp;
+    }
+
     return (idx);
 }
 
@@ -137,17 +239,37 @@ QByteArray DataIndexer::nameWithNamespace(const QByteArray &nm)
 
 QByteArray DataIndexer::nameWithNamespace(int idx)
 {
-    const QByteArray &nm = name(idx);			// plain name for index
-    const QByteArray &nsp = sNamespaceHash.value(idx);	// get existing namespace
+    {
+        QReadLocker locker(&sLock);
+        if (idx<0 || idx>=sQualifiedNames.count()) return (QByteArray());
+        const QByteArray &qnm = sQualifiedNames.at(idx);
+        if (!qnm.isNull()) return (qnm);		// already generated
+    }
 
-    if (nsp.isEmpty()) return (nm);			// no associated namespace
-    return (nsp+':'+nm);				// name with namespace
+    QWriteLocker locker(&sLock);
+    QByteArray &qnm = sQualifiedNames[idx];		// cached name with namespace
+    if (qnm.isNull())					// not generated yet
+    {
+        const QByteArray &nm = sNameVector.at(idx);	// plain name for index
+        const QByteArray &nsp = sNamespaceHash.value(idx);
+							// get existing namespace
+        if (nsp.isEmpty()) qnm = nm;			// no associated namespace
+        else qnm = nsp+':'+nm;				// name with namespace
+    }
+
+    return (qnm);
 }
 
 
 bool DataIndexer::isApplicationTag(const QByteArray &nm)
 {
-    const int idx = index(nm);				// look up index
+    return (isApplicationTag(index(nm)));
+}
+
+
+bool DataIndexer::isApplicationTag(int idx)
+{
+    QReadLocker locker(&sLock);
     const QByteArray &nsp = sNamespaceHash.value(idx);	// get existing namespace
     return (nsp==sApplicationNamespace);		// check whether it is our own
 }
@@ -161,12 +283,14 @@ QByteArray DataIndexer::applicationNamespace()
 
 int DataIndexer::count()
 {
-    return (sIndexHash.count());
+    QReadLocker locker(&sLock);
+    return (sNameVector.count());
 }
 
 
 void DataIndexer::setUriForNamespace(const QByteArray &nsp, const QByteArray &namespaceURI)
 {
+    QWriteLocker locker(&sLock);
     if (sUriHash.contains(nsp))				// see if already associated
     {
         const QByteArray &curURI = sUriHash[nsp];	// duplication should never happen
@@ -181,11 +305,13 @@ void DataIndexer::setUriForNamespace(const QByteArray &nsp, const QByteArray &na
 
 QByteArray DataIndexer::uriForNamespace(const QByteArray &nsp)
 {
+    QReadLocker locker(&sLock);
     return (sUriHash.value(nsp));
 }
 
 
 QList<QByteArray> DataIndexer::namespacesWithUri()
 {
+    QReadLocker locker(&sLock);
     return (sUriHash.keys());
 }
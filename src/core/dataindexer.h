@@ -48,11 +48,55 @@ class QByteArray;
  * XML namespaces, either for known tags or "learned" while importing, are
  * automatically associated with the names to which they apply.
  *
+ * All of the functions are thread safe, so that files can be imported
+ * or data processed in worker threads.  Looking up an existing name or
+ * index only needs a shared lock, and the names of the fixed indexes
+ * below can be obtained without any locking at all.  Only allocating
+ * a new index or associating a namespace needs an exclusive lock.
+ *
  * @author Jonathan Marten
  **/
 
 namespace DataIndexer
 {
+    /**
+     * Fixed indexes for names which are used internally by the application
+     * or are commonly found in GPX files.  These are allocated before any
+     * other names, so that they can be used as constants instead of looking
+     * up the name each time.  The names are as commented.
+     **/
+    enum KnownIndex
+    {
+        IndexName = 0,					// "name"
+        IndexLatitude,					// "latitude"
+        IndexLongitude,					// "longitude"
+        IndexEle,					// "ele"
+        IndexTime,					// "time"
+        IndexSpeed,					// "speed"
+        IndexHdop,					// "hdop"
+        IndexHeading,					// "heading"
+        IndexDesc,					// "desc"
+        IndexType,					// "type"
+        IndexCategory,					// "category"
+        IndexColor,					// "color"
+        IndexLink,					// "link"
+        IndexMedia,					// "media"
+        IndexCreator,					// "creator"
+        IndexVersion,					// "version"
+        IndexTimezone,					// "timezone"
+        IndexPosition,					// "position"
+        IndexDuration,					// "duration"
+        IndexStatus,					// "status"
+        IndexSource,					// "source"
+        IndexStop,					// "stop"
+        IndexFolder,					// "folder"
+        IndexLinecolor,					// "linecolor"
+        IndexPointcolor,				// "pointcolor"
+        IndexBearingline,				// "bearingline"
+        IndexRangering,					// "rangering"
+        IndexKnownCount					// must be last
+    };
+
     /**
      * Get the index for an attribute or element name, allocating it if necessary.
      *
@@ -66,6 +110,9 @@ namespace DataIndexer
      *
      * @param idx The index
      * @return the allocated name, or a null string if the index is not allocated
+     *
+     * @note This does not need to search, so is efficient to call for
+     * every index.
      **/
     QByteArray name(int idx);
 
@@ -127,6 +174,14 @@ namespace DataIndexer
      **/
     bool isApplicationTag(const QByteArray &nm);
 
+    /**
+     * Check whether the tag should be in our application namespace.
+     *
+     * @param idx The index
+     * @return @c true if the name should be namespaced as such
+     **/
+    bool isApplicationTag(int idx);
+
     /**
      * Get our application namespace name
      *
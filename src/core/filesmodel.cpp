@@ -35,6 +35,9 @@
 #include <kcolorscheme.h>
 
 #include "trackdata.h"
+#include "dataindexer.h"
+#include "pointindex.h"
+#include "timeindex.h"
 
 
 enum COLUMN
@@ -53,6 +56,11 @@ FilesModel::FilesModel(QObject *pnt)
 {
     qDebug();
     mRootFileItem = nullptr;
+    mPointIndex = nullptr;
+    mPointIndexValid = false;
+    mPointIndexLoads = 0;
+    mTimeIndex = nullptr;
+    mTimeIndexValid = false;
 
     // Drag and drop depends on being able to encode and serialise a pointer.
     Q_ASSERT(sizeof(TrackDataItem *)<=sizeof(qulonglong));
@@ -62,6 +70,8 @@ FilesModel::FilesModel(QObject *pnt)
 FilesModel::~FilesModel()
 {
     delete mRootFileItem;
+    delete mPointIndex;
+    delete mTimeIndex;
     qDebug() << "done";
 }
 
@@ -150,7 +160,7 @@ case Qt::ForegroundRole:
         switch (idx.column())
         {
 case COL_NAME:
-            QVariant status = tdi->metadata("status");
+            QVariant status = tdi->metadata(DataIndexer::IndexStatus);
             if (!status.isNull())
             {
                 TrackData::WaypointStatus s = static_cast<TrackData::WaypointStatus>(status.toInt());
@@ -177,32 +187,32 @@ case COL_NAME:
             {
                 QString tip;
 
-                if (dynamic_cast<const TrackDataFolder *>(tdi)!=nullptr) tip = i18np("Folder with %1 item", "Folder with %1 items", tdi->childCount());
-                else if (dynamic_cast<const TrackDataTrack *>(tdi)!=nullptr) tip = i18np("Track with %1 segment", "Track with %1 segments", tdi->childCount());
-                else if (dynamic_cast<const TrackDataSegment *>(tdi)!=nullptr) tip = i18np("Segment with %1 point", "Segment with %1 points", tdi->childCount());
-                else if (dynamic_cast<const TrackDataRoute *>(tdi)!=nullptr) tip = i18np("Route with %1 point", "Route with %1 points", tdi->childCount());
+                if (TrackData::cast<TrackDataFolder>(tdi)!=nullptr) tip = i18np("Folder with %1 item", "Folder with %1 items", tdi->childCount());
+                else if (TrackData::cast<TrackDataTrack>(tdi)!=nullptr) tip = i18np("Track with %1 segment", "Track with %1 segments", tdi->childCount());
+                else if (TrackData::cast<TrackDataSegment>(tdi)!=nullptr) tip = i18np("Segment with %1 point", "Segment with %1 points", tdi->childCount());
+                else if (TrackData::cast<TrackDataRoute>(tdi)!=nullptr) tip = i18np("Route with %1 point", "Route with %1 points", tdi->childCount());
                 else
                 {
-                    const TrackDataFile *tdf = dynamic_cast<const TrackDataFile *>(tdi);
+                    const TrackDataFile *tdf = TrackData::cast<TrackDataFile>(tdi);
                     if (tdf!=nullptr) tip = i18np("File %2 with %1 item", "File %2 with %1 items", tdf->childCount(), tdf->fileName().toDisplayString());
                     else
                     {
-                        const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(tdi);
-                        if (dynamic_cast<const TrackDataTrackpoint *>(tdp)!=nullptr) tip = i18n("Point at %1, elevation %2", tdp->formattedTime(true), tdp->formattedElevation());
-                        else if (dynamic_cast<const TrackDataWaypoint *>(tdp)!=nullptr)
+                        const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(tdi);
+                        if (TrackData::cast<TrackDataTrackpoint>(tdp)!=nullptr) tip = i18n("Point at %1, elevation %2", tdp->formattedTime(true), tdp->formattedElevation());
+                        else if (TrackData::cast<TrackDataWaypoint>(tdp)!=nullptr)
                         {
                             const QString wptStatus = TrackData::formattedWaypointStatus(
-                                static_cast<TrackData::WaypointStatus>(tdi->metadata("status").toInt()), true);
+                                static_cast<TrackData::WaypointStatus>(tdi->metadata(DataIndexer::IndexStatus).toInt()), true);
                             if (!wptStatus.isEmpty()) tip = i18n("Waypoint at %1, elevation %2 (%3)", tdp->formattedTime(true), tdp->formattedElevation(), wptStatus);
                             else tip = i18n("Waypoint at %1, elevation %2", tdp->formattedTime(true), tdp->formattedElevation());
                         }
-                        else if (dynamic_cast<const TrackDataRoutepoint *>(tdp)!=nullptr) tip = i18n("Routepoint, elevation %1", tdp->formattedElevation());
+                        else if (TrackData::cast<TrackDataRoutepoint>(tdp)!=nullptr) tip = i18n("Routepoint, elevation %1", tdp->formattedElevation());
                     }
                 }
 
                 if (!tip.isEmpty())
                 {
-                    QString desc = tdi->metadata("desc").toString();
+                    QString desc = tdi->metadata(DataIndexer::IndexDesc).toString();
                     if (!desc.isEmpty())
                     {
                         desc.replace('\n', ";&nbsp;");
@@ -241,6 +251,7 @@ TrackDataFile *FilesModel::takeRootFileItem()
     Q_ASSERT(root!=nullptr);
     beginResetModel();
     mRootFileItem = nullptr;
+    invalidateIndexes();
     endResetModel();
     qDebug() << "removing root" << root->name();
     return (root);
@@ -253,17 +264,45 @@ void FilesModel::setRootFileItem(TrackDataFile *root)
     beginResetModel();
     qDebug() << "setting root" << root->name();
     mRootFileItem = root;
+    invalidateIndexes();
     endResetModel();
 }
 
 
 void FilesModel::changedItem(const TrackDataItem *item)
 {
+    // The item may be a point that has been moved or retimed.  A moved
+    // point can simply be refiled in the point index, but the time index
+    // will need to be rebuilt when it is next used.
+    const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item);
+    if (tdp!=nullptr && mPointIndexValid) mPointIndex->update(tdp);
+    mTimeIndexValid = false;
+
     QModelIndex idx = indexForItem(item);
     emit dataChanged(idx, idx);
 }
 
 
+void FilesModel::addedItem(const TrackDataItem *item)
+{
+    // The item, which may be a point or a container of them, has been
+    // added to the data tree.  This is reported by the undo commands
+    // within a layout change, after the tree has been changed.
+    if (mPointIndexValid) mPointIndex->insertAll(item);
+    mTimeIndexValid = false;
+}
+
+
+void FilesModel::removedItem(const TrackDataItem *item)
+{
+    // The item, which may be a point or a container of them, has been
+    // removed from the data tree.  It must be reported before it is
+    // deleted.
+    if (mPointIndexValid) mPointIndex->removeAll(item);
+    mTimeIndexValid = false;
+}
+
+
 void FilesModel::startLayoutChange()
 {
     emit layoutAboutToBeChanged();
@@ -272,10 +311,49 @@ void FilesModel::startLayoutChange()
 
 void FilesModel::endLayoutChange()
 {
+    // Items may have been moved around within the tree, which does not
+    // affect the point index.  Any items added or removed will have been
+    // reported separately.
+    mTimeIndexValid = false;
     emit layoutChanged();
 }
 
 
+void FilesModel::invalidateIndexes()
+{
+    mPointIndexValid = false;
+    mTimeIndexValid = false;
+}
+
+
+const PointIndex *FilesModel::pointIndex() const
+{
+    if (mPointIndex==nullptr) mPointIndex = new PointIndex;
+    // The index does not include deferred points, so it also needs
+    // to be rebuilt if any of them have been loaded since.
+    const int loads = TrackData::deferredLoadCount();
+    if (!mPointIndexValid || loads!=mPointIndexLoads)	// rebuild after changes
+    {
+        mPointIndex->build(mRootFileItem);
+        mPointIndexValid = true;
+        mPointIndexLoads = loads;
+    }
+    return (mPointIndex);
+}
+
+
+const TimeIndex *FilesModel::timeIndex() const
+{
+    if (mTimeIndex==nullptr) mTimeIndex = new TimeIndex;
+    if (!mTimeIndexValid)				// rebuild after changes
+    {
+        mTimeIndex->build(mRootFileItem);
+        mTimeIndexValid = true;
+    }
+    return (mTimeIndex);
+}
+
+
 void FilesModel::clickedPoint(const TrackDataAbstractPoint *tdp, Qt::KeyboardModifiers mods)
 {
     QItemSelectionModel::SelectionFlags selFlags;
@@ -422,25 +500,25 @@ bool FilesModel::dropMimeDataInternal(bool doit, const QMimeData *data, int row,
 
     // See what sort of item is being dragged, and then whether it
     // is allowed to be dropped at the destination location.
-    const bool toTopLevel = (dynamic_cast<const TrackDataFile *>(ontoParent)!=nullptr);
-    const bool toFolder = (dynamic_cast<const TrackDataFolder *>(ontoParent)!=nullptr);
+    const bool toTopLevel = (TrackData::cast<TrackDataFile>(ontoParent)!=nullptr);
+    const bool toFolder = (TrackData::cast<TrackDataFolder>(ontoParent)!=nullptr);
 
     // A folder can only be dropped at the top level or inside another folder.
-    if (dynamic_cast<const TrackDataFolder *>(sourceItem)!=nullptr)
+    if (TrackData::cast<TrackDataFolder>(sourceItem)!=nullptr)
     {
         if (!toTopLevel && !toFolder) return (false);
     }
 
     // A track or route can only be dropped at the top level.
-    else if (dynamic_cast<const TrackDataTrack *>(sourceItem)!=nullptr ||
-             dynamic_cast<const TrackDataRoute *>(sourceItem)!=nullptr)
+    else if (TrackData::cast<TrackDataTrack>(sourceItem)!=nullptr ||
+             TrackData::cast<TrackDataRoute>(sourceItem)!=nullptr)
     {
         if (!toTopLevel) return (false);
     }
 
     // A segment is not allowed to be dragged.  This should be enforced by the
     // "Move Mode" action not being enabled in MainWindow::slotUpdateActionState().
-    else if (dynamic_cast<const TrackDataSegment *>(sourceItem)!=nullptr)
+    else if (TrackData::cast<TrackDataSegment>(sourceItem)!=nullptr)
     {
         return (false);
     }
@@ -455,21 +533,21 @@ bool FilesModel::dropMimeDataInternal(bool doit, const QMimeData *data, int row,
     // in time order within the file.  Allowing tracks to be moved around
     // breaks this, but it is unusual to want to perform those operations
     // over multiple tracks and so it is allowed for presentation purposes.
-    else if (dynamic_cast<const TrackDataTrackpoint *>(sourceItem)!=nullptr)
+    else if (TrackData::cast<TrackDataTrackpoint>(sourceItem)!=nullptr)
     {
         return (false);
     }
 
     // A waypoint can only be dropped into a folder.
-    else if (dynamic_cast<const TrackDataWaypoint *>(sourceItem)!=nullptr)
+    else if (TrackData::cast<TrackDataWaypoint>(sourceItem)!=nullptr)
     {
         if (!toFolder) return (false);
     }
 
     // A route point can only be dropped into a route.
-    else if (dynamic_cast<const TrackDataRoutepoint *>(sourceItem)!=nullptr)
+    else if (TrackData::cast<TrackDataRoutepoint>(sourceItem)!=nullptr)
     {
-        if (dynamic_cast<const TrackDataRoute *>(ontoParent)==nullptr) return (false);
+        if (TrackData::cast<TrackDataRoute>(ontoParent)==nullptr) return (false);
     }
 
     // If the drag and drop is within the same parent container, check that
@@ -33,6 +33,8 @@ class FilesController;
 class TrackDataItem;
 class TrackDataFile;
 class TrackDataAbstractPoint;
+class PointIndex;
+class TimeIndex;
 
 
 class FilesModel : public QAbstractItemModel
@@ -64,8 +66,14 @@ public:
 
     void clickedPoint(const TrackDataAbstractPoint *tdp, Qt::KeyboardModifiers mods);
 
+    // indexes of all points, updated or rebuilt as necessary after changes
+    const PointIndex *pointIndex() const;
+    const TimeIndex *timeIndex() const;
+
     // signal changes from the model
     void changedItem(const TrackDataItem *item);
+    void addedItem(const TrackDataItem *item);
+    void removedItem(const TrackDataItem *item);
     void startLayoutChange();
     void endLayoutChange();
 
@@ -79,9 +87,16 @@ signals:
 
 private:
     bool dropMimeDataInternal(bool doit, const QMimeData *data, int row, const QModelIndex &pnt);
+    void invalidateIndexes();
 
 private:
     TrackDataFile *mRootFileItem;
+
+    mutable PointIndex *mPointIndex;
+    mutable bool mPointIndexValid;
+    mutable int mPointIndexLoads;			// deferred load count when built
+    mutable TimeIndex *mTimeIndex;
+    mutable bool mTimeIndexValid;
 };
  
 #endif							// FILESMODEL_H
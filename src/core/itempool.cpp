@@ -0,0 +1,252 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "itempool.h"
+
+#include <new>
+#include <cstddef>
+#include <algorithm>
+
+#include <qdebug.h>
+#include <qatomic.h>
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Debugging switches							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#undef DEBUG_POOL
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  ItemPool								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// The maximum number of pools that can have a cache in each thread.
+// Any more than this are still usable, but always lock the pool.
+static const int MAX_CACHED_POOLS = 4;
+
+static QAtomicInt sPoolCount(0);			// for allocating pool index
+
+
+ItemPool::ItemPool(size_t itemSize, int itemsPerChunk)
+{
+    // Each free object must be able to hold the free list link, and
+    // be suitably aligned for any object type.
+    const size_t align = alignof(std::max_align_t);
+    mItemSize = qMax(itemSize, sizeof(FreeItem));
+    mItemSize = ((mItemSize+align-1)/align)*align;
+
+    mItemsPerChunk = itemsPerChunk;
+    mIndex = sPoolCount.fetchAndAddRelaxed(1);
+    mFirstFree = 0;
+    mEmptyChunks = 0;
+    mAllocated = 0;
+}
+
+
+ItemPool::~ItemPool()
+{
+    // If there are still objects allocated, they may be deleted
+    // later on during program exit.  So leave the memory allocated.
+    if (mAllocated>0) qWarning() << mAllocated << "objects still allocated, size" << mItemSize;
+    else releaseChunks();
+}
+
+
+int ItemPool::count() const
+{
+    QMutexLocker locker(&mMutex);
+    return (mAllocated);
+}
+
+
+// The cache for this pool in the current thread, or null if it cannot
+// have one.  The caches are destroyed when the thread exits, returning
+// any items still held to their pools.  For the main thread this happens
+// before any static pool is destroyed.
+
+ItemPool::LocalCache *ItemPool::localCache()
+{
+    static thread_local LocalCache caches[MAX_CACHED_POOLS];
+
+    if (mIndex>=MAX_CACHED_POOLS) return (nullptr);
+    LocalCache *lc = &caches[mIndex];
+    if (lc->pool==nullptr) lc->pool = this;		// first use in this thread
+    return (lc);
+}
+
+
+ItemPool::LocalCache::~LocalCache()
+{
+    if (pool==nullptr || count==0) return;		// never used, or empty
+
+    QMutexLocker locker(&pool->mMutex);
+    while (count>0) pool->returnItem(items[--count]);
+}
+
+
+void *ItemPool::allocate(size_t size)
+{
+    if (size>mItemSize) return (::operator new(size));	// not for this pool
+
+    LocalCache *lc = localCache();
+    if (lc==nullptr)					// no cache available
+    {
+        QMutexLocker locker(&mMutex);
+        return (takeItem());
+    }
+
+    if (lc->count==0)					// need to refill cache
+    {
+        QMutexLocker locker(&mMutex);
+        // Fill in reverse order, so that consecutively allocated
+        // objects will be in ascending address order.
+        const int num = sizeof(lc->items)/sizeof(lc->items[0]);
+        for (int i = num-1; i>=0; --i) lc->items[i] = takeItem();
+        lc->count = num;
+    }
+
+    return (lc->items[--lc->count]);
+}
+
+
+void ItemPool::deallocate(void *ptr, size_t size)
+{
+    if (ptr==nullptr) return;				// nothing to do
+    if (size>mItemSize)					// not from this pool
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    // Freed objects are returned to their chunk straight away, so
+    // that the chunk can be released as soon as it is empty.  Objects
+    // are normally freed by the GUI thread, so this does not hold up
+    // any loading threads for long.
+    QMutexLocker locker(&mMutex);
+    returnItem(ptr);
+}
+
+
+// Take a free object from the lowest chunk which has one, allocating
+// a new chunk if there are none.  The mutex must be locked.
+
+void *ItemPool::takeItem()
+{
+    while (mFirstFree<mChunks.count() && mChunks.at(mFirstFree).freeList==nullptr) ++mFirstFree;
+
+    if (mFirstFree==mChunks.count())			// need to allocate a new chunk
+    {
+#ifdef DEBUG_POOL
+        qDebug() << "new chunk for size" << mItemSize << "existing" << mChunks.count();
+#endif
+        char *memory = static_cast<char *>(::operator new(mItemSize*mItemsPerChunk));
+
+        // Link the objects in the new chunk into its free list, in
+        // ascending address order so that consecutively allocated
+        // objects will be adjacent in memory.
+        FreeItem *freeList = nullptr;
+        for (int i = mItemsPerChunk-1; i>=0; --i)
+        {
+            FreeItem *item = reinterpret_cast<FreeItem *>(memory+i*mItemSize);
+            item->next = freeList;
+            freeList = item;
+        }
+
+        const auto it = std::lower_bound(mChunks.begin(), mChunks.end(), memory,
+                                         [](const Chunk &c, const char *m) { return (c.memory<m); });
+        mFirstFree = it-mChunks.begin();
+        mChunks.insert(mFirstFree, { memory, freeList, 0 });
+        ++mEmptyChunks;
+    }
+
+    Chunk &chunk = mChunks[mFirstFree];
+    if (chunk.used==0) --mEmptyChunks;			// no longer empty
+
+    FreeItem *item = chunk.freeList;			// take first free object
+    chunk.freeList = item->next;
+    ++chunk.used;
+    ++mAllocated;
+    return (item);
+}
+
+
+// Return an object to the chunk that it came from.  The mutex must
+// be locked.
+
+void ItemPool::returnItem(void *ptr)
+{
+    // Find the last chunk starting at or before the object
+    const char *p = static_cast<const char *>(ptr);
+    const auto it = std::upper_bound(mChunks.begin(), mChunks.end(), p,
+                                     [](const char *m, const Chunk &c) { return (m<c.memory); });
+    Q_ASSERT(it!=mChunks.begin());
+    const int idx = (it-mChunks.begin())-1;
+    Chunk &chunk = mChunks[idx];
+    Q_ASSERT(p<chunk.memory+mItemSize*mItemsPerChunk);
+
+    FreeItem *item = static_cast<FreeItem *>(ptr);	// return to free list
+    item->next = chunk.freeList;
+    chunk.freeList = item;
+    --chunk.used;
+    --mAllocated;
+    Q_ASSERT(chunk.used>=0 && mAllocated>=0);
+
+    if (idx<mFirstFree) mFirstFree = idx;		// lowest with free now
+    if (chunk.used==0)					// chunk is now empty
+    {
+        // Keep one empty chunk, so that allocating and freeing an
+        // object repeatedly does not allocate and release a chunk
+        // each time.
+        if (mEmptyChunks>0) releaseChunk(idx);
+        else ++mEmptyChunks;
+    }
+}
+
+
+void ItemPool::releaseChunk(int idx)
+{
+#ifdef DEBUG_POOL
+    qDebug() << "releasing chunk" << idx << "of" << mChunks.count() << "for size" << mItemSize;
+#endif
+    ::operator delete(mChunks.at(idx).memory);
+    mChunks.remove(idx);
+    if (mFirstFree>idx) --mFirstFree;
+}
+
+
+void ItemPool::releaseChunks()
+{
+#ifdef DEBUG_POOL
+    qDebug() << "releasing" << mChunks.count() << "chunks for size" << mItemSize;
+#endif
+    for (const Chunk &chunk : qAsConst(mChunks)) ::operator delete(chunk.memory);
+    mChunks.clear();
+    mFirstFree = 0;
+    mEmptyChunks = 0;
+}
@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef ITEMPOOL_H
+#define ITEMPOOL_H
+
+#include <stddef.h>
+
+#include <qvector.h>
+#include <qmutex.h>
+
+
+/**
+ * @short A pool allocator for fixed size data items.
+ *
+ * A large track may contain hundreds of thousands of points, each of which
+ * is a separate object.  Allocating them individually from the general heap
+ * has a significant overhead in both time and memory, and the points of a
+ * segment are not necessarily allocated close together.
+ *
+ * This class allocates objects of a single size from large chunks of memory,
+ * each of which has its own free list.  It is intended to be used by a
+ * class-specific @c operator new and @c operator delete, so that the objects
+ * can be created and deleted as usual and there are no restrictions on which
+ * part of the data tree (or undo command container) owns them.  New objects
+ * are taken from the chunk with the lowest address that has any free, so
+ * that the objects in use tend to be packed into as few chunks as possible.
+ * When all of the objects in a chunk have been freed, for example when a
+ * file is closed, the chunk is released unless it is the only one that is
+ * empty.
+ *
+ * Allocation and freeing are thread safe.  So that threads loading files
+ * at the same time do not have to wait for each other for every object,
+ * each thread takes free objects in batches into a small cache of its own,
+ * and allocates from that.  A chunk cannot be released while any of its
+ * objects are in such a cache, but the number of these is limited.
+ *
+ * There is one pool for each type of object, shared by all files, rather
+ * than a separate arena for each file.  Items can move between files
+ * (by importing or by drag and drop) and into undo commands, so there is
+ * no single owner which could release a whole arena at once.  Closing a
+ * file therefore frees its objects one at a time, each of which takes
+ * the pool lock and a binary search of the chunk list.
+ *
+ * @author Jonathan Marten
+ **/
+
+class ItemPool
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param itemSize The size of each object to be allocated
+     * @param itemsPerChunk The number of objects in each allocated chunk
+     **/
+    explicit ItemPool(size_t itemSize, int itemsPerChunk = 4096);
+
+    /**
+     * Destructor.
+     *
+     * @note If there are any objects still allocated from the pool,
+     * then its memory is not released.
+     **/
+    ~ItemPool();
+
+    /**
+     * Allocate an object from the pool.
+     *
+     * @param size The size of the object required.  If this is
+     * not the same as the size of the pool, for example for a
+     * derived class, then the object is allocated from the heap.
+     * @return the allocated memory
+     **/
+    void *allocate(size_t size);
+
+    /**
+     * Return an object to the pool.
+     *
+     * @param ptr The object to free, which must have been allocated
+     * by @c allocate() on the same pool.
+     * @param size The size of the object as passed to @c allocate().
+     **/
+    void deallocate(void *ptr, size_t size);
+
+    /**
+     * Get the number of objects currently allocated from the pool.
+     *
+     * @return the number of objects, including those which are
+     * free but held in the cache of a thread
+     **/
+    int count() const;
+
+private:
+    ItemPool(const ItemPool &other) = delete;
+    ItemPool &operator=(const ItemPool &other) = delete;
+
+    struct FreeItem
+    {
+        FreeItem *next;
+    };
+
+    struct Chunk
+    {
+        char *memory;					// start of chunk memory
+        FreeItem *freeList;				// free objects within it
+        int used;					// number not free
+    };
+
+    struct LocalCache
+    {
+        ~LocalCache();
+
+        ItemPool *pool = nullptr;			// pool that this is for
+        int count = 0;					// number of items held
+        void *items[32];				// free items available
+    };
+
+    LocalCache *localCache();
+    void *takeItem();
+    void returnItem(void *ptr);
+    void releaseChunk(int idx);
+    void releaseChunks();
+
+    size_t mItemSize;
+    int mItemsPerChunk;
+    int mIndex;						// index for local cache
+    QVector<Chunk> mChunks;				// sorted by address
+    int mFirstFree;					// lowest that may have free
+    int mEmptyChunks;					// number with none used
+    int mAllocated;
+    mutable QMutex mMutex;
+};
+
+#endif							// ITEMPOOL_H
@@ -63,12 +63,12 @@ MetadataModel::MetadataModel(const TrackDataItem *item, QObject *pnt)
     // used anywhere outside of this model.  If any are added here then
     // they also need to be ignored in isInternaltag() below.  Any checks
     // for these names elsewhere must use isInternalTag().
-    mItemData[DataIndexer::index("name")] = item->name();
-    const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(item);
+    mItemData[DataIndexer::IndexName] = item->name();
+    const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item);
     if (tdp!=nullptr)
     {
-        mItemData[DataIndexer::index("latitude")] = tdp->latitude();
-        mItemData[DataIndexer::index("longitude")] = tdp->longitude();
+        mItemData[DataIndexer::IndexLatitude] = tdp->latitude();
+        mItemData[DataIndexer::IndexLongitude] = tdp->longitude();
     }
 
     // The default time zone to use is that appropriate for the reference item,
@@ -88,6 +88,12 @@ MetadataModel::MetadataModel(const TrackDataItem *item, QObject *pnt)
 }
 
 
+/* static */ bool MetadataModel::isInternalTag(int idx)
+{
+    return (idx==DataIndexer::IndexName || idx==DataIndexer::IndexLatitude || idx==DataIndexer::IndexLongitude);
+}
+
+
 MetadataModel::~MetadataModel()
 {
     delete mTimeZone;
@@ -181,7 +187,7 @@ void MetadataModel::setData(int idx, const QVariant &value)
     mItemData[idx] = TrackData::valueOrNull(value);
     mItemChanged[idx] = true;
 
-    if (idx==DataIndexer::index("timezone")) resolveTimeZone();
+    if (idx==DataIndexer::IndexTimezone) resolveTimeZone();
 							// update time zone data
     emit metadataChanged(idx);				// signal that data changed
 }
@@ -189,14 +195,14 @@ void MetadataModel::setData(int idx, const QVariant &value)
 
 double MetadataModel::latitude() const
 {
-    const QVariant &v = data(DataIndexer::index("latitude"));
+    const QVariant &v = data(DataIndexer::IndexLatitude);
     return (!v.isNull() ? v.toDouble() : NAN);
 }
 
 
 double MetadataModel::longitude() const
 {
-    const QVariant &v = data(DataIndexer::index("longitude"));
+    const QVariant &v = data(DataIndexer::IndexLongitude);
     return (!v.isNull() ? v.toDouble() : NAN);
 }
 
@@ -224,7 +230,7 @@ case COL_VALUE:	return (i18nc("@title:column", "Value"));
 
 void MetadataModel::resolveTimeZone()
 {
-    QString name = data("timezone").toString();
+    QString name = data(DataIndexer::IndexTimezone).toString();
     qDebug() << "zone from metadata" << name;
 
     // The time zone used is either the "timezone" from this item's metadata,
@@ -64,6 +64,14 @@ public:
      **/
     static bool isInternalTag(const QByteArray &nm);
 
+    /**
+     * Check whether the tag is internal to this application only.
+     *
+     * @param idx The index of the tag
+     * @return @c true if this is an internal tag
+     **/
+    static bool isInternalTag(int idx);
+
 signals:
     void metadataChanged(int idx);
 
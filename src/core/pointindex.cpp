@@ -0,0 +1,460 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pointindex.h"
+
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+
+#include <qdebug.h>
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Debugging switches							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#undef DEBUG_INDEX
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Constants								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// The number of points aimed for in each occupied cell.
+static const int pointsPerCell = 16;
+
+// Limits for the cell size, in degrees.  The lower limit is about 10 metres.
+static const double minCellSize = 0.0001;
+static const double maxCellSize = 1.0;
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Helper functions							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// Bring a longitude into the range -180 (inclusive) to +180 (exclusive).
+static double normaliseLongitude(double lon)
+{
+    return (lon-360.0*floor((lon+180.0)/360.0));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Collecting points from the data tree				//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+template<class E>
+class PointIndexCollector : public TrackDataVisitor
+{
+public:
+    explicit PointIndexCollector(QVector<E> *entries)	: mEntries(entries) {}
+
+    // Points which have not been loaded yet cannot have been drawn
+    // on the map, so there is no need to load them for the index.
+    bool visitSegment(const TrackDataSegment *item) override		{ return (!item->hasDeferredChildren()); }
+
+    void visitTrackpoint(const TrackDataTrackpoint *item) override	{ addPoint(item); }
+    void visitWaypoint(const TrackDataWaypoint *item) override		{ addPoint(item); }
+    void visitRoutepoint(const TrackDataRoutepoint *item) override	{ addPoint(item); }
+
+private:
+    void addPoint(const TrackDataAbstractPoint *tdp)
+    {
+        mEntries->append({ tdp, tdp->latitude(), tdp->longitude() });
+    }
+
+private:
+    QVector<E> *mEntries;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Building the index							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+PointIndex::PointIndex()
+{
+    clear();
+}
+
+
+void PointIndex::clear()
+{
+    mCells.clear();
+    mCellKeys.clear();
+    mCellSize = maxCellSize;
+    mHalfCols = static_cast<int>(ceil(180.0/mCellSize));
+    mRowMin = mColMin = 0;
+    mRowMax = mColMax = -1;
+    mCount = 0;
+}
+
+
+void PointIndex::build(const TrackDataItem *root)
+{
+    QVector<Entry> entries;
+    if (root!=nullptr)
+    {
+        PointIndexCollector<Entry> collector(&entries);
+        TrackData::visit(root, &collector);
+    }
+    buildFrom(entries);
+}
+
+
+void PointIndex::build(const QVector<const TrackDataAbstractPoint *> &points)
+{
+    QVector<Entry> entries;
+    entries.reserve(points.count());
+    for (const TrackDataAbstractPoint *tdp : points) entries.append({ tdp, tdp->latitude(), tdp->longitude() });
+    buildFrom(entries);
+}
+
+
+int PointIndex::cellRow(double lat) const
+{
+    return (static_cast<int>(floor(lat/mCellSize)));
+}
+
+
+int PointIndex::cellCol(double lon) const
+{
+    // The longitude is expected to be within the range -180 to +180.
+    // The limits allow for +180 itself and for any rounding error.
+    return (qBound(-mHalfCols, static_cast<int>(floor(lon/mCellSize)), mHalfCols-1));
+}
+
+
+void PointIndex::addEntry(const Entry &e)
+{
+    const double lon = normaliseLongitude(e.lon);
+    const int row = cellRow(e.lat);
+    const int col = cellCol(lon);
+    const quint64 key = cellKey(row, col);
+
+    mCells[key].append({ e.point, e.lat, lon });
+    mCellKeys.insert(e.point, key);			// note cell for removing later
+
+    if (mCount==0)					// first point in index
+    {
+        mRowMin = mRowMax = row;
+        mColMin = mColMax = col;
+    }
+    else
+    {
+        mRowMin = qMin(mRowMin, row); mRowMax = qMax(mRowMax, row);
+        mColMin = qMin(mColMin, col); mColMax = qMax(mColMax, col);
+    }
+    ++mCount;
+}
+
+
+void PointIndex::buildFrom(const QVector<Entry> &entries)
+{
+    clear();
+
+    // Find the extent of the valid points, in order to decide on the
+    // cell size.
+    double latMin = 90.0, latMax = -90.0;
+    double lonMin = 180.0, lonMax = -180.0;
+    int num = 0;
+    for (const Entry &e : entries)
+    {
+        if (ISNAN(e.lat) || ISNAN(e.lon)) continue;
+        latMin = qMin(latMin, e.lat); latMax = qMax(latMax, e.lat);
+        lonMin = qMin(lonMin, e.lon); lonMax = qMax(lonMax, e.lon);
+        ++num;
+    }
+    if (num==0) return;					// nothing to index
+
+    // Aim for the specified number of points in each cell, assuming that
+    // the points are evenly distributed over their extent.  They will not
+    // be (they are along tracks or routes), but this gives a reasonable
+    // starting point and the limits avoid extreme values.  The size is
+    // then rounded down so that a whole number of cells spans 180 degrees,
+    // so that the columns wrap around exactly at the date line.
+    const double area = qMax((latMax-latMin)*(lonMax-lonMin), minCellSize*minCellSize);
+    const double size = qBound(minCellSize, sqrt(area*pointsPerCell/num), maxCellSize);
+    mHalfCols = static_cast<int>(ceil(180.0/size));
+    mCellSize = 180.0/mHalfCols;
+
+    for (const Entry &e : entries)
+    {
+        if (ISNAN(e.lat) || ISNAN(e.lon)) continue;
+        addEntry(e);
+    }
+
+#ifdef DEBUG_INDEX
+    qDebug() << "indexed" << mCount << "points in" << mCells.count() << "cells, size" << mCellSize;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Updating the index							//
+//									//
+//  The cell that each point was filed in is remembered, so that it	//
+//  can be found again after the point has been moved.			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+void PointIndex::insert(const TrackDataAbstractPoint *tdp)
+{
+    remove(tdp);					// if it is already there
+    const Entry e = { tdp, tdp->latitude(), tdp->longitude() };
+    if (ISNAN(e.lat) || ISNAN(e.lon)) return;		// not a valid position
+    addEntry(e);
+}
+
+
+void PointIndex::remove(const TrackDataAbstractPoint *tdp)
+{
+    const auto it = mCellKeys.find(tdp);
+    if (it==mCellKeys.end()) return;			// not in the index
+    const quint64 key = it.value();
+    mCellKeys.erase(it);
+
+    auto cell = mCells.find(key);
+    Q_ASSERT(cell!=mCells.end());
+    QVector<Entry> &entries = cell.value();
+    for (int i = 0; i<entries.count(); ++i)
+    {
+        if (entries.at(i).point!=tdp) continue;
+        entries[i] = entries.last();			// order does not matter
+        entries.removeLast();
+        break;
+    }
+    if (entries.isEmpty()) mCells.erase(cell);
+
+    // The row and column limits are left as they are.  They may then
+    // be larger than necessary, which costs a little time in searching
+    // but does not affect the results.
+    --mCount;
+}
+
+
+void PointIndex::update(const TrackDataAbstractPoint *tdp)
+{
+    if (mCellKeys.contains(tdp)) insert(tdp);		// move to its new cell
+}
+
+
+void PointIndex::insertAll(const TrackDataItem *item)
+{
+    QVector<Entry> entries;
+    PointIndexCollector<Entry> collector(&entries);
+    TrackData::visit(item, &collector);
+    for (const Entry &e : qAsConst(entries)) insert(e.point);
+}
+
+
+void PointIndex::removeAll(const TrackDataItem *item)
+{
+    QVector<Entry> entries;
+    PointIndexCollector<Entry> collector(&entries);
+    TrackData::visit(item, &collector);
+    for (const Entry &e : qAsConst(entries)) remove(e.point);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Queries								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+QVector<const TrackDataAbstractPoint *> PointIndex::pointsWithin(double latSouth, double lonWest,
+                                                                 double latNorth, double lonEast,
+                                                                 TrackData::Type type) const
+{
+    QVector<const TrackDataAbstractPoint *> result;
+    if (mCount==0) return (result);			// nothing indexed
+    if (ISNAN(latSouth) || ISNAN(lonWest) || ISNAN(latNorth) || ISNAN(lonEast)) return (result);
+
+    if ((lonEast-lonWest)>=360.0)			// covers all longitudes
+    {
+        appendWithin(&result, latSouth, -180.0, latNorth, 180.0, type);
+        return (result);
+    }
+
+    // If the area crosses the date line, then after normalising the
+    // western limit will be greater than the eastern.  Search the
+    // two parts on either side of the date line separately.
+    lonWest = normaliseLongitude(lonWest);
+    lonEast = normaliseLongitude(lonEast);
+    if (lonWest<=lonEast) appendWithin(&result, latSouth, lonWest, latNorth, lonEast, type);
+    else
+    {
+        appendWithin(&result, latSouth, lonWest, latNorth, 180.0, type);
+        appendWithin(&result, latSouth, -180.0, latNorth, lonEast, type);
+    }
+
+    return (result);
+}
+
+
+void PointIndex::appendWithin(QVector<const TrackDataAbstractPoint *> *result,
+                              double latSouth, double lonWest, double latNorth, double lonEast,
+                              TrackData::Type type) const
+{
+    const int row1 = qMax(cellRow(latSouth), mRowMin);
+    const int row2 = qMin(cellRow(latNorth), mRowMax);
+    const int col1 = qMax(cellCol(lonWest), mColMin);
+    const int col2 = qMin(cellCol(lonEast), mColMax);
+
+    for (int row = row1; row<=row2; ++row)
+    {
+        for (int col = col1; col<=col2; ++col)
+        {
+            const auto it = mCells.constFind(cellKey(row, col));
+            if (it==mCells.constEnd()) continue;	// nothing in this cell
+
+            for (const Entry &e : it.value())
+            {
+                if (e.lat<latSouth || e.lat>latNorth) continue;
+                if (e.lon<lonWest || e.lon>lonEast) continue;
+                if (type!=TrackData::None && e.point->type()!=type) continue;
+                result->append(e.point);
+            }
+        }
+    }
+}
+
+
+QVector<const TrackDataAbstractPoint *> PointIndex::nearest(double lat, double lon, int k,
+                                                            TrackData::Type type, double maxDistance) const
+{
+    QVector<const TrackDataAbstractPoint *> result;
+    if (mCount==0 || k<1) return (result);		// nothing to find
+    if (ISNAN(lat) || ISNAN(lon)) return (result);	// not a valid position
+    lon = normaliseLongitude(lon);
+
+    // As for TrackDataAbstractPoint::distanceTo() with 'accurate' not set,
+    // but there is no need to convert to radians or take the square root
+    // for the purposes of comparison.
+    const double scale = cos(DEGREES_TO_RADIANS(lat));
+    typedef QPair<double,const TrackDataAbstractPoint *> Candidate;
+    QVector<Candidate> found;				// sorted, at most k
+
+    const int row0 = cellRow(lat);
+    const int col0 = cellCol(lon);
+    const int numCols = 2*mHalfCols;
+
+    // The furthest ring of cells that could contain any points.  Going
+    // around the world in either direction, no column can be more than
+    // half of the columns away.
+    int maxRing = qMax(qMax(qAbs(row0-mRowMin), qAbs(row0-mRowMax)),
+                       qMin(qMax(qAbs(col0-mColMin), qAbs(col0-mColMax)), mHalfCols));
+
+    // The minimum distance of any point in a ring, in degrees of latitude,
+    // is at least the ring number less one times this.
+    const double ringSize = mCellSize*qMin(scale, 1.0);
+
+    // If there is a distance limit, then do not search any rings
+    // that must be entirely beyond it.
+    double maxDegrees = 0.0;
+    if (maxDistance>0.0)
+    {
+        maxDegrees = RADIANS_TO_DEGREES(maxDistance);
+        if (ringSize>0.0) maxRing = qMin(maxRing, static_cast<int>(qMin(ceil(maxDegrees/ringSize)+1, double(INT_MAX))));
+    }
+
+    // Search outwards in rings of cells around the cell containing
+    // the position.  Any point in a ring further out than 'ring' must
+    // be at least 'ring' cells away in either latitude or longitude.
+    //
+    // Columns are identified by their offset from the position column,
+    // taken the shorter way around the world so that each column is
+    // searched only once.  An offset corresponds to an indexed column
+    // either directly or after wrapping around by 'numCols', so each of
+    // those ranges is searched in turn.
+    for (int ring = 0; ring<=maxRing; ++ring)
+    {
+        for (int row = qMax(row0-ring, mRowMin); row<=qMin(row0+ring, mRowMax); ++row)
+        {
+            const bool edgeRow = (row==row0-ring || row==row0+ring);
+            for (int wrap = -numCols; wrap<=numCols; wrap += numCols)
+            {
+                const int offFirst = qMax(qMax(-ring, mColMin-col0+wrap), 1-mHalfCols);
+                const int offLast = qMin(qMin(ring, mColMax-col0+wrap), mHalfCols);
+
+                for (int off = offFirst; off<=offLast; ++off)
+                {
+                    // For rows not at the top or bottom of the ring, only the
+                    // two cells at the ends are in this ring.
+                    if (!edgeRow && off!=-ring && off!=ring)
+                    {
+                        if (ring>offLast) break;	// the other end is outside
+                        off = ring-1;			// skip to the other end
+                        continue;
+                    }
+
+                    const auto it = mCells.constFind(cellKey(row, col0+off-wrap));
+                    if (it==mCells.constEnd()) continue;	// nothing in this cell
+
+                    for (const Entry &e : it.value())
+                    {
+                        if (type!=TrackData::None && e.point->type()!=type) continue;
+
+                        const double x = normaliseLongitude(e.lon-lon)*scale;
+                        const double y = (e.lat-lat);
+                        const double d = x*x + y*y;
+                        if (maxDegrees>0.0 && d>maxDegrees*maxDegrees) continue;
+                        if (found.count()==k && d>=found.last().first) continue;
+
+                        const Candidate cand(d, e.point);
+                        found.insert(std::upper_bound(found.begin(), found.end(), cand,
+                                                      [](const Candidate &a, const Candidate &b) { return (a.first<b.first); }),
+                                     cand);
+                        if (found.count()>k) found.removeLast();
+                    }
+                }
+            }
+        }
+
+        if (found.count()==k)				// have enough candidates
+        {
+            const double limit = ring*ringSize;
+            if (found.last().first<=limit*limit) break;	// none further out can be closer
+        }
+    }
+
+    result.reserve(found.count());
+    for (const Candidate &cand : qAsConst(found)) result.append(cand.second);
+    return (result);
+}
+
+
+const TrackDataAbstractPoint *PointIndex::nearestPoint(double lat, double lon, TrackData::Type type,
+                                                       double maxDistance) const
+{
+    const QVector<const TrackDataAbstractPoint *> result = nearest(lat, lon, 1, type, maxDistance);
+    return (result.isEmpty() ? nullptr : result.first());
+}
@@ -0,0 +1,214 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#include <qvector.h>
+#include <qhash.h>
+
+#include "trackdata.h"
+
+
+/**
+ * @short A spatial index over track, route and waypoint points.
+ *
+ * Points are binned into a uniform grid of latitude/longitude cells,
+ * so that the points within an area or near to a position can be found
+ * by looking at only the cells concerned instead of every point in the
+ * data tree.  The cell size is chosen when the index is built, from the
+ * extent and number of the points, so that there are a small number of
+ * points in each occupied cell.
+ *
+ * Points can be inserted, removed or moved after the index is built,
+ * so that an edit only needs to update the cells concerned.  The owner
+ * of the index (for example, FilesModel for the data tree) is responsible
+ * for doing this when the points change.  The cell size is not changed
+ * by these updates, so the index may eventually need to be rebuilt if
+ * the points change very much.
+ *
+ * Longitudes wrap around at 180 degrees, so areas and distances are
+ * handled correctly across the date line.
+ *
+ * Points without a valid position are not included in the index.
+ *
+ * @author Jonathan Marten
+ **/
+
+class PointIndex
+{
+public:
+    /**
+     * Constructor.  The index is initially empty.
+     **/
+    PointIndex();
+
+    /**
+     * Destructor.
+     **/
+    ~PointIndex() = default;
+
+    /**
+     * Build the index over all of the points within a data tree.
+     *
+     * @param root The root item of the tree.  It may be @c nullptr,
+     * in which case the index will be empty.
+     **/
+    void build(const TrackDataItem *root);
+
+    /**
+     * Build the index over a list of points.
+     *
+     * @param points The points to index
+     **/
+    void build(const QVector<const TrackDataAbstractPoint *> &points);
+
+    /**
+     * Clear the index.
+     **/
+    void clear();
+
+    /**
+     * Add a point to the index.  If the point is already in the
+     * index then it is moved to its current position.
+     *
+     * @param tdp The point to add
+     **/
+    void insert(const TrackDataAbstractPoint *tdp);
+
+    /**
+     * Remove a point from the index.  Nothing happens if the point
+     * is not in the index.
+     *
+     * @param tdp The point to remove
+     **/
+    void remove(const TrackDataAbstractPoint *tdp);
+
+    /**
+     * Update the index after a point has been moved.  Nothing happens
+     * if the point is not in the index.
+     *
+     * @param tdp The point that has been moved
+     **/
+    void update(const TrackDataAbstractPoint *tdp);
+
+    /**
+     * Add all of the points within a data tree to the index.
+     *
+     * @param item The root item of the tree, which may itself be a point
+     **/
+    void insertAll(const TrackDataItem *item);
+
+    /**
+     * Remove all of the points within a data tree from the index.
+     *
+     * @param item The root item of the tree, which may itself be a point
+     **/
+    void removeAll(const TrackDataItem *item);
+
+    /**
+     * Get the number of points in the index.
+     *
+     * @return the number of points
+     **/
+    int count() const					{ return (mCount); }
+
+    /**
+     * Find all of the points within an area.
+     *
+     * @param latSouth The southern limit of the area
+     * @param lonWest The western limit of the area
+     * @param latNorth The northern limit of the area
+     * @param lonEast The eastern limit of the area
+     * @param type If specified, only consider points of this type
+     * @return the points found, in no particular order
+     **/
+    QVector<const TrackDataAbstractPoint *> pointsWithin(double latSouth, double lonWest,
+                                                         double latNorth, double lonEast,
+                                                         TrackData::Type type = TrackData::None) const;
+
+    /**
+     * Find the points closest to a position.
+     *
+     * @param lat The latitude of the position
+     * @param lon The longitude of the position
+     * @param k The maximum number of points to find
+     * @param type If specified, only consider points of this type
+     * @param maxDistance If specified, only consider points within this
+     * distance, in the same units as TrackDataAbstractPoint::distanceTo()
+     * @return the points found, in order of increasing distance
+     *
+     * @note The distance used for ordering is the approximation used
+     * by TrackDataAbstractPoint::distanceTo(), which is accurate enough
+     * for the small distances that are of interest here.  Specifying
+     * a maximum distance, if possible, avoids searching a large number
+     * of cells when the position is far away from any points.
+     **/
+    QVector<const TrackDataAbstractPoint *> nearest(double lat, double lon, int k = 1,
+                                                    TrackData::Type type = TrackData::None,
+                                                    double maxDistance = 0.0) const;
+
+    /**
+     * Find the point closest to a position.
+     *
+     * @param lat The latitude of the position
+     * @param lon The longitude of the position
+     * @param type If specified, only consider points of this type
+     * @param maxDistance If specified, only consider points within this
+     * distance, see nearest()
+     * @return the closest point, or @c nullptr if there are none
+     **/
+    const TrackDataAbstractPoint *nearestPoint(double lat, double lon,
+                                               TrackData::Type type = TrackData::None,
+                                               double maxDistance = 0.0) const;
+
+private:
+    struct Entry
+    {
+        const TrackDataAbstractPoint *point;
+        double lat;
+        double lon;
+    };
+
+    void buildFrom(const QVector<Entry> &entries);
+    void addEntry(const Entry &e);
+    void appendWithin(QVector<const TrackDataAbstractPoint *> *result,
+                      double latSouth, double lonWest, double latNorth, double lonEast,
+                      TrackData::Type type) const;
+    int cellRow(double lat) const;
+    int cellCol(double lon) const;
+    static quint64 cellKey(int row, int col)		{ return ((quint64(quint32(row))<<32)|quint32(col)); }
+
+private:
+    QHash<quint64,QVector<Entry>> mCells;
+    QHash<const TrackDataAbstractPoint *,quint64> mCellKeys;
+    double mCellSize;
+    int mHalfCols;					// columns in 180 degrees
+    int mRowMin, mRowMax;
+    int mColMin, mColMax;
+    int mCount;
+};
+
+#endif							// POINTINDEX_H
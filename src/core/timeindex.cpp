@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "timeindex.h"
+
+#include <algorithm>
+
+#include <qdebug.h>
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Debugging switches							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#undef DEBUG_INDEX
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Collecting points from the data tree				//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+template<class E>
+class TimeIndexCollector : public TrackDataVisitor
+{
+public:
+    explicit TimeIndexCollector(QVector<E> *entries)	: mEntries(entries) {}
+
+    // Waypoints and route points do not form part of a recorded
+    // track, so there is no need to visit them.
+    bool visitFolder(const TrackDataFolder *item) override		{ Q_UNUSED(item); return (false); }
+    bool visitRoute(const TrackDataRoute *item) override		{ Q_UNUSED(item); return (false); }
+
+    void visitTrackpoint(const TrackDataTrackpoint *item) override
+    {
+        const qint64 t = item->timeMSecs();
+        if (t!=TrackData::NoTime) mEntries->append({ t, item });
+    }
+
+private:
+    QVector<E> *mEntries;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Building the index							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+void TimeIndex::clear()
+{
+    mEntries.clear();
+}
+
+
+void TimeIndex::build(const TrackDataItem *root)
+{
+    clear();
+    if (root==nullptr) return;
+
+    TimeIndexCollector<Entry> collector(&mEntries);
+    TrackData::visit(root, &collector);
+
+    // Points within a segment are normally already in time order, so
+    // the sort has very little to do.  It is stable so that points with
+    // the same time remain in data tree order.
+    std::stable_sort(mEntries.begin(), mEntries.end(),
+                     [](const Entry &a, const Entry &b) { return (a.time<b.time); });
+#ifdef DEBUG_INDEX
+    qDebug() << "indexed" << mEntries.count() << "points";
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Queries								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+const TrackDataTrackpoint *TimeIndex::nearest(qint64 msecs, qint64 *diff) const
+{
+    if (mEntries.isEmpty()) return (nullptr);		// nothing indexed
+
+    // Find the first point not before the specified time.  The closest
+    // is either that one or the one before it.
+    const auto it = std::lower_bound(mEntries.constBegin(), mEntries.constEnd(), msecs,
+                                     [](const Entry &e, qint64 t) { return (e.time<t); });
+
+    const Entry *closest;
+    if (it==mEntries.constEnd()) closest = &mEntries.last();
+    else if (it==mEntries.constBegin()) closest = it;
+    else						// choose the closer of the two,
+    {							// preferring the earlier if equal
+        const Entry *prev = it-1;
+        closest = ((msecs-prev->time)<=(it->time-msecs)) ? prev : it;
+    }
+
+    // If there are a number of points with the same time, return the first.
+    while (closest>mEntries.constBegin() && (closest-1)->time==closest->time) --closest;
+
+    if (diff!=nullptr) *diff = qAbs(closest->time-msecs);
+    return (closest->point);
+}
+
+
+QVector<const TrackDataTrackpoint *> TimeIndex::pointsBetween(qint64 from, qint64 to) const
+{
+    QVector<const TrackDataTrackpoint *> result;
+    if (from>to) return (result);			// empty range
+
+    auto it = std::lower_bound(mEntries.constBegin(), mEntries.constEnd(), from,
+                               [](const Entry &e, qint64 t) { return (e.time<t); });
+    for (; it!=mEntries.constEnd() && it->time<=to; ++it) result.append(it->point);
+    return (result);
+}
@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include <qvector.h>
+
+#include "trackdata.h"
+
+
+/**
+ * @short A time ordered index of track points.
+ *
+ * All of the track points with a valid time within a data tree are
+ * held in order of time, so that the point closest to a specified time
+ * or the points within a time range can be found by a binary search.
+ *
+ * Unlike PointIndex, the index is not updated when the points change
+ * and the owner is responsible for rebuilding it when required.
+ *
+ * @author Jonathan Marten
+ **/
+
+class TimeIndex
+{
+public:
+    /**
+     * Constructor.  The index is initially empty.
+     **/
+    TimeIndex() = default;
+
+    /**
+     * Destructor.
+     **/
+    ~TimeIndex() = default;
+
+    /**
+     * Build the index over all of the track points within a data tree.
+     *
+     * @param root The root item of the tree.  It may be @c nullptr,
+     * in which case the index will be empty.
+     **/
+    void build(const TrackDataItem *root);
+
+    /**
+     * Clear the index.
+     **/
+    void clear();
+
+    /**
+     * Get the number of points in the index.
+     *
+     * @return the number of points
+     **/
+    int count() const					{ return (mEntries.count()); }
+
+    /**
+     * Find the point closest in time to the specified time.
+     *
+     * @param msecs The time, in milliseconds since the epoch
+     * @param diff If this is not @c nullptr, the absolute difference
+     * in milliseconds between the specified time and that of the
+     * point found is returned here.
+     * @return the closest point, or @c nullptr if the index is empty.
+     * If there are a number of points at the same time, the first
+     * of them in the data tree is returned.
+     **/
+    const TrackDataTrackpoint *nearest(qint64 msecs, qint64 *diff = nullptr) const;
+
+    /**
+     * Find all of the points within a time range.
+     *
+     * @param from The start of the range, in milliseconds since the epoch
+     * @param to The end of the range, in milliseconds since the epoch
+     * @return the points with times within the range, inclusive, in
+     * order of time.
+     **/
+    QVector<const TrackDataTrackpoint *> pointsBetween(qint64 from, qint64 to) const;
+
+private:
+    struct Entry
+    {
+        qint64 time;
+        const TrackDataTrackpoint *point;
+    };
+
+    QVector<Entry> mEntries;
+};
+
+#endif							// TIMEINDEX_H
@@ -25,11 +25,16 @@
 
 #include "trackdata.h"
 
+#include <ctype.h>
+#include <new>
+
 #include <qregexp.h>
 #include <qdebug.h>
 #include <qtimezone.h>
 #include <qicon.h>
 #include <qstandardpaths.h>
+#include <qthread.h>
+#include <qcoreapplication.h>
 
 #include <klocalizedstring.h>
 #include <kiconloader.h>
@@ -37,6 +42,7 @@
 #include <kio/global.h>
 
 #include "dataindexer.h"
+#include "itempool.h"
 #include "waypointimageprovider.h"
 
 //////////////////////////////////////////////////////////////////////////
@@ -54,14 +60,28 @@
 //									//
 //////////////////////////////////////////////////////////////////////////
 
-static int counterFile = 0;
-static int counterTrack = 0;
-static int counterRoute = 0;
-static int counterSegment = 0;
-static int counterTrackpoint = 0;
-static int counterFolder = 0;
-static int counterWaypoint = 0;
-static int counterRoutepoint = 0;
+static QAtomicInt counterFile(0);
+static QAtomicInt counterTrack(0);
+static QAtomicInt counterRoute(0);
+static QAtomicInt counterSegment(0);
+static QAtomicInt counterTrackpoint(0);
+static QAtomicInt counterFolder(0);
+static QAtomicInt counterWaypoint(0);
+static QAtomicInt counterRoutepoint(0);
+
+// Incremented each time that deferred points are loaded
+static QAtomicInt sDeferredLoads(0);
+
+// Pools for the point types which may exist in very large numbers.
+// The points may be freed at any time until the application exits,
+// so these must not be destroyed before any data tree.
+static ItemPool sTrackpointPool(sizeof(TrackDataTrackpoint));
+static ItemPool sRoutepointPool(sizeof(TrackDataRoutepoint));
+
+// Every point with any metadata, which is almost all of them, also
+// has its own metadata array.
+typedef QVector<QVariant> MetadataArray;
+static ItemPool sMetadataPool(sizeof(MetadataArray));
 
 #ifdef MEMORY_TRACKING
 static int allocFile = 0;
@@ -246,7 +266,7 @@ TrackDataFolder *TrackData::findFolderByPath(const QString &path, const TrackDat
         const TrackDataItem *folderItem = nullptr;
         for (int i = 0; i<cnt; ++i)			// search through children
         {
-            const TrackDataFolder *fold = dynamic_cast<const TrackDataFolder *>(item->childAt(i));
+            const TrackDataFolder *fold = TrackData::cast<TrackDataFolder>(item->childAt(i));
             if (fold!=nullptr)				// child item is a folder
             {
                 if (fold->name()==name)			// folder name matches
@@ -261,7 +281,7 @@ TrackDataFolder *TrackData::findFolderByPath(const QString &path, const TrackDat
         item = folderItem;				// continue descent from here
     }
 
-    return (const_cast<TrackDataFolder *>(dynamic_cast<const TrackDataFolder *>(item)));
+    return (const_cast<TrackDataFolder *>(TrackData::cast<TrackDataFolder>(item)));
 }
 
 
@@ -280,6 +300,381 @@ default:				return (i18n("(Unknown %1)", status));
 }
 
 
+void TrackData::visit(const TrackDataItem *item, TrackDataVisitor *visitor)
+{
+    bool descend = true;
+    switch (item->type())
+    {
+case TrackData::File:		descend = visitor->visitFile(static_cast<const TrackDataFile *>(item));		break;
+case TrackData::Track:		descend = visitor->visitTrack(static_cast<const TrackDataTrack *>(item));	break;
+case TrackData::Segment:	descend = visitor->visitSegment(static_cast<const TrackDataSegment *>(item));	break;
+case TrackData::Folder:		descend = visitor->visitFolder(static_cast<const TrackDataFolder *>(item));	break;
+case TrackData::Route:		descend = visitor->visitRoute(static_cast<const TrackDataRoute *>(item));	break;
+case TrackData::Trackpoint:	visitor->visitTrackpoint(static_cast<const TrackDataTrackpoint *>(item));	return;
+case TrackData::Waypoint:	visitor->visitWaypoint(static_cast<const TrackDataWaypoint *>(item));		return;
+case TrackData::Routepoint:	visitor->visitRoutepoint(static_cast<const TrackDataRoutepoint *>(item));	return;
+default:			break;
+    }
+
+    if (!descend) return;
+    const int num = item->childCount();
+    for (int i = 0; i<num; ++i) visit(item->childAt(i), visitor);
+}
+
+
+const PointColumns *TrackData::pointColumns(const TrackDataItem *item)
+{
+    if (item==nullptr) return (nullptr);
+    switch (item->type())
+    {
+case TrackData::Segment:	return (static_cast<const TrackDataSegment *>(item)->columns());
+case TrackData::Route:		return (static_cast<const TrackDataRoute *>(item)->columns());
+default:			return (nullptr);
+    }
+}
+
+
+void TrackData::distances(const double *lat, const double *lon, int n, double *out, bool accurate)
+{
+    if (n<=0) return;
+    out[0] = 0.0;
+
+    if (accurate)
+    {
+        // Spherical cosines for maximum accuracy.  The sine and cosine of
+        // each latitude are only calculated once, and carried over to be
+        // used as those of the previous point for the next distance.
+        double prevPhi = DEGREES_TO_RADIANS(lat[0]);
+        double prevSin = sin(prevPhi);
+        double prevCos = cos(prevPhi);
+        for (int i = 1; i<n; ++i)
+        {
+            const double phi = DEGREES_TO_RADIANS(lat[i]);
+            const double sinPhi = sin(phi);
+            const double cosPhi = cos(phi);
+            const double dlon = DEGREES_TO_RADIANS(lon[i])-DEGREES_TO_RADIANS(lon[i-1]);
+            double d = acos(prevSin*sinPhi + prevCos*cosPhi*cos(dlon));
+
+            // Rounding can put the argument of acos() just out of range
+            // for very close points.  Use the approximation below for those.
+            if (ISNAN(d))
+            {
+                const double x = dlon*cos((prevPhi+phi)/2.0);
+                const double y = (phi-prevPhi);
+                d = sqrt(x*x + y*y);
+            }
+
+            out[i] = d;
+            prevPhi = phi;
+            prevSin = sinPhi;
+            prevCos = cosPhi;
+        }
+        return;
+    }
+
+    // Pythagoras is good enough for small distances
+    for (int i = 1; i<n; ++i)
+    {
+        const double lat1 = DEGREES_TO_RADIANS(lat[i-1]);
+        const double lat2 = DEGREES_TO_RADIANS(lat[i]);
+        const double x = (DEGREES_TO_RADIANS(lon[i])-DEGREES_TO_RADIANS(lon[i-1]))*cos((lat1+lat2)/2.0);
+        const double y = (lat2-lat1);
+        out[i] = sqrt(x*x + y*y);
+    }
+}
+
+
+void TrackData::bearings(const double *lat, const double *lon, int n, double *out)
+{
+    if (n<=0) return;
+    out[0] = NAN;
+
+    // Rhumb line bearing as for TrackDataAbstractPoint::bearingTo().
+    // The Mercator projection of each latitude is only calculated once,
+    // and carried over to be used as that of the previous point.
+    double prevMerc = log(tan(M_PI/4+DEGREES_TO_RADIANS(lat[0])/2));
+    for (int i = 1; i<n; ++i)
+    {
+        const double merc = log(tan(M_PI/4+DEGREES_TO_RADIANS(lat[i])/2));
+        const double dphi = merc-prevMerc;
+        double dlon = DEGREES_TO_RADIANS(lon[i])-DEGREES_TO_RADIANS(lon[i-1]);
+        if (fabs(dlon)>M_PI) dlon = dlon>0 ? -(2*M_PI-dlon) : (2*M_PI+dlon);
+        out[i] = RADIANS_TO_DEGREES(atan2(dlon, dphi));
+        prevMerc = merc;
+    }
+}
+
+
+void TrackData::speeds(const double *dist, const qint64 *times, int n, double *out)
+{
+    if (n<=0) return;
+    out[0] = NAN;
+
+    for (int i = 1; i<n; ++i)
+    {
+        const bool valid = (times[i-1]!=TrackData::NoTime && times[i]!=TrackData::NoTime && times[i]!=times[i-1]);
+        out[i] = valid ? dist[i]/(double(times[i]-times[i-1])/1000) : NAN;
+    }
+}
+
+
+// Parsing of ISO 8601 date/time strings.  The fast path handles the
+// forms that are seen in practice in GPX files:
+//
+//   2010-04-18T16:28:47Z
+//   2010-04-18T16:28:47.123Z
+//   2010-04-18T16:28:47+01:00
+//   2010-04-18T16:28:47.5-0530
+//
+// Anything else, including a time with no zone (which QDateTime takes
+// to be local time), is passed to QDateTime::fromString() so that the
+// result is always the same as it would have been from that.
+
+static inline bool isDigits(const char *p, int n)
+{
+    for (int i = 0; i<n; ++i) if (p[i]<'0' || p[i]>'9') return (false);
+    return (true);
+}
+
+
+static inline int digitsValue(const char *p, int n)
+{
+    int val = 0;
+    for (int i = 0; i<n; ++i) val = val*10+(p[i]-'0');
+    return (val);
+}
+
+
+// Days since the epoch for a date in the proleptic Gregorian calendar,
+// from the algorithm at <http://howardhinnant.github.io/date_algorithms.html>
+
+static qint64 daysFromCivil(int y, int m, int d)
+{
+    y -= (m<=2);
+    const int era = (y>=0 ? y : y-399)/400;
+    const int yoe = y-era*400;				// [0, 399]
+    const int doy = (153*(m>2 ? m-3 : m+9)+2)/5+d-1;	// [0, 365]
+    const int doe = yoe*365+yoe/4-yoe/100+doy;		// [0, 146096]
+    return (qint64(era)*146097+doe-719468);
+}
+
+
+static bool parseIsoTimeFast(const char *p, const char *end, qint64 *result)
+{
+    if ((end-p)<20) return (false);			// too short for date, time and zone
+    if (!(isDigits(p, 4) && p[4]=='-' && isDigits(p+5, 2) && p[7]=='-' && isDigits(p+8, 2) &&
+          p[10]=='T' && isDigits(p+11, 2) && p[13]==':' && isDigits(p+14, 2) && p[16]==':' &&
+          isDigits(p+17, 2))) return (false);
+
+    const int year = digitsValue(p, 4);
+    const int month = digitsValue(p+5, 2);
+    const int day = digitsValue(p+8, 2);
+    const int hour = digitsValue(p+11, 2);
+    const int minute = digitsValue(p+14, 2);
+    const int second = digitsValue(p+17, 2);
+
+    static const int monthDays[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month<1 || month>12 || day<1 || day>monthDays[month-1]) return (false);
+    if (month==2 && day==29 && !QDate::isLeapYear(year)) return (false);
+    if (hour>23 || minute>59 || second>59) return (false);
+    p += 19;
+
+    int msec = 0;
+    if (*p=='.' || *p==',')				// fractional seconds
+    {
+        ++p;
+        const char *start = p;
+        int frac = 0;
+        int scale = 1;
+        while (p<end && *p>='0' && *p<='9')
+        {
+            // Only the first 4 digits are significant, as for QTime
+            if ((p-start)<4)
+            {
+                frac = frac*10+(*p-'0');
+                scale *= 10;
+            }
+            ++p;
+        }
+
+        if (p==start) return (false);			// no digits present
+        msec = qMin(int((frac*2000LL+scale)/(2*scale)), 999);
+    }
+
+    int offset = 0;					// zone offset, in seconds
+    if (p<end && *p=='Z') ++p;				// UTC
+    else if (p<end && (*p=='+' || *p=='-'))		// offset from UTC
+    {
+        const int sign = (*p=='-' ? -1 : +1);
+        ++p;
+        if ((end-p)<2 || !isDigits(p, 2)) return (false);
+        const int offHours = digitsValue(p, 2);
+        p += 2;
+        if (p<end && *p==':') ++p;
+        if ((end-p)<2 || !isDigits(p, 2)) return (false);
+        const int offMinutes = digitsValue(p, 2);
+        p += 2;
+        if (offHours>23 || offMinutes>59) return (false);
+        offset = sign*(offHours*3600+offMinutes*60);
+    }
+    else return (false);				// no zone, or not recognised
+
+    if (p!=end) return (false);				// trailing garbage
+
+    const qint64 secs = daysFromCivil(year, month, day)*86400+hour*3600+minute*60+second-offset;
+    *result = secs*1000+msec;
+    return (true);
+}
+
+
+qint64 TrackData::parseIsoTime(const char *str, int len)
+{
+    while (len>0 && isspace(uchar(str[0])))		// trim leading whitespace
+    {
+        ++str;
+        --len;
+    }
+    while (len>0 && isspace(uchar(str[len-1]))) --len;	// and trailing
+
+    qint64 result;
+    if (parseIsoTimeFast(str, str+len, &result)) return (result);
+
+    // The time spec of the decoded date/time is UTC or the offset
+    // specified, and the value in milliseconds is independent of that.
+    const QDateTime dt = QDateTime::fromString(QString::fromUtf8(str, len), Qt::ISODate);
+    return (dt.isValid() ? dt.toMSecsSinceEpoch() : TrackData::NoTime);
+}
+
+
+// Parsing of decimal numbers.  The syntax is checked strictly, and
+// then if the value has no more than 15 significant digits and a small
+// enough exponent it can be calculated exactly from the integer mantissa
+// and a power of 10 (which are both exactly representable as doubles),
+// giving the correctly rounded result.  Otherwise the value is passed to
+// QByteArray::toDouble() which, unlike strtod(), does not depend on the
+// current locale.
+
+bool TrackData::parseDouble(const char *str, int len, double *result)
+{
+    while (len>0 && isspace(uchar(str[0])))		// trim leading whitespace
+    {
+        ++str;
+        --len;
+    }
+    while (len>0 && isspace(uchar(str[len-1]))) --len;	// and trailing
+
+    const char *p = str;
+    const char *end = str+len;
+    if (p==end) return (false);				// nothing there
+
+    bool negative = false;
+    if (*p=='+' || *p=='-')				// optional sign
+    {
+        negative = (*p=='-');
+        ++p;
+    }
+
+    quint64 mantissa = 0;				// significant digits
+    int digits = 0;					// count of those
+    int exponent = 0;					// power of 10 to apply
+    bool exact = true;					// no digits dropped
+    bool anyDigits = false;				// any digits seen
+
+    while (p<end && *p>='0' && *p<='9')			// integer part
+    {
+        const int d = *p-'0';
+        if (mantissa!=0 || d!=0)			// ignore leading zeros
+        {
+            if (digits<19)				// room for another digit
+            {
+                mantissa = mantissa*10+d;
+                ++digits;
+            }
+            else					// too many digits
+            {
+                ++exponent;
+                exact = false;
+            }
+        }
+        anyDigits = true;
+        ++p;
+    }
+
+    if (p<end && *p=='.')				// fractional part
+    {
+        ++p;
+        while (p<end && *p>='0' && *p<='9')
+        {
+            const int d = *p-'0';
+            if (mantissa==0 && d==0) --exponent;	// leading zero
+            else if (digits<19)				// room for another digit
+            {
+                mantissa = mantissa*10+d;
+                ++digits;
+                --exponent;
+            }
+            else exact = false;				// too many digits
+            anyDigits = true;
+            ++p;
+        }
+    }
+
+    if (!anyDigits) return (false);			// no mantissa digits
+
+    if (p<end && (*p=='e' || *p=='E'))			// exponent part
+    {
+        ++p;
+        bool expNegative = false;
+        if (p<end && (*p=='+' || *p=='-'))
+        {
+            expNegative = (*p=='-');
+            ++p;
+        }
+
+        if (p==end || *p<'0' || *p>'9') return (false);	// no exponent digits
+        int e = 0;
+        while (p<end && *p>='0' && *p<='9')
+        {
+            if (e<10000) e = e*10+(*p-'0');		// saturate, will be inf or zero
+            ++p;
+        }
+        exponent += (expNegative ? -e : e);
+    }
+
+    if (p!=end) return (false);				// trailing garbage
+
+    static const double powersOf10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    double val;
+    if (exact && digits<=15 && exponent>=-22 && exponent<=22)
+    {							// can calculate exactly
+        val = double(mantissa);
+        if (exponent<0) val /= powersOf10[-exponent];
+        else val *= powersOf10[exponent];
+        if (negative) val = -val;
+    }
+    else						// syntax has been checked,
+    {							// so this should succeed
+        bool ok;
+        val = QByteArray(str, len).toDouble(&ok);
+        if (!ok) return (false);
+    }
+
+    *result = val;
+    return (true);
+}
+
+
+int TrackData::deferredLoadCount()
+{
+    return (sDeferredLoads.loadAcquire());
+}
+
+
 QVariant TrackData::valueOrNull(const QVariant &value)
 {
     QVariant val = value;				// provided new value
@@ -321,16 +716,148 @@ QVariant TrackData::valueOrNull(const QVariant &value)
     return (val);
 }
 
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  PointColumns							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// The maximum number of points held in all of the cached columns.  At
+// 16 bytes per point this limits them to about 8Mb.  The columns that
+// have just been built are always kept, even if they are larger than this.
+static const int MAX_CACHED_POINTS = 500000;
+
+static PointColumns *sColumnsFirst = nullptr;		// most recently used
+static PointColumns *sColumnsLast = nullptr;		// least recently used
+static int sColumnsPoints = 0;				// total points held
+
+
+// The columns are shared between all of the data trees, so they must
+// only be used by one thread.  Data trees can be built by worker
+// threads, but they never request the columns.
+
+static inline bool isColumnsThread()
+{
+    const QCoreApplication *app = QCoreApplication::instance();
+    return (app==nullptr || QThread::currentThread()==app->thread());
+}
+
+
+PointColumns::PointColumns(const TrackDataItem *container)
+{
+    mSlot = nullptr;
+    mPrev = mNext = nullptr;
+
+    const int cnt = container->childCount();
+    if (cnt==0) return;
+    mDistances.resize(cnt);
+    mElapsed.resize(cnt);
+
+    // The positions are only needed while calculating the step distances
+    // in one pass, which are then accumulated in place.
+    {
+        QVector<double> lats(cnt);
+        QVector<double> lons(cnt);
+        for (int i = 0; i<cnt; ++i)
+        {
+            const TrackDataAbstractPoint *tdp = static_cast<const TrackDataAbstractPoint *>(container->childAt(i));
+            lats[i] = tdp->latitude();
+            lons[i] = tdp->longitude();
+        }
+        TrackData::distances(lats.constData(), lons.constData(), cnt, mDistances.data());
+    }
+
+    qint64 prevTime = static_cast<const TrackDataAbstractPoint *>(container->childAt(0))->timeMSecs();
+    mElapsed[0] = 0;
+    for (int i = 1; i<cnt; ++i)
+    {
+        mDistances[i] += mDistances[i-1];
+        const qint64 t = static_cast<const TrackDataAbstractPoint *>(container->childAt(i))->timeMSecs();
+        qint64 step = 0;
+        if (prevTime!=TrackData::NoTime && t!=TrackData::NoTime) step = t-prevTime;
+        mElapsed[i] = mElapsed[i-1]+step;
+        prevTime = t;
+    }
+}
+
+
+const PointColumns *PointColumns::obtain(const TrackDataItem *container, PointColumns **slot)
+{
+    Q_ASSERT(isColumnsThread());
+    PointColumns *pc = *slot;
+    if (pc!=nullptr)					// already built
+    {
+        if (pc!=sColumnsFirst)				// note as most recently used
+        {
+            pc->unlink();
+            pc->linkFirst();
+        }
+        return (pc);
+    }
+
+    pc = new PointColumns(container);
+    pc->mSlot = slot;
+    *slot = pc;
+    pc->linkFirst();
+    sColumnsPoints += pc->count();
+
+    // Discard the least recently used until within the limit
+    while (sColumnsPoints>MAX_CACHED_POINTS && sColumnsLast!=pc) discard(sColumnsLast->mSlot);
+    return (pc);
+}
+
+
+void PointColumns::discard(PointColumns **slot)
+{
+    PointColumns *pc = *slot;
+    if (pc==nullptr) return;				// nothing held
+    Q_ASSERT(isColumnsThread());
+
+    pc->unlink();
+    sColumnsPoints -= pc->count();
+    *slot = nullptr;					// owner no longer has them
+    delete pc;
+}
+
+
+void PointColumns::unlink()
+{
+    if (mPrev!=nullptr) mPrev->mNext = mNext;
+    else sColumnsFirst = mNext;
+    if (mNext!=nullptr) mNext->mPrev = mPrev;
+    else sColumnsLast = mPrev;
+    mPrev = mNext = nullptr;
+}
+
+
+void PointColumns::linkFirst()
+{
+    mPrev = nullptr;
+    mNext = sColumnsFirst;
+    if (sColumnsFirst!=nullptr) sColumnsFirst->mPrev = this;
+    else sColumnsLast = this;
+    sColumnsFirst = this;
+}
+
 //////////////////////////////////////////////////////////////////////////
 //									//
 //  TrackDataItem							//
 //									//
 //////////////////////////////////////////////////////////////////////////
 
-TrackDataItem::TrackDataItem(const char *format, int *counter)
+TrackDataItem::TrackDataItem(const char *format, QAtomicInt *counter)
 {
     init();
-    if (format!=nullptr) mName = QString::asprintf(format, ++(*counter));
+
+    // The default name is not generated here, because most items (especially
+    // points) will never have their name displayed.  Only the format, which
+    // is expected to be a string literal, and the sequence number are stored
+    // and the name is generated by name() if it is needed.
+    if (format!=nullptr)
+    {
+        mNameFormat = format;
+        mNameNumber = counter->fetchAndAddRelaxed(1)+1;
+    }
 }
 
 
@@ -341,20 +868,40 @@ void TrackDataItem::init()
     mMetadata = nullptr;				// no metadata yet
     mSelectionId = 1;					// nothing selected yet
     mExplicitName = false;
+    mNameFormat = nullptr;				// no default name
+    mNameNumber = 0;
+    mRow = -1;						// no index within parent
 }
 
 
 TrackDataItem::~TrackDataItem()
 {
-    if (mChildren!=nullptr) qDeleteAll(*mChildren);
+    if (mChildren!=nullptr)
+    {
+        qDeleteAll(mChildren->items);
+        delete mChildren->deferred;			// if never loaded
+    }
     delete mChildren;
-    delete mMetadata;
+
+    if (mMetadata!=nullptr)				// return array to pool
+    {
+        mMetadata->~MetadataArray();
+        sMetadataPool.deallocate(mMetadata, sizeof(MetadataArray));
+    }
+}
+
+
+QString TrackDataItem::name() const
+{
+    if (mNameFormat==nullptr) return (mName);		// name has been set
+    return (QString::asprintf(mNameFormat, mNameNumber));
 }
 
 
 void TrackDataItem::setName(const QString &newName, bool explicitName)
 {
     mName = newName;
+    mNameFormat = nullptr;				// default name now not used
     mExplicitName = explicitName;
 }
 
@@ -369,22 +916,42 @@ void TrackDataItem::addChildItem(TrackDataItem *data, int idx)
 #ifdef MEMORY_TRACKING
         ++allocChildren;
 #endif
-        mChildren = new QList<TrackDataItem *>;
+        mChildren = new ChildData;
     }
+    else if (mChildren->deferred!=nullptr) loadDeferred();
 
-    if (idx>=0) mChildren->insert(idx, data);		// insert at specified place
-    else mChildren->append(data);			// default is to append
+    const int cnt = mChildren->items.count();		// number of existing children
+    if (idx>=0 && idx<cnt)				// insert at specified place
+    {
+        mChildren->items.insert(idx, data);
+        // The rows of the following children are now out of date
+        if (mChildren->validRows>idx) mChildren->validRows = idx;
+    }
+    else						// default is to append
+    {
+        idx = cnt;
+        mChildren->items.append(data);
+        // The row of the new child is correct, if all of the others are
+        if (mChildren->validRows==cnt) mChildren->validRows = cnt+1;
+    }
 							// have taken ownership of child
     data->mParent = this;				// set child item parent
+    data->mRow = idx;					// and index within parent
+    invalidateCache();					// children have changed
 }
 
 
 TrackDataItem *TrackDataItem::takeLastChildItem()
 {
     Q_ASSERT(mChildren!=nullptr);
-    Q_ASSERT(!mChildren->isEmpty());
-    TrackDataItem *data = mChildren->takeLast();
+    if (mChildren->deferred!=nullptr) loadDeferred();
+    Q_ASSERT(!mChildren->items.isEmpty());
+    TrackDataItem *data = mChildren->items.takeLast();
+    const int cnt = mChildren->items.count();		// remaining children
+    if (mChildren->validRows>cnt) mChildren->validRows = cnt;
     data->mParent = nullptr;				// now no longer has parent
+    data->mRow = -1;
+    invalidateCache();					// children have changed
     return (data);
 }
 
@@ -392,9 +959,13 @@ TrackDataItem *TrackDataItem::takeLastChildItem()
 TrackDataItem *TrackDataItem::takeFirstChildItem()
 {
     Q_ASSERT(mChildren!=nullptr);
-    Q_ASSERT(!mChildren->isEmpty());
-    TrackDataItem *data = mChildren->takeFirst();
+    if (mChildren->deferred!=nullptr) loadDeferred();
+    Q_ASSERT(!mChildren->items.isEmpty());
+    TrackDataItem *data = mChildren->items.takeFirst();
+    mChildren->validRows = 0;				// all of the rows have changed
     data->mParent = nullptr;				// now no longer has parent
+    data->mRow = -1;
+    invalidateCache();					// children have changed
     return (data);
 }
 
@@ -402,9 +973,13 @@ TrackDataItem *TrackDataItem::takeFirstChildItem()
 TrackDataItem *TrackDataItem::takeChildItem(int idx)
 {
     Q_ASSERT(mChildren!=nullptr);
-    Q_ASSERT(idx>=0 && idx<mChildren->count());
-    TrackDataItem *data = mChildren->takeAt(idx);
+    if (mChildren->deferred!=nullptr) loadDeferred();
+    Q_ASSERT(idx>=0 && idx<mChildren->items.count());
+    TrackDataItem *data = mChildren->items.takeAt(idx);
+    if (mChildren->validRows>idx) mChildren->validRows = idx;
     data->mParent = nullptr;				// now no longer has parent
+    data->mRow = -1;
+    invalidateCache();					// children have changed
     return (data);
 }
 
@@ -412,19 +987,119 @@ TrackDataItem *TrackDataItem::takeChildItem(int idx)
 void TrackDataItem::removeChildItem(TrackDataItem *item)
 {
     Q_ASSERT(mChildren!=nullptr);
-    takeChildItem(mChildren->indexOf(item));
+    takeChildItem(childIndex(item));
+}
+
+
+int TrackDataItem::childIndex(const TrackDataItem *data) const
+{
+    Q_ASSERT(mChildren!=nullptr);
+    if (data->mParent!=this) return (-1);		// not a child of this item
+
+    // Each child records its own index within the parent, so that this
+    // does not need to search the list of children.  Inserting or removing
+    // a child makes the recorded index of those following it out of date,
+    // but they are only renumbered when one of them is next needed.  This
+    // means that adding or removing many children does not need to
+    // renumber them each time.
+    //
+    // The recorded index is checked for being correct, so any child with
+    // a position before 'validRows' will be found immediately.  If it is
+    // not correct, then the child must be positioned after 'validRows' and
+    // the rest of the children are renumbered from there.
+    QList<TrackDataItem *> &items = mChildren->items;
+    const int row = data->mRow;
+    if (row>=0 && row<items.count() && items.at(row)==data) return (row);
+
+    const int cnt = items.count();
+    for (int i = mChildren->validRows; i<cnt; ++i) items.at(i)->mRow = i;
+    mChildren->validRows = cnt;
+
+    Q_ASSERT(items.at(data->mRow)==data);
+    return (data->mRow);
 }
 
 
 BoundingArea TrackDataItem::boundingArea() const
 {
-    return (TrackData::unifyBoundingAreas(mChildren));
+    if (mChildren==nullptr) return (BoundingArea());	// no children, no area
+
+    if (!mChildren->areaValid)				// not calculated yet
+    {
+        mChildren->area = TrackData::unifyBoundingAreas(&mChildren->items);
+        mChildren->areaValid = true;
+    }
+    return (mChildren->area);
 }
 
 
 TimeRange TrackDataItem::timeSpan() const
 {
-    return (TrackData::unifyTimeSpans(mChildren));
+    if (mChildren==nullptr) return (TimeRange());	// no children, no time
+
+    if (!mChildren->spanValid)				// not calculated yet
+    {
+        mChildren->span = TrackData::unifyTimeSpans(&mChildren->items);
+        mChildren->spanValid = true;
+    }
+    return (mChildren->span);
+}
+
+
+void TrackDataItem::invalidateCache()
+{
+    // If the children are deferred, then the cached values are those
+    // that were specified by setDeferredChildren().  They cannot be
+    // calculated again, but they also cannot have changed.
+    if (mChildren!=nullptr && mChildren->deferred==nullptr)
+    {							// discard cached values
+        mChildren->areaValid = false;
+        mChildren->spanValid = false;
+    }
+
+    if (mParent!=nullptr) mParent->invalidateCache();	// and for all parents
+}
+
+
+void TrackDataItem::setDeferredChildren(DeferredPointSource *source, int count,
+                                        const BoundingArea &area, const TimeRange &span)
+{
+    Q_ASSERT(childCount()==0);
+    if (mChildren==nullptr)
+    {
+#ifdef MEMORY_TRACKING
+        ++allocChildren;
+#endif
+        mChildren = new ChildData;
+    }
+
+    mChildren->deferred = source;
+    mChildren->deferredCount = count;
+    mChildren->area = area;				// summary values
+    mChildren->areaValid = true;
+    mChildren->span = span;
+    mChildren->spanValid = true;
+    if (mParent!=nullptr) mParent->invalidateCache();
+}
+
+
+// This is logically const, because it is only loading data which
+// the item is already considered to have.
+
+void TrackDataItem::loadDeferred() const
+{
+    DeferredPointSource *source = mChildren->deferred;
+    const int count = mChildren->deferredCount;
+    mChildren->deferred = nullptr;			// now considered loaded
+
+    TrackDataSegment *tds = TrackData::cast<TrackDataSegment>(const_cast<TrackDataItem *>(this));
+    Q_ASSERT(tds!=nullptr);
+    qDebug() << "loading" << count << "points for" << name();
+    if (!source->loadPoints(tds)) qWarning() << "failed to load points for" << name();
+    Q_ASSERT(mChildren->items.count()==count);
+
+    delete source;
+    sDeferredLoads.fetchAndAddRelease(1);
 }
 
 
@@ -435,7 +1110,7 @@ void TrackDataItem::setMetadata(int idx, const QVariant &value)
 #ifdef MEMORY_TRACKING
         ++allocMetadata;
 #endif
-        mMetadata = new QVector<QVariant>;
+        mMetadata = new (sMetadataPool.allocate(sizeof(MetadataArray))) MetadataArray;
     }
 
     const int cnt = mMetadata->count();			// current size of array
@@ -460,18 +1135,18 @@ QVariant TrackDataItem::metadata(int idx) const
 
 QVariant TrackDataItem::metadata(const QByteArray &key) const
 {
-    if (mMetadata==nullptr) return (QVariant());
     return (metadata(DataIndexer::index(key)));
 }
 
 
 void TrackDataItem::copyMetadata(const TrackDataItem *other, bool overwrite)
 {
-    if (other->mMetadata==nullptr) return;		// nothing to copy
-
-    for (int idx = 0; idx<other->mMetadata->size(); ++idx)
+    // Not only the metadata array of the other item, there may also
+    // be metadata stored directly within it if it is a point.
+    const int cnt = DataIndexer::count();
+    for (int idx = 0; idx<cnt; ++idx)
     {
-        QVariant om = other->mMetadata->at(idx);
+        QVariant om = other->metadata(idx);
         if (om.isNull()) continue;			// no source metadata
         QVariant tm = this->metadata(idx);
         if (!tm.isNull() && !overwrite) continue;	// already in destination and no overwrite
@@ -485,7 +1160,7 @@ QString TrackDataItem::timeZone() const
     const TrackDataItem *item = this;
     while (item!=nullptr)
     {
-        const QVariant &v = item->metadata("timezone");	// look for timezone in metadata
+        const QVariant &v = item->metadata(DataIndexer::IndexTimezone);	// look for timezone in metadata
         if (!v.isNull()) return (v.toString());
         item = item->parent();				// if present, use that
     }
@@ -552,20 +1227,49 @@ TrackDataSegment::TrackDataSegment()
 #ifdef MEMORY_TRACKING
     ++allocSegment;
 #endif
+    mColumns = nullptr;
+}
+
+
+TrackDataSegment::~TrackDataSegment()
+{
+    PointColumns::discard(&mColumns);
+}
+
+
+void TrackDataSegment::invalidateCache()
+{
+    PointColumns::discard(&mColumns);
+    TrackDataItem::invalidateCache();
+}
+
+
+const PointColumns *TrackDataSegment::columns() const
+{
+    return (PointColumns::obtain(this, &mColumns));
+}
+
+
+void TrackDataSegment::setDeferredPoints(DeferredPointSource *source, int count,
+                                         const BoundingArea &area, const TimeRange &span)
+{
+    setDeferredChildren(source, count, area, span);
 }
 
 
 // Optimisation, assumes that points are in chronological order
 TimeRange TrackDataSegment::timeSpan() const
 {
+    if (hasDeferredChildren()) return (TrackDataItem::timeSpan());
+							// summary until loaded
     int num = childCount();
     if (num==0) return (TimeRange());
 
-    const TrackDataTrackpoint *firstPoint = dynamic_cast<const TrackDataTrackpoint *>(childAt(0));
+    const TrackDataTrackpoint *firstPoint = TrackData::cast<TrackDataTrackpoint>(childAt(0));
     Q_ASSERT(firstPoint!=nullptr);
     if (num==1) return (TimeRange(firstPoint->time(), firstPoint->time()));
 
-    const TrackDataTrackpoint *lastPoint = dynamic_cast<const TrackDataTrackpoint *>(childAt(num-1));
+    const TrackDataTrackpoint *lastPoint = TrackData::cast<TrackDataTrackpoint>(childAt(num-1));
     Q_ASSERT(lastPoint!=nullptr);
     return (TimeRange(firstPoint->time(), lastPoint->time()));
 }
@@ -576,18 +1280,95 @@ TimeRange TrackDataSegment::timeSpan() const
 //									//
 //////////////////////////////////////////////////////////////////////////
 
-TrackDataAbstractPoint::TrackDataAbstractPoint(const char *format, int *counter)
+TrackDataAbstractPoint::TrackDataAbstractPoint(const char *format, QAtomicInt *counter)
     : TrackDataItem(format, counter)
 {
     mLatitude = mLongitude = NAN;
+    mElevation = mSpeed = mHdop = NAN;
+    mTime = TrackData::NoTime;
+}
+
+
+void TrackDataAbstractPoint::setLatLong(double lat, double lon)
+{
+    mLatitude = lat;
+    mLongitude = lon;
+    invalidateCache();
 }
 
 
-double TrackDataAbstractPoint::elevation() const
+void TrackDataAbstractPoint::setElevation(double ele)
 {
-    const QVariant v = metadata("ele");
+    mElevation = ele;
+    invalidateCache();
+}
+
+
+void TrackDataAbstractPoint::setTime(const QDateTime &dt)
+{
+    setTimeMSecs(dt.isValid() ? dt.toMSecsSinceEpoch() : TrackData::NoTime);
+}
+
+
+void TrackDataAbstractPoint::setTimeMSecs(qint64 t)
+{
+    mTime = t;
+    invalidateCache();
+}
+
+
+void TrackDataAbstractPoint::setSpeed(double spd)
+{
+    mSpeed = spd;					// not used by any cache
+}
+
+
+void TrackDataAbstractPoint::setHdop(double hdop)
+{
+    mHdop = hdop;					// not used by any cache
+}
+
+
+// Convert a metadata value to be stored as a double.  A null
+// value or one that cannot be converted means that the value
+// is absent.
+static double metadataToDouble(const QVariant &value, int idx)
+{
+    const QVariant v = TrackData::valueOrNull(value);
     if (v.isNull()) return (NAN);
-    return (v.toDouble());
+
+    bool ok;
+    const double d = v.toDouble(&ok);
+    if (ok) return (d);
+
+    qWarning() << "invalid value" << value << "for" << DataIndexer::name(idx);
+    return (NAN);
+}
+
+
+QVariant TrackDataAbstractPoint::metadata(int idx) const
+{
+    switch (idx)
+    {
+case DataIndexer::IndexEle:	return (ISNAN(mElevation) ? QVariant() : QVariant(mElevation));
+case DataIndexer::IndexTime:	return (mTime==TrackData::NoTime ? QVariant() : QVariant(time()));
+case DataIndexer::IndexSpeed:	return (ISNAN(mSpeed) ? QVariant() : QVariant(mSpeed));
+case DataIndexer::IndexHdop:	return (ISNAN(mHdop) ? QVariant() : QVariant(mHdop));
+default:			return (TrackDataItem::metadata(idx));
+    }
+}
+
+
+void TrackDataAbstractPoint::setMetadata(int idx, const QVariant &value)
+{
+    switch (idx)
+    {
+case DataIndexer::IndexEle:	setElevation(metadataToDouble(value, idx));		break;
+case DataIndexer::IndexTime:	setTime(TrackData::valueOrNull(value).toDateTime());	break;
+case DataIndexer::IndexSpeed:	setSpeed(metadataToDouble(value, idx));			break;
+case DataIndexer::IndexHdop:	setHdop(metadataToDouble(value, idx));			break;
+default:			TrackDataItem::setMetadata(idx, value);			break;
+    }
 }
 
 
@@ -601,9 +1382,8 @@ QString TrackDataAbstractPoint::formattedElevation() const
 
 QDateTime TrackDataAbstractPoint::time() const
 {
-    const QVariant v = metadata("time");
-    if (v.isNull()) return (QDateTime());
-    return (v.toDateTime());
+    if (mTime==TrackData::NoTime) return (QDateTime());
+    return (QDateTime::fromMSecsSinceEpoch(mTime, Qt::UTC));
 }
 
 
@@ -692,7 +1472,8 @@ double TrackDataAbstractPoint::bearingTo(const TrackDataAbstractPoint *other) co
 
 int TrackDataAbstractPoint::timeTo(const TrackDataAbstractPoint *other) const
 {
-    return (time().secsTo(other->time()));
+    if (mTime==TrackData::NoTime || other->mTime==TrackData::NoTime) return (0);
+    return ((other->mTime-mTime)/1000);			// as for QDateTime::secsTo()
 }
 
 
@@ -716,7 +1497,7 @@ QString TrackDataFolder::path() const
     QStringList p(name());
     const TrackDataItem *pnt = parent();
 
-    while (pnt!=nullptr && dynamic_cast<const TrackDataFile *>(pnt)==nullptr)
+    while (pnt!=nullptr && pnt->type()!=TrackData::File)
     {
         p.prepend(pnt->name());
         pnt = pnt->parent();
@@ -739,6 +1520,18 @@ TrackDataTrackpoint::TrackDataTrackpoint()
 #endif
 }
 
+
+void *TrackDataTrackpoint::operator new(size_t size)
+{
+    return (sTrackpointPool.allocate(size));
+}
+
+
+void TrackDataTrackpoint::operator delete(void *ptr, size_t size)
+{
+    sTrackpointPool.deallocate(ptr, size);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //									//
 //  TrackDataWaypoint							//
@@ -756,12 +1549,12 @@ TrackDataWaypoint::TrackDataWaypoint()
 
 TrackData::WaypointType TrackDataWaypoint::waypointType() const
 {
-    QVariant n = metadata("stop");			// first try saved stop data
+    QVariant n = metadata(DataIndexer::IndexStop);	// first try saved stop data
     if (!n.isNull()) return (TrackData::WaypointStop);	// this means it's a stop
 
-    n = metadata("link");				// then get saved link name
+    n = metadata(DataIndexer::IndexLink);		// then get saved link name
     // TODO: eliminate "media" here and in MediaPlayer, translate in importer
-    if (n.isNull()) n = metadata("media");		// compatibility with old metadata
+    if (n.isNull()) n = metadata(DataIndexer::IndexMedia);	// compatibility with old metadata
     if (n.isNull()) n = name();				// lastly try our waypoint name
     if (n.isNull()) return (TrackData::WaypointNormal);	// no media data present
 
@@ -802,7 +1595,7 @@ QIcon TrackDataWaypoint::icon() const
 {
     if (waypointType()!=TrackData::WaypointNormal) return (TrackDataItem::icon());
 
-    const QColor col = metadata("pointcolor").value<QColor>();
+    const QColor col = metadata(DataIndexer::IndexPointcolor).value<QColor>();
     if (!col.isValid()) return (TrackDataItem::icon());
 #ifdef DEBUG_ICONS
     qDebug() << "need icon for waypoint" << name() << "colour" << col.name();
@@ -825,6 +1618,26 @@ TrackDataRoute::TrackDataRoute()
 #ifdef MEMORY_TRACKING
     ++allocRoute;
 #endif
+    mColumns = nullptr;
+}
+
+
+TrackDataRoute::~TrackDataRoute()
+{
+    PointColumns::discard(&mColumns);
+}
+
+
+void TrackDataRoute::invalidateCache()
+{
+    PointColumns::discard(&mColumns);
+    TrackDataItem::invalidateCache();
+}
+
+
+const PointColumns *TrackDataRoute::columns() const
+{
+    return (PointColumns::obtain(this, &mColumns));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -841,6 +1654,18 @@ TrackDataRoutepoint::TrackDataRoutepoint()
 #endif
 }
 
+
+void *TrackDataRoutepoint::operator new(size_t size)
+{
+    return (sRoutepointPool.allocate(size));
+}
+
+
+void TrackDataRoutepoint::operator delete(void *ptr, size_t size)
+{
+    sRoutepointPool.deallocate(ptr, size);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //									//
 //  Memory tracking							//
@@ -888,6 +1713,8 @@ MemoryTracker::~MemoryTracker()
     qDebug() << "routepoint allocated" << allocRoutepoint << "items, total" << allocRoutepoint*sizeof(TrackDataRoutepoint) << "bytes";
     qDebug() << "child list allocated" << allocChildren;
     qDebug() << "metadata allocated" << allocMetadata;
+    qDebug() << "trackpoints in pool" << sTrackpointPool.count();
+    qDebug() << "routepoints in pool" << sRoutepointPool.count();
     qDebug() << "***********";
 }
 
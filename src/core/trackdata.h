@@ -27,12 +27,14 @@
 #define TRACKDATA_H
 
 #include <math.h>
+#include <limits>
 
 #include <qvariant.h>
 #include <qlist.h>
 #include <qdatetime.h>
 #include <qvector.h>
 #include <qurl.h>
+#include <qatomic.h>
 
 #define ISNAN(x)		std::isnan(x)		// to cover variations
 
@@ -44,7 +46,14 @@ class QWidget;
 class QTimeZone;
 class QIcon;
 class TrackDataItem;
+class TrackDataFile;
+class TrackDataTrack;
+class TrackDataSegment;
 class TrackDataFolder;
+class TrackDataTrackpoint;
+class TrackDataWaypoint;
+class TrackDataRoute;
+class TrackDataRoutepoint;
 class TrackPropertiesPage;
 
 //////////////////////////////////////////////////////////////////////////
@@ -141,9 +150,9 @@ private:
 
 namespace TrackData
 {
-    // These types are only used for classifying the tree view selection.
-    // They are not stored in the individual data classes, we rely on
-    // RTTI to distinguish between them.
+    // These types are used for classifying the tree view selection,
+    // and are returned by TrackDataItem::type() to identify the class
+    // of an item.  See TrackData::cast() and TrackDataVisitor below.
     enum Type
     {
         None,
@@ -200,8 +209,110 @@ namespace TrackData
     TrackDataFolder *findFolderByPath(const QString &path, const TrackDataItem *root);
 
     QVariant valueOrNull(const QVariant &value);
+
+    // Value used for a point time (in milliseconds since the epoch)
+    // when the point has no time recorded.
+    constexpr qint64 NoTime = std::numeric_limits<qint64>::min();
+
+    // The number of times that deferred points have been loaded, see
+    // DeferredPointSource.  Anything that is built from all of the
+    // points in a data tree, but which does not itself cause deferred
+    // points to be loaded, needs to be rebuilt if this changes.
+    int deferredLoadCount();
 }
 
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  PointColumns							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// Values derived from all of the points within a segment or route, held
+// as contiguous arrays.  These are the cumulative travel distance and
+// elapsed time from the first point, so that the distance or time between
+// any two points within the container can be found without needing to
+// step through all of the points in between.  The distance is in internal
+// units, as calculated by TrackDataAbstractPoint::distanceTo().  An
+// interval where either point has no time is counted as zero time.
+//
+// The point items themselves hold the only copy of their values, so
+// that the model, selection and undo commands continue to operate on
+// them as before.  The columns are built on demand by
+// TrackDataSegment::columns() or TrackDataRoute::columns(), and are
+// discarded whenever the position, time or elevation of any of the
+// points or the container itself change.
+//
+// Only a limited number of points are held in all of the columns in
+// total.  When that is exceeded the columns that were least recently
+// requested are discarded, to be rebuilt if they are needed again.
+// So the pointer returned by columns() is only valid until the columns
+// of another container are requested.  The columns may only be requested
+// by the GUI thread, which is the only one that uses them; this is
+// checked in a debug build.
+
+class PointColumns
+{
+public:
+    // For use by the container owning the columns.  The slot is its
+    // member holding them, which is cleared if they are discarded.
+    static const PointColumns *obtain(const TrackDataItem *container, PointColumns **slot);
+    static void discard(PointColumns **slot);
+
+    int count() const					{ return (mDistances.count()); }
+
+    double distance(int i) const			{ return (mDistances.at(i)); }
+    double distanceBetween(int i, int j) const		{ return (mDistances.at(j)-mDistances.at(i)); }
+    double totalDistance() const			{ return (mDistances.isEmpty() ? 0.0 : mDistances.last()); }
+    int timeBetween(int i, int j) const			{ return ((mElapsed.at(j)-mElapsed.at(i))/1000); }
+    int totalTime() const				{ return (mElapsed.isEmpty() ? 0 : mElapsed.last()/1000); }
+
+private:
+    explicit PointColumns(const TrackDataItem *container);
+    Q_DISABLE_COPY(PointColumns)
+
+    void unlink();
+    void linkFirst();
+
+private:
+    PointColumns **mSlot;				// owner's pointer to these
+    PointColumns *mPrev;				// more recently used
+    PointColumns *mNext;				// less recently used
+
+    QVector<double> mDistances;
+    QVector<qint64> mElapsed;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  DeferredPointSource							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// The points of a segment may be left on disk when a file is loaded,
+// and only read when they are first needed.  Until then the segment
+// only holds the number of points, its bounding area and its time span,
+// which are enough for the tree view and for deciding whether it needs
+// to be drawn on the map.  See TrackDataSegment::setDeferredPoints().
+//
+// The points are loaded as soon as any of them is accessed by childAt(),
+// or the children of the segment are changed.  This happens transparently,
+// so anything that needs the points (such as drawing, plotting, editing
+// or saving) will cause them to be loaded.  Anything that does not, such
+// as the PointIndex, should check hasDeferredChildren() first.
+
+class DeferredPointSource
+{
+public:
+    virtual ~DeferredPointSource() = default;
+
+    // Create the points and add them to the segment.  This must add
+    // exactly the number of points that was specified when the source
+    // was set, so that the data model remains consistent.  If the points
+    // cannot be read, then points without any position should be added
+    // and false returned.
+    virtual bool loadPoints(TrackDataSegment *seg) = 0;
+};
+
 //////////////////////////////////////////////////////////////////////////
 //									//
 //  TrackDataItem							//
@@ -215,15 +326,18 @@ public:
 
     virtual TrackData::Type type() const = 0;
 
-    QString name() const				{ return (mName); }
+    QString name() const;
     void setName(const QString &newName, bool explicitName);
     bool hasExplicitName() const			{ return (mExplicitName); }
 
     virtual QIcon icon() const;
 
-    int childCount() const				{ return (mChildren==nullptr ? 0 : mChildren->count()); }
-    TrackDataItem *childAt(int idx) const		{ Q_ASSERT(mChildren!=nullptr); return (mChildren->at(idx)); }
-    int childIndex(const TrackDataItem *data) const	{ Q_ASSERT(mChildren!=nullptr); return (mChildren->indexOf(const_cast<TrackDataItem *>(data))); }
+    // For a segment with deferred points, childCount() returns the number
+    // of points without loading them but childAt() loads them.
+    int childCount() const				{ return (mChildren==nullptr ? 0 : (mChildren->deferred==nullptr ? mChildren->items.count() : mChildren->deferredCount)); }
+    TrackDataItem *childAt(int idx) const		{ Q_ASSERT(mChildren!=nullptr); if (mChildren->deferred!=nullptr) loadDeferred(); return (mChildren->items.at(idx)); }
+    bool hasDeferredChildren() const			{ return (mChildren!=nullptr && mChildren->deferred!=nullptr); }
+    int childIndex(const TrackDataItem *data) const;
     TrackDataItem *parent() const			{ return (mParent); }
 
     void addChildItem(TrackDataItem *data, int idx = -1);
@@ -235,30 +349,70 @@ public:
     unsigned long selectionId() const			{ return (mSelectionId); }
     void setSelectionId(unsigned long id)		{ mSelectionId = id; }
 
-    QVariant metadata(int idx) const;
+    virtual QVariant metadata(int idx) const;
     QVariant metadata(const QByteArray &key) const;
-    void setMetadata(int idx, const QVariant &value);
+    virtual void setMetadata(int idx, const QVariant &value);
     void setMetadata(const QByteArray &key, const QVariant &value);
     void copyMetadata(const TrackDataItem *other, bool overwrite = false);
+    // The size of the general metadata array.  There is no general
+    // metadata for any index at or above this, although a point may
+    // still have values stored directly within it.
+    int metadataCount() const				{ return (mMetadata==nullptr ? 0 : mMetadata->count()); }
 
+    // For a container item, these are calculated from all of its
+    // children when first needed and then cached until invalidateCache().
     virtual BoundingArea boundingArea() const;
     virtual TimeRange timeSpan() const;
     QString timeZone() const;
 
+    /**
+     * Discard any cached data derived from this item or its children.
+     *
+     * This is called automatically when children are added or removed,
+     * or when the position, time or elevation of a point is changed.
+     * Other metadata is not used by any cached data, so changing it
+     * does not call this.  The base
+     * implementation passes the notification on to the parent item;
+     * an item holding cached data should discard it and then call
+     * the base implementation.
+     **/
+    virtual void invalidateCache();
+
 protected:
-    TrackDataItem(const char *format = nullptr, int *counter = nullptr);
+    TrackDataItem(const char *format = nullptr, QAtomicInt *counter = nullptr);
 
     virtual QString iconName() const = 0;
 
+    void setDeferredChildren(DeferredPointSource *source, int count,
+                             const BoundingArea &area, const TimeRange &span);
+
 private:
     TrackDataItem(const TrackDataItem &other) = delete;
     TrackDataItem &operator=(const TrackDataItem &other) = delete;
 
     void init();
+    void loadDeferred() const;
+
+    // The children of a container item and values derived from
+    // them.  Only allocated when the first child is added.
+    struct ChildData
+    {
+        QList<TrackDataItem *> items;
+        BoundingArea area;				// cached boundingArea()
+        TimeRange span;					// cached timeSpan()
+        bool areaValid = false;
+        bool spanValid = false;
+        int validRows = 0;				// children with correct mRow
+        DeferredPointSource *deferred = nullptr;	// not loaded yet
+        int deferredCount = 0;				// number to be loaded
+    };
 
     QString mName;
+    const char *mNameFormat;
+    int mNameNumber;
     bool mExplicitName;
-    QList<TrackDataItem *> *mChildren;
+    int mRow;						// index within parent, see childIndex()
+    ChildData *mChildren;
     QVector<QVariant> *mMetadata;
     TrackDataItem *mParent;
     unsigned long mSelectionId;
@@ -278,6 +432,7 @@ public:
     virtual ~TrackDataFile() = default;
 
     TrackData::Type type() const override		{ return (TrackData::File); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::File); }
 
     QUrl fileName() const				{ return (mFileName); }
     void setFileName(const QUrl &file);
@@ -308,6 +463,7 @@ public:
     virtual ~TrackDataTrack() = default;
 
     TrackData::Type type() const override		{ return (TrackData::Track); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Track); }
 
     DEFINE_PROPERTIES_PAGE(General)
     DEFINE_PROPERTIES_PAGE(Detail)
@@ -329,9 +485,10 @@ class TrackDataSegment : public TrackDataItem, public TrackPropertiesInterface
 {
 public:
     explicit TrackDataSegment();
-    virtual ~TrackDataSegment() = default;
+    virtual ~TrackDataSegment();
 
     TrackData::Type type() const override		{ return (TrackData::Segment); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Segment); }
 
     DEFINE_PROPERTIES_PAGE(General)
     DEFINE_PROPERTIES_PAGE(Detail)
@@ -340,9 +497,21 @@ public:
     DEFINE_PROPERTIES_PAGE(Metadata)
 
     TimeRange timeSpan() const override;
+    void invalidateCache() override;
+
+    const PointColumns *columns() const;
+
+    // Set the source from which the points will be loaded when they
+    // are needed, see DeferredPointSource.  The segment must not have
+    // any points, and takes ownership of the source.
+    void setDeferredPoints(DeferredPointSource *source, int count,
+                           const BoundingArea &area, const TimeRange &span);
 
 protected:
     QString iconName() const override			{ return ("chart_segment"); }
+
+private:
+    mutable PointColumns *mColumns;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -358,6 +527,7 @@ public:
     virtual ~TrackDataFolder() = default;
 
     TrackData::Type type() const override		{ return (TrackData::Folder); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Folder); }
 
     DEFINE_PROPERTIES_PAGE(General)
     DEFINE_PROPERTIES_PAGE(Detail)
@@ -377,19 +547,43 @@ protected:
 //									//
 //////////////////////////////////////////////////////////////////////////
 
+// The well known GPX point elements "ele", "time", "speed" and "hdop"
+// are stored directly in the point instead of in the general metadata.
+// They are still accessible as metadata by their index or name, but the
+// typed accessors are much more efficient.  An absent value is NAN,
+// or TrackData::NoTime for the time.
+
 class TrackDataAbstractPoint : public TrackDataItem
 {
 public:
-    TrackDataAbstractPoint(const char *format, int *counter);
+    TrackDataAbstractPoint(const char *format, QAtomicInt *counter);
     virtual ~TrackDataAbstractPoint() = default;
 
-    void setLatLong(double lat, double lon)		{ mLatitude = lat; mLongitude = lon; }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Trackpoint ||
+                                                                  t==TrackData::Waypoint ||
+                                                                  t==TrackData::Routepoint); }
+
+    void setLatLong(double lat, double lon);
 
-    double elevation() const;
+    double elevation() const				{ return (mElevation); }
+    void setElevation(double ele);
     QDateTime time() const;
+    void setTime(const QDateTime &dt);
+    qint64 timeMSecs() const				{ return (mTime); }
+    void setTimeMSecs(qint64 t);
+    double speed() const				{ return (mSpeed); }
+    void setSpeed(double spd);
+    double hdop() const					{ return (mHdop); }
+    void setHdop(double hdop);
+
     double latitude() const				{ return (mLatitude); }
     double longitude() const				{ return (mLongitude); }
 
+    using TrackDataItem::metadata;
+    using TrackDataItem::setMetadata;
+    QVariant metadata(int idx) const override;
+    void setMetadata(int idx, const QVariant &value) override;
+
     QString formattedElevation() const;
     QString formattedTime(bool withZone = false) const;
     QString formattedPosition() const;
@@ -404,6 +598,10 @@ public:
 private:
     double mLatitude;
     double mLongitude;
+    double mElevation;
+    double mSpeed;
+    double mHdop;
+    qint64 mTime;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -418,7 +616,12 @@ public:
     explicit TrackDataTrackpoint();
     virtual ~TrackDataTrackpoint() = default;
 
+    // Allocated from a pool, see ItemPool
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     TrackData::Type type() const override		{ return (TrackData::Trackpoint); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Trackpoint); }
 
     DEFINE_PROPERTIES_PAGE(General)
     DEFINE_PROPERTIES_PAGE(Detail)
@@ -443,6 +646,7 @@ public:
     virtual ~TrackDataWaypoint() = default;
 
     TrackData::Type type() const override		{ return (TrackData::Waypoint); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Waypoint); }
 
     QIcon icon() const override;
 
@@ -469,9 +673,10 @@ class TrackDataRoute : public TrackDataItem, public TrackPropertiesInterface
 {
 public:
     explicit TrackDataRoute();
-    virtual ~TrackDataRoute() = default;
+    virtual ~TrackDataRoute();
 
     TrackData::Type type() const override		{ return (TrackData::Route); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Route); }
 
     QString iconName() const override			{ return ("chart_route"); }
 
@@ -480,6 +685,13 @@ public:
     DEFINE_PROPERTIES_PAGE(Style)
     DEFINE_PROPERTIES_PAGE(Plot)
     DEFINE_PROPERTIES_PAGE(Metadata)
+
+    void invalidateCache() override;
+
+    const PointColumns *columns() const;
+
+private:
+    mutable PointColumns *mColumns;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -494,7 +706,12 @@ public:
     explicit TrackDataRoutepoint();
     virtual ~TrackDataRoutepoint() = default;
 
+    // Allocated from a pool, see ItemPool
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     TrackData::Type type() const override		{ return (TrackData::Routepoint); }
+    static bool isType(TrackData::Type t)		{ return (t==TrackData::Routepoint); }
 
     // There is a "chart_routepoint" icon (present for completeness),
     // but the flag looks better on the map and plot.  So use it in the
@@ -508,4 +725,156 @@ public:
     DEFINE_PROPERTIES_PAGE(Metadata)
 };
 
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Type dispatch							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// Each item class has a static isType() which tests whether an item
+// with the specified TrackData::Type is of that class, so that the
+// type of an item can be tested and the item converted without needing
+// RTTI.  For example:
+//
+//   const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(item);
+//   if (tdw!=nullptr) ...
+//
+// is equivalent to, but much more efficient than
+//
+//   const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(item);
+//
+// For processing all of the items in a tree, use TrackData::visit()
+// with a TrackDataVisitor.
+
+class TrackDataVisitor
+{
+public:
+    virtual ~TrackDataVisitor() = default;
+
+    // Called for each container item.  Return true to go on to
+    // visit the children of the item, or false to skip them.
+    virtual bool visitFile(const TrackDataFile *item)			{ Q_UNUSED(item); return (true); }
+    virtual bool visitTrack(const TrackDataTrack *item)		{ Q_UNUSED(item); return (true); }
+    virtual bool visitSegment(const TrackDataSegment *item)		{ Q_UNUSED(item); return (true); }
+    virtual bool visitFolder(const TrackDataFolder *item)		{ Q_UNUSED(item); return (true); }
+    virtual bool visitRoute(const TrackDataRoute *item)		{ Q_UNUSED(item); return (true); }
+
+    // Called for each point item.
+    virtual void visitTrackpoint(const TrackDataTrackpoint *item)	{ Q_UNUSED(item); }
+    virtual void visitWaypoint(const TrackDataWaypoint *item)		{ Q_UNUSED(item); }
+    virtual void visitRoutepoint(const TrackDataRoutepoint *item)	{ Q_UNUSED(item); }
+};
+
+
+namespace TrackData
+{
+    template<class T> inline T *cast(TrackDataItem *item)
+    {
+        return ((item!=nullptr && T::isType(item->type())) ? static_cast<T *>(item) : nullptr);
+    }
+
+    template<class T> inline const T *cast(const TrackDataItem *item)
+    {
+        return ((item!=nullptr && T::isType(item->type())) ? static_cast<const T *>(item) : nullptr);
+    }
+
+    /**
+     * Visit an item and all of its descendants.
+     *
+     * @param item The item to start at
+     * @param visitor The visitor to be called for each item, according
+     * to its type.  Items of any other type (for example, an undo
+     * command container) are not visited but their children are.
+     **/
+    void visit(const TrackDataItem *item, TrackDataVisitor *visitor);
+
+    /**
+     * Get the point columns for an ordered point container.
+     *
+     * @param item The item, which should be a segment or a route
+     * @return The columns for the item, or @c nullptr if it is
+     * not a segment or a route.
+     **/
+    const PointColumns *pointColumns(const TrackDataItem *item);
+
+    // Batch calculations over arrays of points, such as those provided
+    // by PointColumns.  These give the same results as the corresponding
+    // TrackDataAbstractPoint functions for each pair of consecutive
+    // points, but work directly on contiguous arrays without needing any
+    // point items, and calculate the per-point values (such as the sine
+    // and cosine of the latitude) only once instead of for both of the
+    // pairs that each point is part of.  They do not allocate any memory.
+    // For each of them, the first output value corresponds to the first
+    // point and so has no previous point.
+
+    /**
+     * Calculate the distance between consecutive points.
+     *
+     * @param lat The latitudes of the points
+     * @param lon The longitudes of the points
+     * @param n The number of points
+     * @param out The distance from each point to the next, in internal
+     * units, is returned here.  This must have room for @p n values,
+     * and the first will be zero.
+     * @param accurate As for TrackDataAbstractPoint::distanceTo()
+     **/
+    void distances(const double *lat, const double *lon, int n, double *out, bool accurate = false);
+
+    /**
+     * Calculate the bearing between consecutive points.
+     *
+     * @param lat The latitudes of the points
+     * @param lon The longitudes of the points
+     * @param n The number of points
+     * @param out The bearing from each point to the next, in degrees,
+     * is returned here.  This must have room for @p n values, and the
+     * first will be NAN.
+     **/
+    void bearings(const double *lat, const double *lon, int n, double *out);
+
+    /**
+     * Calculate the speed between consecutive points.
+     *
+     * @param dist The distances between the points, as calculated
+     * by @c distances()
+     * @param times The times of the points, in milliseconds since the
+     * epoch or TrackData::NoTime
+     * @param n The number of points
+     * @param out The speed from each point to the next, in internal
+     * units per second, is returned here.  This must have room for
+     * @p n values, and the first will be NAN.  The value is also NAN
+     * if either point has no time or they are at the same time.
+     **/
+    void speeds(const double *dist, const qint64 *times, int n, double *out);
+
+    /**
+     * Parse an ISO 8601 date/time string, as used in GPX files.
+     *
+     * The usual forms, with or without fractional seconds and with
+     * either a "Z" suffix or a "+hh:mm" offset, are parsed directly
+     * without any allocation.  Any other form is parsed by
+     * QDateTime::fromString() with the @c Qt::ISODate format.
+     *
+     * @param str The string to parse, in UTF-8 or ASCII
+     * @param len The length of the string
+     * @return the time in milliseconds since the epoch, or
+     * TrackData::NoTime if the string is not a valid date/time.
+     **/
+    qint64 parseIsoTime(const char *str, int len);
+
+    /**
+     * Parse a decimal number, independently of the locale.
+     *
+     * The number may have a sign, a fractional part and an exponent.
+     * Leading and trailing whitespace is ignored, but anything else
+     * (including "inf", "nan" or hexadecimal) is an error.
+     *
+     * @param str The string to parse, in UTF-8 or ASCII
+     * @param len The length of the string
+     * @param result The value is returned here, if it is valid
+     * @return @c true if the string was a valid number
+     **/
+    bool parseDouble(const char *str, int len, double *result);
+}
+
 #endif							// TRACKDATA_H
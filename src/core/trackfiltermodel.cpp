@@ -49,9 +49,9 @@ void TrackFilterModel::setSource(const QList<TrackDataItem *> *items)
     Q_ASSERT(!items->isEmpty());
     const TrackDataItem *item = items->first();
 
-    if (dynamic_cast<const TrackDataSegment *>(item)!=nullptr) mMode = TrackData::Segment;
-    else if (dynamic_cast<const TrackDataFolder *>(item)!=nullptr) mMode = TrackData::Folder;
-    else if (dynamic_cast<const TrackDataWaypoint *>(item)!=nullptr) mMode = TrackData::Waypoint;
+    if (TrackData::cast<TrackDataSegment>(item)!=nullptr) mMode = TrackData::Segment;
+    else if (TrackData::cast<TrackDataFolder>(item)!=nullptr) mMode = TrackData::Folder;
+    else if (TrackData::cast<TrackDataWaypoint>(item)!=nullptr) mMode = TrackData::Waypoint;
     Q_ASSERT(mMode!=TrackData::None);
 }
 
@@ -68,25 +68,25 @@ bool TrackFilterModel::filterAcceptsRow(int row, const QModelIndex &pnt) const
     QModelIndex idx = filesModel->index(row, 0, pnt);
     const TrackDataItem *item = filesModel->itemForIndex(idx);
 
-    if (dynamic_cast<const TrackDataFile *>(item)!=nullptr) return (true);
+    if (TrackData::cast<TrackDataFile>(item)!=nullptr) return (true);
     switch (mMode)
     {
 case TrackData::Segment:
-        if (dynamic_cast<const TrackDataTrack *>(item)!=nullptr) return (true);
-        if (dynamic_cast<const TrackDataSegment *>(item)!=nullptr) return (true);
+        if (TrackData::cast<TrackDataTrack>(item)!=nullptr) return (true);
+        if (TrackData::cast<TrackDataSegment>(item)!=nullptr) return (true);
         break;
 
 case TrackData::Folder:
-        if (dynamic_cast<const TrackDataFolder *>(item)!=nullptr) return (true);
+        if (TrackData::cast<TrackDataFolder>(item)!=nullptr) return (true);
         break;
 
 case TrackData::Route:
-        if (dynamic_cast<const TrackDataRoute *>(item)!=nullptr) return (true);
+        if (TrackData::cast<TrackDataRoute>(item)!=nullptr) return (true);
         break;
 
 case TrackData::Waypoint:
-        if (dynamic_cast<const TrackDataFolder *>(item)!=nullptr) return (true);
-        if (dynamic_cast<const TrackDataWaypoint *>(item)!=nullptr) return (true);
+        if (TrackData::cast<TrackDataFolder>(item)!=nullptr) return (true);
+        if (TrackData::cast<TrackDataWaypoint>(item)!=nullptr) return (true);
         break;
 
 default:
@@ -110,11 +110,11 @@ case TrackData::Segment:
         // of a source can be selected.  Files are enabled but cannot be
         // selected.
 
-        if (dynamic_cast<const TrackDataFile *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataFile>(item)!=nullptr)
         {
             return (Qt::ItemIsEnabled);
         }
-        else if (dynamic_cast<const TrackDataTrack *>(item)!=nullptr)
+        else if (TrackData::cast<TrackDataTrack>(item)!=nullptr)
         {
             if (mSourceItems!=nullptr)
             {
@@ -139,7 +139,7 @@ case TrackData::Folder:
         // be selected unless they are a source folder, or an immediate
         // parent or any child of one.
 
-        if (dynamic_cast<const TrackDataFile *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataFile>(item)!=nullptr)
         {
             if (mSourceItems!=nullptr)
             {
@@ -154,7 +154,7 @@ case TrackData::Folder:
                 }
             }
         }
-        else if (dynamic_cast<const TrackDataFolder *>(item)!=nullptr)
+        else if (TrackData::cast<TrackDataFolder>(item)!=nullptr)
         {
             if (mSourceItems!=nullptr)
             {
@@ -188,7 +188,7 @@ case TrackData::Waypoint:
         // In waypoint mode, any folder can be selected unless it
         // it the immediate parent of a source waypoint.
 
-        if (dynamic_cast<const TrackDataFolder *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataFolder>(item)!=nullptr)
         {
             if (mSourceItems!=nullptr)
             {
@@ -212,7 +212,7 @@ case TrackData::Route:
         // In route mode, any route can be selected unless it
         // it the immediate parent of a source point.
 
-        if (dynamic_cast<const TrackDataRoute *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataRoute>(item)!=nullptr)
         {
             if (mSourceItems!=nullptr)
             {
@@ -38,6 +38,7 @@
 #include "autotooltipdelegate.h"
 #include "settings.h"
 #include "filesmodel.h"
+#include "dataindexer.h"
 
 
 FilesView::FilesView(QWidget *pnt)
@@ -165,7 +166,7 @@ void FilesView::selectionChanged(const QItemSelection &sel,
         // (normally a segment for trackpoints or folder for waypoints, but
         // this is not enforced) to be selected also.  Only for drawing
         // purposes, not for any user operations.
-        TrackDataAbstractPoint *tdp = dynamic_cast<TrackDataAbstractPoint *>(tdi);
+        TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(tdi);
         if (tdp!=nullptr)				// this is a point
         {
             TrackDataItem *par = tdp->parent();
@@ -198,28 +199,32 @@ QList<TrackDataItem *> FilesView::selectedItems() const
 }
 
 
-static void getPointData(const TrackDataItem *item, QVector<const TrackDataAbstractPoint *> *points)
+// Collects all of the points within the selected items which have a
+// valid position, and also a valid time if they are track points or
+// waypoints.
+
+class PointDataCollector : public TrackDataVisitor
 {
-    const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(item);
-    if (tdp!=nullptr)					// is this a point?
+public:
+    explicit PointDataCollector(QVector<const TrackDataAbstractPoint *> *points)	: mPoints(points) {}
+
+    void visitTrackpoint(const TrackDataTrackpoint *item) override	{ addPoint(item, true); }
+    void visitWaypoint(const TrackDataWaypoint *item) override		{ addPoint(item, true); }
+    void visitRoutepoint(const TrackDataRoutepoint *item) override	{ addPoint(item, false); }
+
+private:
+    void addPoint(const TrackDataAbstractPoint *tdp, bool needTime)
     {
         if (ISNAN(tdp->latitude())) return;		// check position is valid
         if (ISNAN(tdp->longitude())) return;
+        if (needTime && tdp->timeMSecs()==TrackData::NoTime) return;
 
-        if (dynamic_cast<const TrackDataRoutepoint *>(tdp)==nullptr)
-        {						// if not a route point,
-            const QVariant dt = tdp->metadata("time");	// check time is valid
-            if (!dt.canConvert(QMetaType::QDateTime)) return;
-        }
-
-        points->append(tdp);				// add point to list
+        mPoints->append(tdp);				// add point to list
     }
-    else						// not a point, recurse for children
-    {
-        const int num = item->childCount();
-        for (int i = 0; i<num; ++i) getPointData(item->childAt(i), points);
-    }
-}
+
+private:
+    QVector<const TrackDataAbstractPoint *> *mPoints;
+};
 
 
 QVector<const TrackDataAbstractPoint *> FilesView::selectedPoints() const
@@ -227,7 +232,8 @@ QVector<const TrackDataAbstractPoint *> FilesView::selectedPoints() const
     QVector<const TrackDataAbstractPoint *> result;
 
     const QList<TrackDataItem *> items = selectedItems();
-    for (int i = 0; i<items.count(); ++i) getPointData(items[i], &result);
+    PointDataCollector collector(&result);
+    for (int i = 0; i<items.count(); ++i) TrackData::visit(items[i], &collector);
 
     qDebug() << "from" << items.count() << "items got" << result.count() << "points";
     return (result);
@@ -276,7 +282,7 @@ void FilesView::slotClickedItem(const QModelIndex &index, unsigned int flags)
     // its parent segment is expanded.  This avoids a long list of points
     // suddenly appearing in the view for a stray map click.
     const TrackDataItem *item = static_cast<FilesModel *>(model())->itemForIndex(index);
-    if (dynamic_cast<const TrackDataTrackpoint *>(item)!=nullptr)
+    if (TrackData::cast<TrackDataTrackpoint>(item)!=nullptr)
     {
         QModelIndex pnt = index.parent();
         if (!isExpanded(pnt)) return;
@@ -316,8 +322,8 @@ void FilesView::expandItem(const QModelIndex &idx)
 {
     const TrackDataItem *item = FilesModel::itemForIndex(idx);
 
-    if (dynamic_cast<const TrackDataSegment *>(item)!=nullptr ||
-        dynamic_cast<const TrackDataRoute *>(item)!=nullptr)
+    if (TrackData::cast<TrackDataSegment>(item)!=nullptr ||
+        TrackData::cast<TrackDataRoute>(item)!=nullptr)
     {
         collapse(idx);
         return;
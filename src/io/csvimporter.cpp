@@ -0,0 +1,396 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "csvimporter.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include <qvarlengtharray.h>
+#include <qdebug.h>
+
+#include <klocalizedstring.h>
+
+#include "trackdata.h"
+#include "dataindexer.h"
+#include "errorreporter.h"
+#include "xmltokenizer.h"
+
+
+#define PROGRESS_INTERVAL	4096			// lines between progress updates
+
+
+CsvImporter::CsvImporter()
+    : ImporterBase()
+{
+    qDebug();
+}
+
+
+QString CsvImporter::filter()
+{
+    return ("CSV log files (*.csv)");
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Field parsing							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// A date in the format "yyyy-mm-dd" or "yyyy/mm/dd".  Other formats
+// are ambiguous, so are not accepted.
+
+static bool parseDate(const ByteView &field, TimeOfDayStitcher *stitcher)
+{
+    const char *p = field.data();
+    if (field.size()!=10 || p[4]!=p[7] || (p[4]!='-' && p[4]!='/')) return (false);
+
+    int yy, mm, dd;
+    if (!LineReader::parseDigits(p, 4, &yy) ||
+        !LineReader::parseDigits(p+5, 2, &mm) || !LineReader::parseDigits(p+8, 2, &dd)) return (false);
+    return (stitcher->setDate(yy, mm, dd));
+}
+
+
+// A time of day in the format "hh:mm", "hh:mm:ss" or "hh:mm:ss.sss",
+// with one or two digits for each and any number of digits after the
+// decimal point.
+
+static bool parseTimeOfDay(const ByteView &field, int *msecs)
+{
+    const char *p = field.data();
+    const char *end = p+field.size();
+
+    int vals[3] = { 0, 0, 0 };				// hours, minutes, seconds
+    int num = 0;
+    while (num<3)
+    {
+        const char *q = p;
+        while (q<end && *q>='0' && *q<='9') ++q;
+        if (q==p || (q-p)>2) return (false);
+        LineReader::parseDigits(p, q-p, &vals[num++]);
+
+        p = q;
+        if (p==end || *p!=':') break;
+        ++p;
+    }
+    if (num<2) return (false);
+
+    int ms = 0;
+    if (num==3 && p<end && *p=='.')
+    {
+        int scale = 100;				// for first fraction digit
+        for (++p; p<end && *p>='0' && *p<='9'; ++p)
+        {
+            ms += (*p-'0')*scale;
+            scale /= 10;
+        }
+    }
+
+    if (p!=end || vals[0]>23 || vals[1]>59 || vals[2]>60) return (false);
+    *msecs = ((vals[0]*60+vals[1])*60+vals[2])*1000+ms;
+    return (true);
+}
+
+
+// Parse a time field.  A full time is returned in 'time', or
+// a time of day in 'timeOfDay' if that is all that there is.
+
+static bool parseTime(const ByteView &field, qint64 *time, int *timeOfDay)
+{
+    const char *p = field.data();
+    const int len = field.size();
+
+    if (len>=10 && p[4]=='-' && p[7]=='-')		// ISO 8601 date and time
+    {
+        // A space instead of the 'T' is common, but
+        // is not accepted by TrackData::parseIsoTime().
+        char buf[64];
+        if (len>10 && p[10]==' ' && len<int(sizeof(buf)))
+        {
+            memcpy(buf, p, len);
+            buf[10] = 'T';
+            p = buf;
+        }
+
+        *time = TrackData::parseIsoTime(p, len);
+        return (*time!=TrackData::NoTime);
+    }
+
+    if (memchr(p, ':', len)!=nullptr) return (parseTimeOfDay(field, timeOfDay));
+
+    // Seconds since the epoch, possibly with a fraction, or if
+    // it is too large for that then milliseconds since the epoch.
+    double val;
+    if (!TrackData::parseDouble(p, len, &val) || val<0) return (false);
+    *time = (val<1e11 ? qRound64(val*1000) : qint64(val));
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Reading the file							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+bool CsvImporter::loadFrom(QIODevice *dev)
+{
+    qDebug() << "starting";
+
+    mColumns.clear();
+    mStitcher = TimeOfDayStitcher();
+    mSegment = nullptr;
+
+    mPointCount = 0;
+    mSkippedRows = 0;
+    mUndatedPoints = 0;
+
+    LineReader reader(dev);
+    ByteView line;
+    bool cancelled = false;
+    while (reader.readLine(&line))
+    {
+        if ((reader.lineNumber()%PROGRESS_INTERVAL)==0 && !updateProgress(reader.position()))
+        {
+            cancelled = true;
+            break;
+        }
+
+        // Blank lines and comments are allowed anywhere
+        const ByteView trimmed = line.trimmed();
+        if (trimmed.isEmpty() || trimmed.at(0)=='#') continue;
+
+        if (mColumns.isEmpty())				// this must be the header
+        {
+            if (!readHeader(line)) return (false);
+        }
+        else readRow(line);
+    }
+
+    qDebug() << "done, lines" << reader.lineNumber() << "points" << mPointCount;
+
+    if (cancelled || reader.hasError())
+    {
+        delete mSegment;				// not added to file yet
+        mSegment = nullptr;
+        if (cancelled) return (setError("Loading cancelled"));
+        return (setError(i18n("Cannot read file at line %1, %2", reader.lineNumber(), reader.errorString())));
+    }
+
+    if (mColumns.isEmpty()) return (setError(i18n("No header line found")));
+    if (mSegment==nullptr) return (setError(i18n("No valid positions found")));
+
+    if (mSkippedRows>0)
+    {
+        reporter()->setError(ErrorReporter::Warning,
+                             i18np("%1 line with no valid position was ignored",
+                                   "%1 lines with no valid position were ignored", mSkippedRows));
+    }
+
+    if (mUndatedPoints>0)
+    {
+        reporter()->setError(ErrorReporter::Warning,
+                             i18np("No date was found for %1 point, its time is not known",
+                                   "No date was found for %1 points, their times are not known", mUndatedPoints));
+    }
+
+    TrackDataTrack *tdt = new TrackDataTrack;
+    tdt->addChildItem(mSegment);
+    mSegment = nullptr;
+    addCompletedItem(tdt);
+    return (true);
+}
+
+
+CsvImporter::ColumnType CsvImporter::columnType(const QByteArray &name)
+{
+    if (name.isEmpty()) return (ColumnIgnore);
+    if (name=="lat" || name=="latitude") return (ColumnLatitude);
+    if (name=="lon" || name=="lng" || name=="long" || name=="longitude") return (ColumnLongitude);
+    if (name=="ele" || name=="elevation" || name=="alt" || name=="altitude") return (ColumnElevation);
+    if (name=="time" || name=="timestamp" || name=="datetime" || name=="date_time" || name=="utc") return (ColumnTime);
+    if (name=="date") return (ColumnDate);
+    if (name=="speed") return (ColumnSpeed);
+    if (name=="hdop") return (ColumnHdop);
+    if (name=="heading" || name=="course" || name=="bearing") return (ColumnHeading);
+    if (name=="name") return (ColumnName);
+    return (ColumnMetadata);
+}
+
+
+bool CsvImporter::readHeader(const ByteView &line)
+{
+    ByteView header = line;
+    if (header.size()>=3 && memcmp(header.data(), "\xEF\xBB\xBF", 3)==0)
+    {							// UTF-8 byte order mark
+        header = ByteView(header.data()+3, header.size()-3);
+    }
+
+    // Use whichever possible separator appears most often
+    int commas = 0, semicolons = 0, tabs = 0;
+    for (int i = 0; i<header.size(); ++i)
+    {
+        switch (header.at(i))
+        {
+case ',':   ++commas;		break;
+case ';':   ++semicolons;	break;
+case '\t':  ++tabs;		break;
+        }
+    }
+
+    mSeparator = ',';
+    if (semicolons>commas && semicolons>=tabs) mSeparator = ';';
+    else if (tabs>commas && tabs>semicolons) mSeparator = '\t';
+
+    QVector<ByteView> fields(qMax(commas, qMax(semicolons, tabs))+1);
+    const int num = LineReader::splitFields(header, mSeparator, fields.data(), fields.count());
+
+    bool haveLat = false;
+    bool haveLon = false;
+    mColumns.resize(num);
+    for (int i = 0; i<num; ++i)
+    {
+        // A metadata name is also used as an element name for
+        // GPX export, so it must be a valid XML name.
+        QByteArray name = fields[i].trimmed().toByteArray().toLower();
+        for (char &c : name)
+        {
+            if (!isalnum(static_cast<unsigned char>(c)) && c!='_' && c!='-') c = '_';
+        }
+
+        Column &col = mColumns[i];
+        col.type = columnType(name);
+        col.index = (col.type==ColumnMetadata ? DataIndexer::index(name) : -1);
+        qDebug() << "column" << i << name << "type" << col.type;
+
+        if (col.type==ColumnLatitude) haveLat = true;
+        if (col.type==ColumnLongitude) haveLon = true;
+    }
+
+    if (!haveLat || !haveLon) return (setError(i18n("No latitude and longitude columns found")));
+    return (true);
+}
+
+
+// The point is completed before it is added to the segment, so
+// that setting its values does not need to invalidate any cached data.
+
+void CsvImporter::readRow(const ByteView &line)
+{
+    const int numColumns = mColumns.count();
+    QVarLengthArray<ByteView, 32> fields(numColumns);
+    const int num = LineReader::splitFields(line, mSeparator, fields.data(), numColumns);
+
+    TrackDataTrackpoint *tdp = new TrackDataTrackpoint;
+    double lat = NAN;
+    double lon = NAN;
+    qint64 time = TrackData::NoTime;
+    int timeOfDay = -1;
+
+    for (int i = 0; i<num; ++i)
+    {
+        const ByteView field = fields[i].trimmed();
+        if (field.isEmpty()) continue;
+
+        const Column &col = mColumns.at(i);
+        double val;
+        switch (col.type)
+        {
+case ColumnLatitude:
+            TrackData::parseDouble(field.data(), field.size(), &lat);
+            break;
+
+case ColumnLongitude:
+            TrackData::parseDouble(field.data(), field.size(), &lon);
+            break;
+
+case ColumnElevation:
+            if (TrackData::parseDouble(field.data(), field.size(), &val)) tdp->setElevation(val);
+            break;
+
+case ColumnSpeed:
+            if (TrackData::parseDouble(field.data(), field.size(), &val)) tdp->setSpeed(val);
+            break;
+
+case ColumnHdop:
+            if (TrackData::parseDouble(field.data(), field.size(), &val)) tdp->setHdop(val);
+            break;
+
+case ColumnHeading:
+            if (TrackData::parseDouble(field.data(), field.size(), &val)) tdp->setMetadata(DataIndexer::IndexHeading, val);
+            break;
+
+case ColumnTime:
+            parseTime(field, &time, &timeOfDay);
+            break;
+
+case ColumnDate:
+            parseDate(field, &mStitcher);
+            break;
+
+case ColumnName:
+            tdp->setName(field.toString().replace("\"\"", "\""), true);
+            break;
+
+case ColumnMetadata:
+            tdp->setMetadata(col.index, field.toString().replace("\"\"", "\""));
+            break;
+
+case ColumnIgnore:
+            break;
+        }
+    }
+
+    if (ISNAN(lat) || ISNAN(lon) || fabs(lat)>90 || fabs(lon)>180)
+    {							// no valid position
+        delete tdp;
+        ++mSkippedRows;
+        return;
+    }
+
+    // The date, if there is one, has been set above
+    if (time==TrackData::NoTime && timeOfDay>=0)
+    {
+        time = mStitcher.time(timeOfDay);
+        if (time==TrackData::NoTime) ++mUndatedPoints;
+    }
+
+    tdp->setLatLong(lat, lon);
+    tdp->setTimeMSecs(time);
+
+    if (mSegment==nullptr) mSegment = new TrackDataSegment;
+    mSegment->addChildItem(tdp);
+    ++mPointCount;
+}
+
+
+bool CsvImporter::setError(const QString &msg)
+{
+    // See SnapshotImporter::setError()
+    reporter()->setError(ErrorReporter::Fatal, msg);
+    return (false);
+}
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef CSVIMPORTER_H
+#define CSVIMPORTER_H
+
+#include <qvector.h>
+
+#include "importerbase.h"
+#include "linereader.h"
+
+class TrackDataSegment;
+class ByteView;
+
+
+// Imports a CSV log, as written by many GPS loggers and applications.
+// The first line must be a header naming the columns, which are
+// recognised by the usual names for each value.  Columns for at least
+// the latitude and longitude must be present.  Any unrecognised columns
+// are stored as metadata of each point.  The separator may be a comma,
+// semicolon or tab, whichever appears most in the header.
+//
+// The time may be a full ISO 8601 date and time, a number of seconds
+// or milliseconds since the epoch, or a time of day.  A time of day is
+// combined with a separate date column if there is one, and advanced
+// if the log continues past midnight.
+
+class CsvImporter : public ImporterBase
+{
+public:
+    CsvImporter();
+    virtual ~CsvImporter() = default;
+
+    static QString filter();
+
+    // ImporterBase
+    bool loadFrom(QIODevice *dev) override;
+
+private:
+    enum ColumnType
+    {
+        ColumnIgnore,
+        ColumnMetadata,
+        ColumnLatitude,
+        ColumnLongitude,
+        ColumnElevation,
+        ColumnTime,
+        ColumnDate,
+        ColumnSpeed,
+        ColumnHdop,
+        ColumnHeading,
+        ColumnName
+    };
+
+    struct Column
+    {
+        ColumnType type;
+        int index;					// DataIndexer index for metadata
+    };
+
+    static ColumnType columnType(const QByteArray &name);
+    bool readHeader(const ByteView &line);
+    void readRow(const ByteView &line);
+    bool setError(const QString &msg);
+
+private:
+    char mSeparator;
+    QVector<Column> mColumns;
+    TimeOfDayStitcher mStitcher;
+    TrackDataSegment *mSegment;
+
+    int mPointCount;
+    int mSkippedRows;
+    int mUndatedPoints;
+};
+
+#endif							// CSVIMPORTER_H
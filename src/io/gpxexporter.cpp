@@ -79,30 +79,31 @@ static void endExtensions(QXmlStreamWriter &str)
 }
 
 
-static bool isExtensionTag(const TrackDataItem *item, const QByteArray &name)
+static bool isExtensionTag(const TrackDataItem *item, int idx)
 {
-    if (dynamic_cast<const TrackDataFile *>(item)!=nullptr) return (false);
+    if (TrackData::cast<TrackDataFile>(item)!=nullptr) return (false);
 							// file metadata - never in extensions
-    if (DataIndexer::isApplicationTag(name)) return (true);
+    if (DataIndexer::isApplicationTag(idx)) return (true);
 							// application tag - always in extensions
-    if (dynamic_cast<const TrackDataAbstractPoint *>(item)!=nullptr)
+    if (TrackData::cast<TrackDataAbstractPoint>(item)!=nullptr)
     {
-        if (dynamic_cast<const TrackDataWaypoint *>(item)!=nullptr)
+        if (TrackData::cast<TrackDataWaypoint>(item)!=nullptr)
         {						// waypoint - these not in extensions
-            if (name=="link"|| name=="sym") return (false);
+            if (idx==DataIndexer::IndexLink || DataIndexer::name(idx)=="sym") return (false);
         }
 							// point - these not in extensions
-        return (!(name=="name" || name=="ele" || name=="time" || name=="hdop"));
+        return (!(idx==DataIndexer::IndexName || idx==DataIndexer::IndexEle ||
+                  idx==DataIndexer::IndexTime || idx==DataIndexer::IndexHdop));
     }
-    else if (dynamic_cast<const TrackDataTrack *>(item)!=nullptr)
+    else if (TrackData::cast<TrackDataTrack>(item)!=nullptr)
     {							// track - these not in extensions
-        return (!(name=="name" || name=="desc" || name=="type"));
+        return (!(idx==DataIndexer::IndexName || idx==DataIndexer::IndexDesc || idx==DataIndexer::IndexType));
     }
-    else if (dynamic_cast<const TrackDataRoute *>(item)!=nullptr)
+    else if (TrackData::cast<TrackDataRoute>(item)!=nullptr)
     {							// route - these not in extensions
-        return (!(name=="name" || name=="desc" || name=="type"));
+        return (!(idx==DataIndexer::IndexName || idx==DataIndexer::IndexDesc || idx==DataIndexer::IndexType));
     }
-    else if (dynamic_cast<const TrackDataSegment *>(item)!=nullptr)
+    else if (TrackData::cast<TrackDataSegment>(item)!=nullptr)
     {							// segment - all in extensions
         return (true);
     }
@@ -112,19 +113,19 @@ static bool isExtensionTag(const TrackDataItem *item, const QByteArray &name)
 
 static void writeMetadata(const TrackDataItem *item, QXmlStreamWriter &str, bool wantExtensions)
 {
-    for (int idx = 0; idx<DataIndexer::count(); ++idx)
+    const int num = DataIndexer::count();
+    for (int idx = 0; idx<num; ++idx)
     {
         //qDebug() << "metadata" << idx
         //         << "name" << DataIndexer::name(idx)
         //         << "=" << item->metadata(idx);
 
-        const QByteArray name = DataIndexer::name(idx);
-        if (MetadataModel::isInternalTag(name)) continue;
+        if (MetadataModel::isInternalTag(idx)) continue;
 							// ignore internally used tags
-        if (isExtensionTag(item, name) ^ wantExtensions) continue;
-							// check matches extension state
         const QVariant &v = item->metadata(idx);	// get metadata from item
         if (v.isNull()) continue;			// no data to output
+        if (isExtensionTag(item, idx) ^ wantExtensions) continue;
+							// check matches extension state
 
         if (wantExtensions) startExtensions(str);	// start extensions if needed
 
@@ -134,17 +135,17 @@ static void writeMetadata(const TrackDataItem *item, QXmlStreamWriter &str, bool
         // our own purposes.  The COLOR attribute of the item is also set
         // for use by other GPX applications.
 
-        if (name=="linecolor" || name =="pointcolor")	// line or point colour
-        {
+        if (idx==DataIndexer::IndexLinecolor || idx==DataIndexer::IndexPointcolor)
+        {						// line or point colour
             const QColor col = v.value<QColor>();
             // An alpha value of 0 means this item has no colour.
             // See TrackItemStylePage and FilesController::slotTrackProperties().
             if (col.alpha()==0) continue;
 
             data = col.name();				// in format "#rrggbb"
-            if (dynamic_cast<const TrackDataFile *>(item)==nullptr)
+            if (TrackData::cast<TrackDataFile>(item)==nullptr)
             {						// no COLOR at top level
-                if (dynamic_cast<const TrackDataAbstractPoint *>(item)!=nullptr)
+                if (TrackData::cast<TrackDataAbstractPoint>(item)!=nullptr)
                 {					// a point element
                     // OsmAnd: <color>#c0c0c0</color>
                     str.writeTextElement("color", data);
@@ -156,7 +157,7 @@ static void writeMetadata(const TrackDataItem *item, QXmlStreamWriter &str, bool
                 }
             }
         }
-        else if (name=="time")				// point or file time
+        else if (idx==DataIndexer::IndexTime)		// point or file time
         {
             data = v.toDateTime().toString(Qt::ISODate);
         }
@@ -165,14 +166,14 @@ static void writeMetadata(const TrackDataItem *item, QXmlStreamWriter &str, bool
             data = v.toString();			// default string format
         }
 
-        if (name=="link")				// special format for this
+        if (idx==DataIndexer::IndexLink)		// special format for this
         {
-            str.writeEmptyElement(name);
+            str.writeEmptyElement(DataIndexer::name(idx));
             str.writeAttribute("link", data);
         }
         else
         {
-            str.writeTextElement(DataIndexer::nameWithNamespace(name), data);
+            str.writeTextElement(DataIndexer::nameWithNamespace(idx), data);
         }
     }
 }
@@ -195,13 +196,13 @@ bool GpxExporter::writeItem(const TrackDataItem *item, QXmlStreamWriter &str) co
     bool status = true;
 
     // what sort of element?
-    const TrackDataTrack *tdt = dynamic_cast<const TrackDataTrack *>(item);
-    const TrackDataRoute *tdr = dynamic_cast<const TrackDataRoute *>(item);
-    const TrackDataSegment *tds = dynamic_cast<const TrackDataSegment *>(item);
-    const TrackDataTrackpoint *tdp = dynamic_cast<const TrackDataTrackpoint *>(item);
-    const TrackDataFolder *tdf = dynamic_cast<const TrackDataFolder *>(item);
-    const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(item);
-    const TrackDataRoutepoint *tdm = dynamic_cast<const TrackDataRoutepoint *>(item);
+    const TrackDataTrack *tdt = TrackData::cast<TrackDataTrack>(item);
+    const TrackDataRoute *tdr = TrackData::cast<TrackDataRoute>(item);
+    const TrackDataSegment *tds = TrackData::cast<TrackDataSegment>(item);
+    const TrackDataTrackpoint *tdp = TrackData::cast<TrackDataTrackpoint>(item);
+    const TrackDataFolder *tdf = TrackData::cast<TrackDataFolder>(item);
+    const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(item);
+    const TrackDataRoutepoint *tdm = TrackData::cast<TrackDataRoutepoint>(item);
 
     const bool isSel = isSelected(item);		// is the item selected?
     if (isSel)
@@ -308,11 +309,11 @@ bool GpxExporter::writeItem(const TrackDataItem *item, QXmlStreamWriter &str) co
         else if (tdw!=nullptr)				// extensions for WPT
         {
             writeMetadata(tdw, str, true);
-            const TrackDataFolder *fold = dynamic_cast<TrackDataFolder *>(tdw->parent());
+            const TrackDataFolder *fold = TrackData::cast<TrackDataFolder>(tdw->parent());
             if (fold!=nullptr)				// within a folder?
             {						// save the folder path
                 startExtensions(str);
-                str.writeTextElement(DataIndexer::nameWithNamespace("folder"), fold->path());
+                str.writeTextElement(DataIndexer::nameWithNamespace(DataIndexer::IndexFolder), fold->path());
             }
         }
 
@@ -349,7 +350,7 @@ bool GpxExporter::saveTo(QIODevice *dev, const TrackDataFile *item)
     // <gpx>
     str.writeStartElement("gpx");
     str.writeAttribute("version", "1.1");
-    str.writeAttribute("creator", item->metadata("creator").toString());
+    str.writeAttribute("creator", item->metadata(DataIndexer::IndexCreator).toString());
     str.writeAttribute("xmlns", "http://www.topografix.com/GPX/1/1");
     str.writeNamespace("http://www.garmin.com/xmlschemas/GpxExtensions/v3", "gpxx");
     str.writeNamespace("http://www.garmin.com/xmlschemas/TrackPointExtension/v1", "gpxtpx");
@@ -30,12 +30,14 @@
 #include "gpximporter.h"
 
 #include <QXmlStreamReader>
+#include <qfile.h>
 #include <qcolor.h>
 #include <qdebug.h>
 
 #include "trackdata.h"
 #include "dataindexer.h"
 #include "errorreporter.h"
+#include "xmltokenizer.h"
 
 #ifdef DEBUG_DETAILED
 #include <iostream>
@@ -44,10 +46,14 @@
 #define WAYPOINTS_FOLDER_NAME	"Waypoints"
 #define NOTES_FOLDER_NAME	"Notes"
 
+#define PROGRESS_INTERVAL	4096			// tokens between progress updates
+
 
 GpxImporter::GpxImporter()
     : ImporterBase()
 {
+    mXmlReader = nullptr;
+    mTokenizer = nullptr;
     qDebug();
 }
 
@@ -67,10 +73,75 @@ bool GpxImporter::loadFrom(QIODevice *dev)
     mCurrentPoint = nullptr;
 
     mUndefinedNamespaces.clear();
+    mStateStack.clear();
+
+    // A local file can be mapped into memory and parsed in place, which
+    // avoids reading it through the device and converting all of its
+    // text to QString's.  This can only be done if the file is encoded
+    // as UTF-8 or ASCII, otherwise QXmlStreamReader is used to handle the
+    // encoding.
+    QFile *file = qobject_cast<QFile *>(dev);
+    const qint64 size = (file!=nullptr ? file->size() : 0);
+    uchar *map = (size>0 ? file->map(0, size) : nullptr);
+    const char *data = reinterpret_cast<const char *>(map);
+
+    if (map!=nullptr && XmlTokenizer::canRead(data, size))
+    {
+        qDebug() << "reading mapped file, size" << size;
+        mTokenizer = new XmlTokenizer(data, size);	// XML tokenizer from memory
+        readTokens();
+    }
+    else
+    {
+        qDebug() << "reading from device";
+        mXmlReader = new QXmlStreamReader(dev);		// XML reader from device
+        readStream();
+    }
 
-    mXmlReader = new QXmlStreamReader(dev);		// XML reader from device
+    const bool ok = (mTokenizer!=nullptr ? !mTokenizer->hasError() : !mXmlReader->hasError());
+    qDebug() << "done, ok" << ok;
+    // Setting a fatal error is necessary so that FilesController::importFile()
+    // will recognise the failure, display the errors and give up.
+    if (!ok) reporter()->setError(ErrorReporter::Fatal, "XML parsing failed", lineNumber());
+
+    // Any item still being created has not been added to the data tree
+    // or handed over by addCompletedItem(), because its end tag was not
+    // reached.  This happens if the load is cancelled or fails part way
+    // through, or if the file is truncated.  A point or segment is only
+    // added to its parent at its end tag, so each is deleted separately.
+    // Segments of the track that have already been handed over by
+    // addCompletedChild() no longer belong to it.
+    delete mCurrentPoint;
+    mCurrentPoint = nullptr;
+    delete mCurrentSegment;
+    mCurrentSegment = nullptr;
+    if (mCurrentTrack!=nullptr) discardCompletedChildren(mCurrentTrack);
+    delete mCurrentTrack;
+    mCurrentTrack = nullptr;
+    delete mCurrentRoute;
+    mCurrentRoute = nullptr;
+    mStateStack.clear();
+
+    delete mTokenizer;					// finished with XML tokenizer
+    mTokenizer = nullptr;
+    delete mXmlReader;					// or XML reader
+    mXmlReader = nullptr;
+    if (map!=nullptr) file->unmap(map);			// finished with file mapping
+    return (ok);
+}
+
+
+void GpxImporter::readStream()
+{
+    int count = 0;
     while (!mXmlReader->atEnd())			// process the token stream
     {
+        if ((++count%PROGRESS_INTERVAL)==0 && !updateProgress(mXmlReader->device()->pos()))
+        {
+            mXmlReader->raiseError("Loading cancelled");
+            break;
+        }
+
         mXmlReader->readNext();				// get next XML token
 #ifdef DEBUG_TOKENS
         qDebug() << "token" << mXmlReader->tokenType() << "name" << mXmlReader->name();
@@ -86,7 +157,8 @@ case QXmlStreamReader::Invalid:
             break;
 
 case QXmlStreamReader::StartDocument:
-            startDocument(mXmlReader->documentVersion(), mXmlReader->documentEncoding());
+            startDocument(ByteView(mXmlReader->documentVersion().toLatin1()),
+                          ByteView(mXmlReader->documentEncoding().toLatin1()));
             break;
 
 case QXmlStreamReader::EndDocument:
@@ -94,13 +166,21 @@ case QXmlStreamReader::EndDocument:
             break;
 
 case QXmlStreamReader::StartElement:
-            checkNamespace(mXmlReader->namespaceUri(), mXmlReader->name(), mXmlReader->prefix());
-            startElement(mXmlReader->name().toLocal8Bit(), mXmlReader->qualifiedName().toLocal8Bit(),
-                         mXmlReader->attributes());
+            {
+                const QByteArray prefix = mXmlReader->prefix().toLocal8Bit();
+                const QByteArray localName = mXmlReader->name().toLocal8Bit();
+                const QByteArray qName = mXmlReader->qualifiedName().toLocal8Bit();
+                checkNamespace(mXmlReader->namespaceUri().toLatin1(), ByteView(localName), ByteView(prefix));
+                startElement(ByteView(localName), ByteView(qName));
+            }
             break;
 
 case QXmlStreamReader::EndElement:
-            endElement(mXmlReader->name().toLocal8Bit(), mXmlReader->qualifiedName().toLocal8Bit());
+            {
+                const QByteArray localName = mXmlReader->name().toLocal8Bit();
+                const QByteArray qName = mXmlReader->qualifiedName().toLocal8Bit();
+                endElement(ByteView(localName), ByteView(qName));
+            }
             break;
 
 case QXmlStreamReader::Characters:
@@ -109,7 +189,7 @@ case QXmlStreamReader::Characters:
             //   setFeature("http://trolltech.com/xml/features/report-whitespace-only-CharData", false)
             //
             // This does the equivalent.
-            if (!mXmlReader->isWhitespace()) characters(mXmlReader->text());
+            if (!mXmlReader->isWhitespace()) characters(ByteView(mXmlReader->text().toUtf8()));
             break;
 
 case QXmlStreamReader::Comment:
@@ -129,15 +209,55 @@ case QXmlStreamReader::ProcessingInstruction:
             break;
         }
     }
+}
 
-    const bool ok = !mXmlReader->hasError();		// XML parsing successful?
-    qDebug() << "done, ok" << ok;
-    // Setting a fatal error is necessary so that FilesController::importFile()
-    // will recognise the failure, display the errors and give up.
-    if (!ok) reporter()->setError(ErrorReporter::Fatal, "XML parsing failed", mXmlReader->lineNumber());
 
-    delete mXmlReader;					// finished with XML reader
-    return (ok);
+// The same as readStream() above, but using the in-memory tokenizer.
+// The token sequence reported is the same, apart from the tokens
+// that are not applicable to a UTF-8 file without a DTD.
+
+void GpxImporter::readTokens()
+{
+    int count = 0;
+    while (!mTokenizer->atEnd())			// process the token stream
+    {
+        if ((++count%PROGRESS_INTERVAL)==0 && !updateProgress(mTokenizer->position()))
+        {
+            mTokenizer->raiseError("Loading cancelled");
+            break;
+        }
+
+        mTokenizer->readNext();				// get next XML token
+#ifdef DEBUG_TOKENS
+        qDebug() << "token" << mTokenizer->tokenType() << "name" << mTokenizer->name().toString();
+#endif
+        switch (mTokenizer->tokenType())		// look at token type
+        {
+case XmlTokenizer::StartDocument:
+            startDocument(mTokenizer->documentVersion(), mTokenizer->documentEncoding());
+            break;
+
+case XmlTokenizer::EndDocument:
+            endDocument();
+            break;
+
+case XmlTokenizer::StartElement:
+            checkNamespace(mTokenizer->namespaceUri(), mTokenizer->name(), mTokenizer->prefix());
+            startElement(mTokenizer->name(), mTokenizer->qualifiedName());
+            break;
+
+case XmlTokenizer::EndElement:
+            endElement(mTokenizer->name(), mTokenizer->qualifiedName());
+            break;
+
+case XmlTokenizer::Characters:
+            if (!mTokenizer->isWhitespace()) characters(mTokenizer->text());
+            break;
+
+default:						// comment, error etc
+            break;
+        }
+    }
 }
 
 
@@ -147,22 +267,93 @@ QString GpxImporter::filter()
 }
 
 
+QString GpxImporter::compressedFilter()
+{
+    return ("Compressed GPX files (*.gpx.gz *.gpx.bz2 *.gpx.xz)");
+}
+
+
 QByteArray GpxImporter::indent() const
 {
     return (QByteArray("  ").repeated(mXmlIndent+1));
 }
 
 
+// The parse state stack records the items currently being created,
+// and the element that started each of them, so that the current item
+// and its type are known without needing to examine the item itself.
+
+void GpxImporter::pushState(GpxImporter::ElementToken token, TrackDataItem *item)
+{
+    mStateStack.append({ token, item });
+}
+
+
+bool GpxImporter::popState(GpxImporter::ElementToken token)
+{
+    if (mStateStack.isEmpty() || mStateStack.last().token!=token) return (false);
+    mStateStack.removeLast();
+    return (true);
+}
+
+
 TrackDataItem *GpxImporter::currentItem() const
 {
-    TrackDataItem *item = mCurrentPoint;		// find innermost current element
-    if (item==nullptr) item = mCurrentSegment;
-    if (item==nullptr) item = mCurrentTrack;
-    if (item==nullptr) item = mCurrentRoute;
-    return (item);
+    return (mStateStack.isEmpty() ? nullptr : mStateStack.last().item);
 }
 
 
+GpxImporter::ElementToken GpxImporter::currentToken() const
+{
+    return (mStateStack.isEmpty() ? ElementUnknown : mStateStack.last().token);
+}
+
+
+// Identify an element from its name.  The length and the first two
+// characters of all of the recognised names are different, so a
+// single switch on those selects the only possible candidate and
+// then one comparison confirms it.
+
+#define ELEMENT_KEY(len, c0, c1)	(((len)<<16)|(uchar(c0)<<8)|uchar(c1))
+
+GpxImporter::ElementToken GpxImporter::elementToken(const ByteView &localName, const ByteView &qName)
+{
+    const int len = localName.size();
+    if (len<3) return (ElementUnknown);			// shorter than any known
+
+    ElementToken token;
+    const char *expected;
+    switch (ELEMENT_KEY(len, localName.at(0), localName.at(1)))
+    {
+case ELEMENT_KEY(3, 'g', 'p'):		token = ElementGpx;		expected = "gpx";	break;
+case ELEMENT_KEY(3, 't', 'r'):		token = ElementTrk;		expected = "trk";	break;
+case ELEMENT_KEY(3, 'r', 't'):		token = ElementRte;		expected = "rte";	break;
+case ELEMENT_KEY(3, 'w', 'p'):		token = ElementWpt;		expected = "wpt";	break;
+case ELEMENT_KEY(3, 'e', 'l'):		token = ElementEle;		expected = "ele";	break;
+case ELEMENT_KEY(4, 'n', 'a'):		token = ElementName;		expected = "name";	break;
+case ELEMENT_KEY(4, 't', 'i'):		token = ElementTime;		expected = "time";	break;
+case ELEMENT_KEY(4, 't', 'y'):		token = ElementType;		expected = "type";	break;
+case ELEMENT_KEY(4, 'l', 'i'):		token = ElementLink;		expected = "link";	break;
+case ELEMENT_KEY(5, 't', 'r'):		token = ElementTrkpt;		expected = "trkpt";	break;
+case ELEMENT_KEY(5, 'r', 't'):		token = ElementRtept;		expected = "rtept";	break;
+case ELEMENT_KEY(5, 'c', 'o'):		token = ElementColor;		expected = "color";	break;
+case ELEMENT_KEY(6, 't', 'r'):		token = ElementTrkseg;		expected = "trkseg";	break;
+case ELEMENT_KEY(8, 'm', 'e'):		token = ElementMetadata;	expected = "metadata";	break;
+case ELEMENT_KEY(8, 'c', 'a'):		token = ElementCategory;	expected = "category";	break;
+case ELEMENT_KEY(8, 'C', 'a'):		token = ElementGpxxCategory;	expected = "Category";	break;
+case ELEMENT_KEY(10, 'e', 'x'):		token = ElementExtensions;	expected = "extensions";break;
+default:				return (ElementUnknown);
+    }
+
+    if (memcmp(localName.data(), expected, len)!=0) return (ElementUnknown);
+    // This one is only recognised with its namespace prefix
+    if (token==ElementGpxxCategory && qName!="gpxx:Category") return (ElementUnknown);
+    return (token);
+}
+
+#undef ELEMENT_KEY
+
+
 TrackDataFolder *GpxImporter::getFolder(const QString &path)
 {
 #ifdef DEBUG_IMPORT
@@ -200,34 +391,81 @@ TrackDataFolder *GpxImporter::waypointFolder(const TrackDataWaypoint *tdw)
     // Otherwise, an appropriately named top level folder is used, or
     // created if necessary.
 
-    const QVariant path = tdw->metadata("folder");	// waypoint folder, if it has one
+    const QVariant path = tdw->metadata(DataIndexer::IndexFolder);	// waypoint folder, if it has one
     if (!path.isNull()) return (getFolder(path.toString()));
 							// find or create folder
     return (getFolder(tdw->isMediaType() ? NOTES_FOLDER_NAME : WAYPOINTS_FOLDER_NAME));
 }
 
 
-void GpxImporter::getLatLong(TrackDataAbstractPoint *pnt, const QXmlStreamAttributes &atts, const QString &localName)
+void GpxImporter::getLatLong(TrackDataAbstractPoint *pnt, const ByteView &localName)
 {
-    double lat = NAN;					// coordinates found
-    double lon = NAN;
+    double lat;						// coordinates found
+    double lon;
 
-    QStringRef val = atts.value("lat");
-    if (!val.isEmpty()) lat = val.toDouble();
-    val = atts.value("lon");
-    if (!val.isEmpty()) lon = val.toDouble();
+    ByteView val = attributeUtf8("lat");
+    if (val.isNull() || !TrackData::parseDouble(val.data(), val.size(), &lat)) lat = NAN;
+    val = attributeUtf8("lon");
+    if (val.isNull() || !TrackData::parseDouble(val.data(), val.size(), &lon)) lon = NAN;
 
     if (!ISNAN(lat) && !ISNAN(lon)) pnt->setLatLong(lat, lon);
-    else addWarning("missing LAT/LON on "+localName.toUpper()+" element");
+    else addWarning("missing or invalid LAT/LON on "+localName.toString().toUpper()+" element");
 }
 
 
-bool GpxImporter::startDocument(const QStringRef &version, const QStringRef &encoding)
+// Access to the current XML reader, whichever one is in use.
+
+QString GpxImporter::attributeValue(const char *name) const
+{
+    if (mTokenizer!=nullptr) return (mTokenizer->attribute(name).toString());
+    return (mXmlReader->attributes().value(QLatin1String(name)).toString());
+}
+
+
+QString GpxImporter::readElementText()
+{
+    if (mTokenizer!=nullptr) return (mTokenizer->readElementText().toString());
+    return (mXmlReader->readElementText());
+}
+
+
+// As readElementText() and attributeValue(), but the text is returned
+// as UTF-8.  If the tokenizer is in use, this avoids converting it to
+// a QString.  The view is only valid until the next call of either.
+
+ByteView GpxImporter::readElementUtf8()
+{
+    if (mTokenizer!=nullptr) return (mTokenizer->readElementText());
+
+    mUtf8Buffer = mXmlReader->readElementText().toUtf8();
+    return (ByteView(mUtf8Buffer));
+}
+
+
+ByteView GpxImporter::attributeUtf8(const char *name)
+{
+    if (mTokenizer!=nullptr) return (mTokenizer->attribute(name));
+
+    const QStringRef val = mXmlReader->attributes().value(QLatin1String(name));
+    if (val.isNull()) return (ByteView());		// attribute not present
+    mUtf8Buffer = val.toUtf8();
+    return (ByteView(mUtf8Buffer));
+}
+
+
+qint64 GpxImporter::lineNumber() const
+{
+    if (mTokenizer!=nullptr) return (mTokenizer->lineNumber());
+    return (mXmlReader->lineNumber());
+}
+
+
+bool GpxImporter::startDocument(const ByteView &version, const ByteView &encoding)
 {
 #ifdef DEBUG_DETAILED
     std::cerr << std::endl << qPrintable(indent()) << "START DOCUMENT"
-              << " version " << qPrintable(version.toLocal8Bit())
-              << " encoding " << qPrintable(encoding.toLocal8Bit()) << std::endl;
+              << " version " << version.toByteArray().constData()
+              << " encoding " << encoding.toByteArray().constData() << std::endl;
 #else
     qDebug() << "START DOCUMENT";
 #endif
@@ -245,10 +483,11 @@ bool GpxImporter::startDocument(const QStringRef &version, const QStringRef &enc
 // be cleaned up again so that it is not mistaken for a new item when
 // the parser restarts.
 
-bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qName,
-                               const QXmlStreamAttributes &atts)
+bool GpxImporter::startElement(const ByteView &localName, const ByteView &qName)
 {
-    if (localName!="gpx")				// past the first GPX element
+    const ElementToken token = elementToken(localName, qName);
+
+    if (token!=ElementGpx)				// past the first GPX element
     {
         // Namespace processing needs to be turned off in order to be able to
         // load files that do not have an XML namespace prefix declared correctly.
@@ -266,7 +505,9 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
         // processing completely, an element's namespaceURI is still reported
         // if a prefix is present and the namespace is defined.  It simply causes
         // the parser to not give an error for an undefined prefix.
-        if (mXmlReader->namespaceProcessing()) mXmlReader->setNamespaceProcessing(false);
+        //
+        // The XmlTokenizer never gives an error for an undefined prefix.
+        if (mXmlReader!=nullptr && mXmlReader->namespaceProcessing()) mXmlReader->setNamespaceProcessing(false);
     }
 
     // First look for elements which simply provide contain a textual
@@ -285,95 +526,97 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
     // to handle unknown tags as metadata.
 
     QString elementText;				// text found, if any
+    bool isTextElement = true;				// assume recognised below
+    TrackDataItem *item = currentItem();		// innermost current item
+    const ElementToken itemToken = currentToken();	// and its element type
 
-    if (localName=="name")				// start of a NAME element
-    {							// may belong to any container
-        elementText = mXmlReader->readElementText();
-
-        TrackDataItem *item = currentItem();		// find innermost current element
+    switch (token)
+    {
+case ElementName:					// start of a NAME element
+        elementText = readElementText();		// may belong to any container
         if (item!=nullptr) item->setName(elementText, true);	// assign its name
-        else if (mWithinMetadata) mDataRoot->setMetadata(localName, elementText);
+        else if (mWithinMetadata) mDataRoot->setMetadata(DataIndexer::IndexName, elementText);
         else addError("NAME not within TRK, TRKSEG, TRKPT, WPT, RTE, RTEPT or METADATA");
-    }
-    else if (localName=="time")				// start of a TIME element
-    {							// may belong to any element
-        elementText = mXmlReader->readElementText();
-        // The time spec of the decoded date/time is UTC, which is what we want.
-        const QDateTime dt = QDateTime::fromString(elementText, Qt::ISODate);
-
-        TrackDataItem *item = currentItem();		// find innermost current element
-        if (item==nullptr)				// no element in progress?
-        {
-            // GPSbabel does not enclose TIME within METADATA:
-            //
-            // <?xml version="1.0" encoding="UTF-8"?>
-            // <gpx version="1.0" ... >
-            // <time>2010-04-18T16:28:47Z</time>
-            // <bounds minlat="46.827816667" minlon="8.370250000" maxlat="46.850700000" maxlon="8.391166667"/>
-            // <wpt> ...
+        break;
+
+case ElementTime:					// start of a TIME element
+        {						// may belong to any element
+            const ByteView timeText = readElementUtf8();
+
+            if (item==nullptr)				// no element in progress?
+            {
+                // GPSbabel does not enclose TIME within METADATA:
+                //
+                // <?xml version="1.0" encoding="UTF-8"?>
+                // <gpx version="1.0" ... >
+                // <time>2010-04-18T16:28:47Z</time>
+                // <bounds minlat="46.827816667" minlon="8.370250000" maxlat="46.850700000" maxlon="8.391166667"/>
+                // <wpt> ...
+
+                if (!mWithinMetadata) addError("TIME not within TRK, TRKPT, WPT or METADATA");
+                item = mDataRoot;			// assume to be in metadata
+            }
 
-            if (!mWithinMetadata) addError("TIME not within TRK, TRKPT, WPT or METADATA");
-            item = mDataRoot;				// assume to be in metadata
+            if (isPointToken(itemToken))		// stored directly in point
+            {
+                mCurrentPoint->setTimeMSecs(TrackData::parseIsoTime(timeText.data(), timeText.size()));
+            }
+            else
+            {
+                // The time spec of the decoded date/time is UTC, which is what we want.
+                const QDateTime dt = QDateTime::fromString(timeText.toString().trimmed(), Qt::ISODate);
+                item->setMetadata(DataIndexer::IndexTime, dt);
+            }
+#ifdef DEBUG_DETAILED
+            elementText = timeText.toString();
+#endif
         }
+        break;
 
-        item->setMetadata(localName, dt);
-    }
-    else if (localName=="ele")				// start of an ELE element
-    {
-        elementText = mXmlReader->readElementText();
-        const double ele = elementText.toDouble();
-        TrackDataAbstractPoint *tdp = dynamic_cast<TrackDataAbstractPoint *>(currentItem());
+case ElementEle:					// start of an ELE element
+        {
+            const ByteView eleText = readElementUtf8();
+            if (!isPointToken(itemToken)) return (addError("ELE not within TRKPT or WPT"));
 
-        // The explicit use of QVariant(double) seems to be needed, otherwise there is
-        // an ambiguous overload:
-        //
-        //   gpximporter.cpp:547: error: call of overloaded 'setMetadata(int, const double&)' is ambiguous
-        //   trackdata.h:207: note: candidate 'void TrackDataItem::setMetadata(int, const QColor&)'
-        //   trackdata.h:208: note: candidate 'void TrackDataItem::setMetadata(int, const QVariant&)'
-        //
-        // I don't understand why, because there is no explicit conversion defined from
-        // double to QColor and an implicit conversion from double to any sort of integer
-        // type should not be allowed.
-        if (tdp!=nullptr) tdp->setMetadata(localName, QVariant(ele));
-        else return (addError("ELE not within TRKPT or WPT"));
-    }
-    else if (localName=="category")			// start of a CATEGORY element
-    {
-        elementText = mXmlReader->readElementText();
-        TrackDataWaypoint *item = dynamic_cast<TrackDataWaypoint *>(currentItem());
-        if (item!=nullptr) item->setMetadata(localName, elementText);
+            double ele;
+            if (TrackData::parseDouble(eleText.data(), eleText.size(), &ele)) mCurrentPoint->setElevation(ele);
+            else if (!eleText.trimmed().isEmpty()) addWarning("invalid value for ELE");
+#ifdef DEBUG_DETAILED
+            elementText = eleText.toString();
+#endif
+        }
+        break;
+
+case ElementCategory:					// start of a CATEGORY element
+        elementText = readElementText();
+        if (itemToken==ElementWpt) item->setMetadata(DataIndexer::IndexCategory, elementText);
         else addError("CATEGORY not within WPT");
-    }
-    else if (localName=="type")				// start of a TYPE element
-    {
-        elementText = mXmlReader->readElementText();
+        break;
 
-        TrackDataItem *item = currentItem();
-        if (dynamic_cast<TrackDataWaypoint *>(item)!=nullptr)
+case ElementType:					// start of a TYPE element
+        elementText = readElementText();
+        if (itemToken==ElementWpt)
         {
             // For a waypoint, a synonym for CATEGORY but only if
             // there is no CATEGORY already.
-            const int idx2 = DataIndexer::index("category");
+            const int idx2 = DataIndexer::IndexCategory;
             if (item->metadata(idx2).isNull()) item->setMetadata(idx2, elementText);
         }
-        else if (dynamic_cast<TrackDataTrack *>(item)!=nullptr || dynamic_cast<TrackDataSegment *>(item)!=nullptr)
+        else if (itemToken==ElementTrk || itemToken==ElementTrkseg)
         {
             // For a track or segment, normal metadata.
-            item->setMetadata(localName, elementText);
+            item->setMetadata(DataIndexer::IndexType, elementText);
         }
         else addError("TYPE not within WPT, TRK or TRKSEG");
-    }
-    else if (qName=="gpxx:Category")
-    {
+        break;
+
+case ElementGpxxCategory:
         // Ignore this, covered by CATEGORY/TYPE above
-        elementText = mXmlReader->readElementText();
+        elementText = readElementText();
         return (true);
-    }
-    else if (localName=="color")			// start of a COLOR element, which
-    {							// should be within EXTENSIONS
-        elementText = mXmlReader->readElementText();
 
-        TrackDataItem *item = currentItem();		// find innermost current element
+case ElementColor:					// start of a COLOR element, which
+        elementText = readElementText();		// should be within EXTENSIONS
         if (item!=nullptr)
         {
             QString rgbString = elementText;
@@ -383,29 +626,31 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
 
             // The COLOR attribute will only set our internal LINECOLOR/POINTCOLOR
             // attributes if they are not already set.
-            if (dynamic_cast<const TrackDataAbstractPoint *>(item)!=nullptr)
-            {						// colour for a point
-                const int idx2 = DataIndexer::index("pointcolor");
+            if (isPointToken(itemToken))		// colour for a point
+            {
+                const int idx2 = DataIndexer::IndexPointcolor;
                 const QVariant &v = item->metadata(idx2);
                 if (v.isNull()) item->setMetadata(idx2, col);
             }
             else					// colour for a line/container
             {
-                const int idx2 = DataIndexer::index("linecolor");
+                const int idx2 = DataIndexer::IndexLinecolor;
                 const QVariant &v = item->metadata(idx2);
                 if (v.isNull()) item->setMetadata(idx2, col);
             }
         }
         else addError("COLOR not within TRK, TRKSEG, TRKPT, WPT, RTE or RTEPT");
+        break;
+
+default:						// not a text element
+        isTextElement = false;
+        break;
     }
 
-    // Contrary to standard practice, perform this test with isNull() not
-    // isEmpty().  We want to detect a matching element above even if its
-    // text value was a null string.
-    if (!elementText.isNull())
+    if (isTextElement)
     {
 #ifdef DEBUG_DETAILED
-        std::cerr << qPrintable(indent()) << "TEXT <" << qPrintable(localName.toUpper()) << ">"
+        std::cerr << qPrintable(indent()) << "TEXT <" << localName.toByteArray().toUpper().constData() << ">"
                   << " = '" << qPrintable(elementText) << "'" << std::endl;
 #endif
         return (true);					// element has been processed
@@ -417,78 +662,80 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
     // the corresponding end element is seen.
 
 #ifdef DEBUG_DETAILED
-    std::cerr << qPrintable(indent()) << "START <" << qPrintable(localName.toUpper()) << ">" << std::endl;
-    for (const QXmlStreamAttribute &att : atts)
-    {
-        std::cerr << qPrintable(indent()) << "+ " << qPrintable(att.name().toLocal8Bit()) << " = " << qPrintable(att.value().toLocal8Bit()) << std::endl;
-    }
+    std::cerr << qPrintable(indent()) << "START <" << localName.toByteArray().toUpper().constData() << ">" << std::endl;
 #endif
     ++mXmlIndent;					// increase indent for display
 
-    if (localName=="gpx")				// start of a GPX element
+    switch (token)
     {
-        QStringRef val = atts.value("version");
-        if (!val.isEmpty()) mDataRoot->setMetadata(DataIndexer::index("version"), val.toString());
-        val = atts.value("creator");
-        if (!val.isEmpty()) mDataRoot->setMetadata(DataIndexer::index("creator"), val.toString());
-    }
-    else if (localName=="metadata")			// start of a METADATA element
-    {
-        if (mWithinMetadata || currentItem()!=nullptr)	// check not nested
+case ElementGpx:					// start of a GPX element
+        {
+            QString val = attributeValue("version");
+            if (!val.isEmpty()) mDataRoot->setMetadata(DataIndexer::IndexVersion, val);
+            val = attributeValue("creator");
+            if (!val.isEmpty()) mDataRoot->setMetadata(DataIndexer::IndexCreator, val);
+        }
+        break;
+
+case ElementMetadata:					// start of a METADATA element
+        if (mWithinMetadata || item!=nullptr)		// check not nested
         {
             addError("nested METADATA elements");
         }
 
         mWithinMetadata = true;				// just note for contents
-    }
-    else if (localName=="extensions")			// start of an EXTENSIONS element
-    {
+        break;
+
+case ElementExtensions:					// start of an EXTENSIONS element
         if (mWithinExtensions)				// check not nested
         {
             addError("nested EXTENSIONS elements");
         }
 
-        if (currentItem()==nullptr)			// must be within element
+        if (item==nullptr)				// must be within element
         {
             return (addError("EXTENSIONS not expected here"));
         }
 
         mWithinExtensions = true;			// just note for contents
-    }
-    else if (localName=="trk")				// start of a TRK element
-    {
-        if (currentItem()!=nullptr)			// check not nested
+        break;
+
+case ElementTrk:					// start of a TRK element
+        if (item!=nullptr)				// check not nested
         {
             return (addError("TRK element nested or not at top level"));
         }
 							// start new track
         mCurrentTrack = new TrackDataTrack;
-    }
-    else if (localName=="rte")				// start of a RTE element
-    {
-        if (currentItem()!=nullptr)			// check not nested
+        pushState(token, mCurrentTrack);
+        break;
+
+case ElementRte:					// start of a RTE element
+        if (item!=nullptr)				// check not nested
         {
             return (addError("RTE element nested or not at top level"));
         }
-							// start new track
+							// start new route
         mCurrentRoute = new TrackDataRoute;
-    }
-    else if (localName=="trkseg")			// start of a TRKSEG element
-    {
+        pushState(token, mCurrentRoute);
+        break;
+
+case ElementTrkseg:					// start of a TRKSEG element
         if (mCurrentSegment!=nullptr)			// check not nested
         {
             return (addError("nested TRKSEG elements"));
         }
 
-        if (mCurrentTrack==nullptr)			// check properly nested
+        if (itemToken!=ElementTrk)			// check properly nested
         {
             return (addError("TRKSEG not within TRK"));
         }
 							// start new segment
         mCurrentSegment = new TrackDataSegment;
-    }
-    else if (localName=="trkpt")			// start of a TRKPT element
-    {
+        pushState(token, mCurrentSegment);
+        break;
+
+case ElementTrkpt:					// start of a TRKPT element
         if (mCurrentPoint!=nullptr)			// check not nested
         {
             return (addError("nested TRKPT element"));
@@ -496,30 +743,33 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
 
         if (mCurrentSegment==nullptr)			// no current segment yet
         {
-            if (mCurrentTrack==nullptr)			// must be within track, though
+            if (itemToken!=ElementTrk)			// must be within track, though
             {
                 return (addError("TRKPT not within TRKSEG or TRK"));
             }
 
             mCurrentSegment = new TrackDataSegment;	// start new implied segment
+            pushState(ElementTrkseg, mCurrentSegment);
             addWarning("TRKPT not within TRKSEG");
         }
 
         mCurrentPoint = new TrackDataTrackpoint;	// start new point item
-        getLatLong(mCurrentPoint, atts, localName);	// get coordinates
-    }
-    else if (localName=="wpt")				// start of an WPT element
-    {
-        if (currentItem()!=nullptr)			// check not nested
+        pushState(token, mCurrentPoint);
+        getLatLong(mCurrentPoint, localName);		// get coordinates
+        break;
+
+case ElementWpt:					// start of an WPT element
+        if (item!=nullptr)				// check not nested
         {
             return (addError("WPT element nested or not at top level"));
         }
 
         mCurrentPoint = new TrackDataWaypoint;		// start new waypoint item
-        getLatLong(mCurrentPoint, atts, localName);	// get coordinates
-    }
-    else if (localName=="rtept")			// start of an RTEPT element
-    {
+        pushState(token, mCurrentPoint);
+        getLatLong(mCurrentPoint, localName);		// get coordinates
+        break;
+
+case ElementRtept:					// start of an RTEPT element
         if (mCurrentRoute==nullptr)
         {
             return (addError("RTEPT not within RTE"));
@@ -531,19 +781,26 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
         }
 
         mCurrentPoint = new TrackDataRoutepoint;	// start new route point item
-        getLatLong(mCurrentPoint, atts, localName);	// get coordinates
-    }
-    else if (localName=="link")				// start of a LINK element
-    {
-        if (dynamic_cast<TrackDataWaypoint *>(mCurrentPoint)==nullptr)
-        {						// check contained where expected
-            return (addError("LINK not within WPT"));
+        pushState(token, mCurrentPoint);
+        getLatLong(mCurrentPoint, localName);		// get coordinates
+        break;
+
+case ElementLink:					// start of a LINK element
+        {
+            if (itemToken!=ElementWpt)			// check contained where expected
+            {
+                return (addError("LINK not within WPT"));
+            }
+
+            QString link = attributeValue("link");
+            if (link.isEmpty()) link = attributeValue("href");
+            if (!link.isEmpty()) mCurrentPoint->setMetadata(DataIndexer::indexWithNamespace(qName.toByteArray()), link);
+            else addWarning("missing LINK/HREF attribute on LINK element");
         }
+        break;
 
-        QStringRef link = atts.value("link");
-        if (link.isEmpty()) link = atts.value("href");
-        if (!link.isEmpty()) mCurrentPoint->setMetadata(DataIndexer::indexWithNamespace(qName), link.toString());
-        else addWarning("missing LINK/HREF attribute on LINK element");
+default:						// unknown, will be metadata
+        break;
     }
 
     mContainedChars.clear();				// clear element contents
@@ -562,53 +819,52 @@ bool GpxImporter::startElement(const QByteArray &localName, const QByteArray &qN
 // to the data tree, it must be cleaned up so that it is not mistaken for
 // a new item when the parser restarts.  See the comment for WPT below.
 
-bool GpxImporter::endElement(const QByteArray &localName, const QByteArray &qName)
+bool GpxImporter::endElement(const ByteView &localName, const ByteView &qName)
 {
     --mXmlIndent;
 #ifdef DEBUG_DETAILED
-    std::cerr << qPrintable(indent()) << "END <" << qPrintable(localName.toUpper()) << ">" << std::endl;
+    std::cerr << qPrintable(indent()) << "END <" << localName.toByteArray().toUpper().constData() << ">" << std::endl;
 #endif
 
-    if (localName=="gpx") return (true);		// end of the GPX element,
-							// nothing to do
-    if (localName=="metadata")				// end of a METADATA element
+    const ElementToken token = elementToken(localName, qName);
+    switch (token)
     {
+case ElementGpx:					// end of the GPX element,
+        return (true);					// nothing to do
+
+case ElementMetadata:					// end of a METADATA element
         mWithinMetadata = false;			// just note it finished
         return (true);
-    }
 
-    if (localName=="extensions")			// end of an EXTENSIONS element
-    {
+case ElementExtensions:					// end of an EXTENSIONS element
         mWithinExtensions = false;			// just note it finished
         return (true);
-    }
-
-    if (localName=="trk")				// end of a TRK element
-    {
-        if (mCurrentTrack==nullptr)			// check must have started
-        {
-            return (addError("TRK element not started"));
-        }
 
+case ElementTrk:					// end of a TRK element
         if (mCurrentSegment!=nullptr)			// segment not closed
         {						// (may be an implied one)
 #ifdef DEBUG_IMPORT
             qDebug() << "got implied TRKSEG:" << mCurrentSegment->name();
 #endif
-            mCurrentTrack->addChildItem(mCurrentSegment);
+            popState(ElementTrkseg);
+            addCompletedChild(mCurrentTrack, mCurrentSegment);
             mCurrentSegment = nullptr;			// finished with temporary
         }
 
+        if (!popState(token))				// check must have started
+        {
+            return (addError("TRK element not started"));
+        }
+
 #ifdef DEBUG_IMPORT
         qDebug() << "got a TRK:" << mCurrentTrack->name();
 #endif
-        mDataRoot->addChildItem(mCurrentTrack);
+        addCompletedItem(mCurrentTrack);		// finished with track
         mCurrentTrack = nullptr;			// finished with temporary
         return (true);
-    }
-    else if (localName=="trkseg")			// end of a TRKSEG element
-    {
-        if (mCurrentSegment==nullptr)			// check must have started
+
+case ElementTrkseg:					// end of a TRKSEG element
+        if (!popState(token))				// check must have started
         {
             return (addError("TRKSEG element not started"));
         }
@@ -616,13 +872,12 @@ bool GpxImporter::endElement(const QByteArray &localName, const QByteArray &qNam
 #ifdef DEBUG_IMPORT
         qDebug() << "got a TRKSEG:" << mCurrentSegment->name();
 #endif
-        mCurrentTrack->addChildItem(mCurrentSegment);
+        addCompletedChild(mCurrentTrack, mCurrentSegment);
         mCurrentSegment = nullptr;			// finished with temporary
         return (true);
-    }
-    else if (localName=="trkpt")			// end of a TRKPT element
-    {
-        if (dynamic_cast<TrackDataTrackpoint *>(mCurrentPoint)==nullptr)
+
+case ElementTrkpt:					// end of a TRKPT element
+        if (!popState(token))				// check must have started
         {
             return (addError("TRKPT element not started"));
         }
@@ -630,15 +885,13 @@ bool GpxImporter::endElement(const QByteArray &localName, const QByteArray &qNam
 #ifdef DEBUG_IMPORT
         qDebug() << "got a TRKPT:" << mCurrentPoint->name();
 #endif
-        Q_ASSERT(mCurrentSegment!=nullptr || mCurrentTrack!=nullptr);
-        if (mCurrentSegment!=nullptr) mCurrentSegment->addChildItem(mCurrentPoint);
-        else mCurrentTrack->addChildItem(mCurrentPoint);
+        Q_ASSERT(mCurrentSegment!=nullptr);		// may be an implied one
+        mCurrentSegment->addChildItem(mCurrentPoint);
         mCurrentPoint = nullptr;			// finished with temporary
         return (true);
-    }
-    else if (localName=="rte")				// end of a RTE element
-    {
-        if (mCurrentRoute==nullptr)			// check must have started
+
+case ElementRte:					// end of a RTE element
+        if (!popState(token))				// check must have started
         {
             return (addError("RTE element not started"));
         }
@@ -646,14 +899,13 @@ bool GpxImporter::endElement(const QByteArray &localName, const QByteArray &qNam
 #ifdef DEBUG_IMPORT
         qDebug() << "got a RTE:" << mCurrentRoute->name();
 #endif
-        mDataRoot->addChildItem(mCurrentRoute);
+        addCompletedItem(mCurrentRoute);		// finished with route
         mCurrentRoute = nullptr;			// finished with temporary
         return (true);
-    }
-    else if (localName=="rtept")			// end of a RTEPT element
-    {
-        if (dynamic_cast<TrackDataRoutepoint *>(mCurrentPoint)==nullptr)
-        {						// check start element matched
+
+case ElementRtept:					// end of a RTEPT element
+        if (!popState(token))				// check start element matched
+        {
             return (addError("RTEPT element not started"));
         }
 
@@ -664,55 +916,59 @@ bool GpxImporter::endElement(const QByteArray &localName, const QByteArray &qNam
         mCurrentRoute->addChildItem(mCurrentPoint);
         mCurrentPoint = nullptr;			// finished with temporary
         return (true);
-    }
-    else if (localName=="wpt")				// end of a WPT element
-    {
-        TrackDataWaypoint *tdw = dynamic_cast<TrackDataWaypoint *>(mCurrentPoint);
-        if (tdw==nullptr)				// check must have started
+
+case ElementWpt:					// end of a WPT element
         {
-            return (addError("WPT element not started"));
-        }
+            if (!popState(token))			// check must have started
+            {
+                return (addError("WPT element not started"));
+            }
 
+            TrackDataWaypoint *tdw = static_cast<TrackDataWaypoint *>(mCurrentPoint);
 #ifdef DEBUG_IMPORT
-        qDebug() << "got a WPT:" << mCurrentPoint->name();
+            qDebug() << "got a WPT:" << tdw->name();
 #endif
-        if (tdw->isMediaType())
-        {
-            // Only do this check if the "link" metadata has not already
-            // been set by a LINK tag.
-            const int idx = DataIndexer::index("link");
-            if (tdw->metadata(idx).isNull())
+            if (tdw->isMediaType())
             {
-                // An OsmAnd+ AV note is stored as a waypoint with a special name.
-                // Using the GUI, it is possible to rename such a waypoint;  relying
-                // on the visible name to locate the media file would then fail.
-                // To get around this, we save the original name in the waypoint's
-                // metadata under a special key which will not get overwritten;  this
-                // will from then on be saved and loaded in the GPX file.
-                tdw->setMetadata(idx, tdw->name());
+                // Only do this check if the "link" metadata has not already
+                // been set by a LINK tag.
+                const int idx = DataIndexer::IndexLink;
+                if (tdw->metadata(idx).isNull())
+                {
+                    // An OsmAnd+ AV note is stored as a waypoint with a special name.
+                    // Using the GUI, it is possible to rename such a waypoint;  relying
+                    // on the visible name to locate the media file would then fail.
+                    // To get around this, we save the original name in the waypoint's
+                    // metadata under a special key which will not get overwritten;  this
+                    // will from then on be saved and loaded in the GPX file.
+                    tdw->setMetadata(idx, tdw->name());
+                }
             }
-        }
 
-        // If for some reason any element cannot be finalised or added to the
-        // data tree, it must be cleaned up before returning with addError()
-        // to skip the current element.  For example,
-        //
-        //    if (there is a problem with the waypoint)
-        //    {
-        //      delete mCurrentPoint; mCurrentPoint = nullptr;
-        //      return (addError("Waypoint not complete"));
-        //    }
+            // If for some reason any element cannot be finalised or added to the
+            // data tree, it must be cleaned up before returning with addError()
+            // to skip the current element.  For example,
+            //
+            //    if (there is a problem with the waypoint)
+            //    {
+            //      delete mCurrentPoint; mCurrentPoint = nullptr;
+            //      return (addError("Waypoint not complete"));
+            //    }
 
-        TrackDataFolder *folder = waypointFolder(tdw);
-        Q_ASSERT(folder!=nullptr);
+            TrackDataFolder *folder = waypointFolder(tdw);
+            Q_ASSERT(folder!=nullptr);
 
-        // Clear the folder name metadata, it will be regenerated
-        // when the file is exported.
-        tdw->setMetadata("folder", QVariant());
+            // Clear the folder name metadata, it will be regenerated
+            // when the file is exported.
+            tdw->setMetadata(DataIndexer::IndexFolder, QVariant());
 
-        folder->addChildItem(tdw);			// add to destination folder
-        mCurrentPoint = nullptr;			// finished with temporary
+            folder->addChildItem(tdw);			// add to destination folder
+            mCurrentPoint = nullptr;			// finished with temporary
+        }
         return (true);
+
+default:						// not a container
+        break;
     }
 
     // If we get here, the element tag is not recognised as a container
@@ -720,18 +976,36 @@ bool GpxImporter::endElement(const QByteArray &localName, const QByteArray &qNam
     // any textual data, then add it to the current element or file metadata
     // indexed by the literal element tag.
 
-    const QString elementText = elementContents();	// get any current contents
+    const QByteArray elementText = elementContents();	// get any current contents
     if (elementText.isEmpty()) return (true);		// ignore if there was none
 
-    QByteArray key = qName;				// namespaced name of the element
+    QByteArray key = qName.toByteArray();		// namespaced name of the element
     // Ultra GPS Logger tags waypoints with <description> instead of <desc>
     if (key=="description") key = "desc";
     const int idx = DataIndexer::indexWithNamespace(key);
 
+    // The point's speed and HDOP are stored as numbers in any case.
+    // Numeric values within the extensions of a point, such as heart rate
+    // or cadence, are stored as numbers if they are valid and if the number
+    // will be written back out as exactly the same text.  This means that
+    // a value such as "007" or "1.50", or one with more precision than a
+    // double can hold, is kept as it was.  Anything else is stored as a
+    // string.
+    QVariant value;
+    double num;
+    if (isPointToken(currentToken()) &&
+        (mWithinExtensions || idx==DataIndexer::IndexSpeed || idx==DataIndexer::IndexHdop) &&
+        TrackData::parseDouble(elementText.constData(), elementText.size(), &num))
+    {
+        value = num;
+        if (mWithinExtensions && value.toString().toUtf8()!=elementText) value = QString::fromUtf8(elementText);
+    }
+    else value = QString::fromUtf8(elementText);
+
     TrackDataItem *item = currentItem();		// find innermost current element
-    if (item!=nullptr) item->setMetadata(idx, elementText);
-    else if (mWithinMetadata) mDataRoot->setMetadata(idx, elementText);
-    else addWarning("unrecognised "+localName.toUpper()+" not expected here");
+    if (item!=nullptr) item->setMetadata(idx, value);
+    else if (mWithinMetadata) mDataRoot->setMetadata(idx, value);
+    else addWarning("unrecognised "+localName.toString().toUpper()+" not expected here");
 
     return (true);
 }
@@ -746,7 +1020,7 @@ bool GpxImporter::endDocument()
     qDebug() << "END DOCUMENT";
 #endif
 
-    if (currentItem()!=nullptr)				// check terminated
+    if (!mStateStack.isEmpty())				// check terminated
     {
         addError("Point or container not terminated");
     }
@@ -767,19 +1041,19 @@ bool GpxImporter::endDocument()
 // This is still necessary, because readElementText() will not work
 // as described in startElement().
 
-bool GpxImporter::characters(const QStringRef &ch)
+bool GpxImporter::characters(const ByteView &ch)
 {
 #ifdef DEBUG_DETAILED
-    std::cerr << qPrintable(indent()) << "= '" << qPrintable(ch.toLocal8Bit()) << "'" << std::endl;
+    std::cerr << qPrintable(indent()) << "= '" << ch.toByteArray().constData() << "'" << std::endl;
 #endif
-    mContainedChars = ch.trimmed().toString();		// save for element end
+    mContainedChars = ch.trimmed().toByteArray();	// save for element end
     return (true);
 }
 
 
-QString GpxImporter::elementContents()
+QByteArray GpxImporter::elementContents()
 {
-    const QString cc = mContainedChars;			// stored by characters() above
+    const QByteArray cc = mContainedChars;		// stored by characters() above
     mContainedChars.clear();				// contents are now consumed
     return (cc);
 }
@@ -787,7 +1061,7 @@ QString GpxImporter::elementContents()
 
 void GpxImporter::addMessage(ErrorReporter::Severity severity, const QString &msg)
 {
-    reporter()->setError(severity, msg, mXmlReader->lineNumber());
+    reporter()->setError(severity, msg, lineNumber());
 }
 
 
@@ -798,7 +1072,17 @@ bool GpxImporter::addError(const QString &msg)
     // If the error detected is at the start of an element (which
     // indicates bad nesting, an unexpected tag or similar), then
     // ignore the remainder of the element.
-    if (mXmlReader->isStartElement())
+    if (mTokenizer!=nullptr)
+    {
+        if (mTokenizer->isStartElement())
+        {
+#ifdef DEBUG_IMPORT
+            qDebug() << "skipping current" << mTokenizer->name().toString() << "element";
+#endif
+            mTokenizer->skipCurrentElement();
+        }
+    }
+    else if (mXmlReader->isStartElement())
     {
 #ifdef DEBUG_IMPORT
         qDebug() << "skipping current" << mXmlReader->name()  << "element";
@@ -820,7 +1104,8 @@ bool GpxImporter::addWarning(const QString &msg)
 bool GpxImporter::addFatal(const QString &msg)
 {
     addMessage(ErrorReporter::Fatal, msg);
-    mXmlReader->raiseError("XML parsing failed");
+    if (mTokenizer!=nullptr) mTokenizer->raiseError("XML parsing failed");
+    else mXmlReader->raiseError("XML parsing failed");
     return (false);					// stop reading now
 }
 
@@ -841,18 +1126,18 @@ bool GpxImporter::needsResave() const
 // needsResave() and the user will be prompted to resave the file in order
 // to update it with the correct namespace declaration.
 
-void GpxImporter::checkNamespace(const QStringRef &namespaceURI,
-                                 const QStringRef &localName,
-                                 const QStringRef &nsPrefix)
+void GpxImporter::checkNamespace(const QByteArray &namespaceURI,
+                                 const ByteView &localName,
+                                 const ByteView &nsPrefix)
 {
     if (nsPrefix.isEmpty()) return;			// no namespace to check
 
     if (namespaceURI.isEmpty())				// element with undefined namespace
     {
-        const QString qName = nsPrefix+':'+localName;
+        const QString qName = nsPrefix.toString()+':'+localName.toString();
         if (!mUndefinedNamespaces.contains(qName))	// only report each one once
         {
-            addWarning(QString("Undefined namespace '%1' for element &lt;%2&gt;").arg(nsPrefix).arg(localName));
+            addWarning(QString("Undefined namespace '%1' for element &lt;%2&gt;").arg(nsPrefix.toString(), localName.toString()));
             mUndefinedNamespaces.append(qName);
         }
     }
@@ -863,6 +1148,6 @@ void GpxImporter::checkNamespace(const QStringRef &namespaceURI,
         // of the earlier and current - the <gpx> element - is the same
         // for both.  There is therefore no need to check for duplication
         // here.
-        DataIndexer::setUriForNamespace(nsPrefix.toLatin1(), namespaceURI.toLatin1());
+        DataIndexer::setUriForNamespace(nsPrefix.toByteArray(), namespaceURI);
     }
 }
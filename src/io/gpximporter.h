@@ -26,6 +26,8 @@
 #ifndef GPXIMPORTER_H
 #define GPXIMPORTER_H
 
+#include <qvector.h>
+
 #include "importerbase.h"
 #include "errorreporter.h"
 
@@ -38,7 +40,8 @@ class TrackDataFolder;
 class TrackDataWaypoint;
 
 class QXmlStreamReader;
-class QXmlStreamAttributes;
+class XmlTokenizer;
+class ByteView;
 
 
 class GpxImporter : public ImporterBase
@@ -48,6 +51,7 @@ public:
     virtual ~GpxImporter() = default;
 
     static QString filter();
+    static QString compressedFilter();
 
     // ImporterBase
     bool loadFrom(QIODevice *dev) override;
@@ -69,10 +73,10 @@ protected:
     //    }
     //
     // with the slight cost of needing to end with an explicit 'return'.
-    bool startElement(const QByteArray &localName, const QByteArray &qName, const QXmlStreamAttributes &atts);
-    bool endElement(const QByteArray &localName, const QByteArray &qName);
-    bool characters(const QStringRef &ch);
-    bool startDocument(const QStringRef &version, const QStringRef &encoding);
+    bool startElement(const ByteView &localName, const ByteView &qName);
+    bool endElement(const ByteView &localName, const ByteView &qName);
+    bool characters(const ByteView &ch);
+    bool startDocument(const ByteView &version, const ByteView &encoding);
     bool endDocument();
 
     // Again the equivalents of these were originally return type 'bool'
@@ -82,16 +86,60 @@ protected:
     bool addFatal(const QString &msg);
 
 private:
-    QByteArray indent() const;
+    enum ElementToken
+    {
+        ElementUnknown,
+        ElementGpx,
+        ElementMetadata,
+        ElementExtensions,
+        ElementTrk,
+        ElementTrkseg,
+        ElementTrkpt,
+        ElementRte,
+        ElementRtept,
+        ElementWpt,
+        ElementName,
+        ElementTime,
+        ElementEle,
+        ElementCategory,
+        ElementType,
+        ElementColor,
+        ElementLink,
+        ElementGpxxCategory
+    };
+
+    struct ParseState
+    {
+        ElementToken token;				// element that started the item
+        TrackDataItem *item;				// the item being created
+    };
+
+    static ElementToken elementToken(const ByteView &localName, const ByteView &qName);
+    static bool isPointToken(ElementToken token)	{ return (token==ElementTrkpt || token==ElementWpt || token==ElementRtept); }
+
+    void pushState(ElementToken token, TrackDataItem *item);
+    bool popState(ElementToken token);
     TrackDataItem *currentItem() const;
+    ElementToken currentToken() const;
+
+    void readStream();
+    void readTokens();
+
+    QString attributeValue(const char *name) const;
+    QString readElementText();
+    ByteView readElementUtf8();
+    ByteView attributeUtf8(const char *name);
+    qint64 lineNumber() const;
+
+    QByteArray indent() const;
     TrackDataFolder *getFolder(const QString &path);
     TrackDataFolder *waypointFolder(const TrackDataWaypoint *tdw = nullptr);
-    void getLatLong(TrackDataAbstractPoint *pnt, const QXmlStreamAttributes &atts, const QString &localName);
-    QString elementContents();
+    void getLatLong(TrackDataAbstractPoint *pnt, const ByteView &localName);
+    QByteArray elementContents();
 
     void addMessage(ErrorReporter::Severity severity, const QString &msg);
 
-    void checkNamespace(const QStringRef &namespaceURI, const QStringRef &localName, const QStringRef &nsPrefix);
+    void checkNamespace(const QByteArray &namespaceURI, const ByteView &localName, const ByteView &nsPrefix);
 
 private:
     TrackDataTrack *mCurrentTrack;
@@ -99,13 +147,16 @@ private:
     TrackDataSegment *mCurrentSegment;
     TrackDataAbstractPoint *mCurrentPoint;
 
+    QVector<ParseState> mStateStack;
     bool mWithinMetadata;
     bool mWithinExtensions;
 
     QXmlStreamReader *mXmlReader;
+    XmlTokenizer *mTokenizer;
     int mXmlIndent;
 
-    QString mContainedChars;
+    QByteArray mContainedChars;
+    QByteArray mUtf8Buffer;
 
     QStringList mUndefinedNamespaces;
 };
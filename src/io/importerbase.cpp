@@ -31,10 +31,12 @@
 #include <qfile.h>
 #include <qdebug.h>
 #include <qtemporaryfile.h>
+#include <qscopedpointer.h>
 
 #include <klocalizedstring.h>
 #include <kio/filecopyjob.h>
 #include <kio/statjob.h>
+#include <kcompressiondevice.h>
 
 #include "trackdata.h"
 #include "dataindexer.h"
@@ -49,6 +51,9 @@ ImporterBase::ImporterBase()
 {
     qDebug();
     mDataRoot = nullptr;
+    mIncremental = false;
+    mCompletedTaken = 0;
+    mCompressedDevice = nullptr;
 }
 
 
@@ -66,6 +71,31 @@ static void dumpMetadata(const TrackDataItem *tdd, const QString &source)
 #endif
 
 
+// Compressed files are recognised by their content, so that the file
+// name does not matter once the importer has been chosen.  The magic
+// numbers are those recognised by file(1).
+
+static KCompressionDevice::CompressionType compressionType(QIODevice *dev)
+{
+    const QByteArray magic = dev->peek(6);
+    if (magic.startsWith("\x1F\x8B")) return (KCompressionDevice::GZip);
+    if (magic.startsWith("BZh")) return (KCompressionDevice::BZip2);
+    if (magic.startsWith("\xFD" "7zXZ")) return (KCompressionDevice::Xz);
+    return (KCompressionDevice::None);
+}
+
+
+QString ImporterBase::compressedSuffix(const QString &fileName)
+{
+    const int i = fileName.lastIndexOf('.');
+    if (i<=0) return (QString());
+
+    const QString suffix = fileName.mid(i+1).toLower();
+    if (suffix=="gz" || suffix=="bz2" || suffix=="xz") return (suffix);
+    return (QString());
+}
+
+
 TrackDataFile *ImporterBase::load(const QUrl &file)
 {
     qDebug() << "from" << file;
@@ -136,18 +166,47 @@ TrackDataFile *ImporterBase::load(const QUrl &file)
         return (nullptr);
     }
 
+    mBytesTotal.storeRelease(loadFile.size());		// for progress reporting
+    mBytesRead.storeRelease(0);
+
+    // If the file is compressed, then read it through a decompressing
+    // device.  The importer then sees a sequential device and reads the
+    // decompressed data from it as it needs to, so that it is never
+    // all held in memory or written to a temporary file.
+    QIODevice *loadDev = &loadFile;			// device to load from
+    QScopedPointer<KCompressionDevice> compDev;
+    const KCompressionDevice::CompressionType compType = compressionType(&loadFile);
+    if (compType!=KCompressionDevice::None)
+    {
+        qDebug() << "compression type" << compType;
+        compDev.reset(new KCompressionDevice(&loadFile, false, compType));
+        if (!compDev->open(QIODevice::ReadOnly))
+        {
+            reporter()->setError(ErrorReporter::Fatal, i18n("Cannot open compressed file, %1", compDev->errorString()));
+            if (!tempPath.isEmpty()) QFile::remove(tempPath);
+            return (nullptr);
+        }
+
+        loadDev = compDev.data();
+        mCompressedDevice = &loadFile;			// for progress reporting
+    }
+
     // Allocate the root data item.  If the read is successful
     // then it is returned to the caller which takes ownership of it.
     mDataRoot = new TrackDataFile;
     mDataRoot->setFileName(file);			// sets name from file's basename
 
     // Import from the file
-    if (!loadFrom(&loadFile))
+    mSourcePath = (tempPath.isEmpty() ? loadPath : QString());
+    if (!loadFrom(loadDev))
     {
         qWarning() << "file load failed!";
         delete mDataRoot; mDataRoot = nullptr;
     }
 
+    if (!compDev.isNull()) compDev->close();		// finished decompressing
+    mCompressedDevice = nullptr;
+    mSourcePath.clear();
     loadFile.close();					// finished reading file
     if (!tempPath.isEmpty()) QFile::remove(tempPath);	// finished with temporary file
 
@@ -162,23 +221,150 @@ TrackDataFile *ImporterBase::load(const QUrl &file)
 #ifdef DEBUG_IMPORT
         dumpMetadata(mDataRoot, "metadata of file:");
 #endif
-        for (int i = 0; i<mDataRoot->childCount(); ++i)
-        {
-            TrackDataTrack *tdt = dynamic_cast<TrackDataTrack *>(mDataRoot->childAt(i));
-            if (tdt==nullptr) continue;
+        for (int i = 0; i<mDataRoot->childCount(); ++i) mergeFileMetadata(mDataRoot->childAt(i));
+    }
+
+    mBytesRead.storeRelease(mBytesTotal.loadAcquire());	// finished reading
+    return (mDataRoot);
+}
+
+
+void ImporterBase::mergeFileMetadata(TrackDataItem *item) const
+{
+    TrackDataTrack *tdt = TrackData::cast<TrackDataTrack>(item);
+    if (tdt==nullptr) return;
 #ifdef DEBUG_IMPORT
-            dumpMetadata(tdt, QString("original metadata of track %1 \"%2\":").arg(i).arg(tdt->name()));
+    dumpMetadata(tdt, QString("original metadata of track \"%1\":").arg(tdt->name()));
 #endif
 
-            if (tdt->metadata("creator").isNull())	// only if blank already
-            {
-                tdt->copyMetadata(mDataRoot, false);
+    if (tdt->metadata(DataIndexer::IndexCreator).isNull())	// only if blank already
+    {
+        tdt->copyMetadata(mDataRoot, false);
 #ifdef DEBUG_IMPORT
-                dumpMetadata(tdt, QString("merged metadata of track %1 \"%2\":").arg(i).arg(tdt->name()));
+        dumpMetadata(tdt, QString("merged metadata of track \"%1\":").arg(tdt->name()));
 #endif
-            }
-        }
     }
+}
 
-    return (mDataRoot);
+
+// Called by the importer when a top level item has been completely
+// read.  If loading incrementally, the item will not be accessed again
+// by the worker thread after this, so it may be taken by the GUI thread.
+// The file metadata is merged into it now instead of at the end of the
+// load, which is possible because it must come at the start of the file.
+
+void ImporterBase::addCompletedItem(TrackDataItem *item)
+{
+    if (!mIncremental)					// the usual case
+    {
+        mDataRoot->addChildItem(item);			// just add to the tree
+        return;
+    }
+
+    mergeFileMetadata(item);
+
+    QMutexLocker locker(&mCompletedLock);
+    // Its position is where it would have been added, allowing for
+    // all of the completed top level items before it that are not in
+    // the tree.
+    int pos = mDataRoot->childCount();
+    for (const CompletedEntry &ce : qAsConst(mCompletedItems))
+    {
+        if (ce.parent==mDataRoot) ++pos;
+    }
+
+    mCompletedItems.append({ { item, nullptr, QString() }, mDataRoot, pos });
+}
+
+
+// Called by the importer when a child item, for example a segment of
+// a track, has been completely read but its parent has not.  If loading
+// incrementally, the item will not be accessed again by the worker
+// thread after this, and it is not added to the parent until the load
+// has finished, so it may be taken by the GUI thread.  This allows a
+// file that contains only one long track to be shown as it loads.
+
+void ImporterBase::addCompletedChild(TrackDataItem *parent, TrackDataItem *item)
+{
+    if (!mIncremental)					// the usual case
+    {
+        parent->addChildItem(item);			// just add to the parent
+        return;
+    }
+
+    QMutexLocker locker(&mCompletedLock);
+    int pos = parent->childCount();
+    for (const CompletedEntry &ce : qAsConst(mCompletedItems))
+    {
+        if (ce.parent==parent) ++pos;
+    }
+
+    mCompletedItems.append({ { item, parent, parent->name() }, parent, pos });
+}
+
+
+// Called by the importer if a parent which has completed children
+// will not itself be completed, for example if the load fails part way
+// through it.  The importer is then about to delete the parent, so any
+// of its children that are restored will be deleted instead.
+
+void ImporterBase::discardCompletedChildren(const TrackDataItem *parent)
+{
+    QMutexLocker locker(&mCompletedLock);
+    for (CompletedEntry &ce : mCompletedItems)
+    {
+        if (ce.parent==parent) ce.parent = nullptr;
+    }
+}
+
+
+QVector<ImporterBase::CompletedItem> ImporterBase::takeCompletedItems()
+{
+    QMutexLocker locker(&mCompletedLock);
+    QVector<ImporterBase::CompletedItem> items;
+    while (mCompletedTaken<mCompletedItems.count()) items.append(mCompletedItems.at(mCompletedTaken++).completed);
+    return (items);
+}
+
+
+void ImporterBase::restoreCompletedItems()
+{
+    QMutexLocker locker(&mCompletedLock);
+    Q_ASSERT(mDataRoot!=nullptr);
+    // Inserting in the order of completion puts each item back at its
+    // original position, since all of those before it are already there.
+    // A child is always completed before its parent, but that does not
+    // matter because the parent is not in the tree yet.
+    for (const CompletedEntry &ce : qAsConst(mCompletedItems))
+    {
+        if (ce.parent!=nullptr) ce.parent->addChildItem(ce.completed.item, ce.position);
+        else delete ce.completed.item;			// its parent was discarded
+    }
+
+    mCompletedItems.clear();
+    mCompletedTaken = 0;
+}
+
+
+// Called by the importer from time to time to report the progress of
+// the load.  Returns false if the load has been cancelled, in which
+// case the importer should stop reading and return failure.
+//
+// If the file is compressed then the position within the decompressed
+// data is not comparable with the file size, so the position within
+// the compressed file is used instead.
+
+bool ImporterBase::updateProgress(qint64 bytesRead)
+{
+    if (mCompressedDevice!=nullptr) bytesRead = mCompressedDevice->pos();
+    mBytesRead.storeRelease(bytesRead);
+    return (!isCancelled());
+}
+
+
+int ImporterBase::progress() const
+{
+    const qint64 total = mBytesTotal.loadAcquire();
+    if (total<=0) return (0);
+    return (int((mBytesRead.loadAcquire()*1000)/total));
 }
@@ -26,11 +26,17 @@
 #ifndef IMPORTERBASE_H
 #define IMPORTERBASE_H
 
+#include <qlist.h>
+#include <qvector.h>
+#include <qmutex.h>
+#include <qatomic.h>
+
 #include "importerexporterbase.h"
 
 class QFile;
 class QUrl;
 class TrackDataFile;
+class TrackDataItem;
 class QIODevice;
 
 
@@ -43,9 +49,79 @@ public:
     TrackDataFile *load(const QUrl &file);
     virtual bool needsResave() const			{ return (false); }
 
+    // If the file name has a suffix indicating that it is compressed,
+    // then return that suffix (without the leading '.').  Otherwise
+    // return a null string.
+    static QString compressedSuffix(const QString &fileName);
+
+    // Support for loading a file in a worker thread.  The load() is
+    // called in the worker thread, and the functions below may be called
+    // from the GUI thread while it is in progress.
+    //
+    // If incremental loading is set, then completed top level items
+    // (tracks and routes) and completed segments of a track are not
+    // added to the loaded data but can be taken by takeCompletedItems()
+    // as soon as they are available.  When the load has finished,
+    // restoreCompletedItems() puts them back into the loaded data in
+    // their original order.  The caller is responsible for them in between.
+    //
+    // For a segment, the parent is the track that it belongs to.  That
+    // may still be being read, so it must not be accessed by the caller;
+    // it is only for recognising the track when it is completed itself.
+    // The name of the track as it was when the segment was completed
+    // is provided instead.
+    struct CompletedItem
+    {
+        TrackDataItem *item;				// the completed item
+        const TrackDataItem *parent;			// its parent, or null if top level
+        QString parentName;				// name of that parent
+    };
+
+    void setIncremental(bool on)			{ mIncremental = on; }
+    QVector<ImporterBase::CompletedItem> takeCompletedItems();
+    void restoreCompletedItems();
+
+    void cancel()					{ mCancelled.storeRelease(1); }
+    bool isCancelled() const				{ return (mCancelled.loadAcquire()!=0); }
+    int progress() const;				// in units of 1/1000 of file
+
 protected:
     virtual bool loadFrom(QIODevice *dev) = 0;
 
+    // For use by loadFrom() implementations
+    void addCompletedItem(TrackDataItem *item);
+    void addCompletedChild(TrackDataItem *parent, TrackDataItem *item);
+    void discardCompletedChildren(const TrackDataItem *parent);
+    bool updateProgress(qint64 bytesRead);
+
+    // The local path of the file being loaded, if it will still exist
+    // after the load has finished.  If it is a temporary copy of a remote
+    // file then this is a null string.
+    QString sourcePath() const				{ return (mSourcePath); }
+
+private:
+    void mergeFileMetadata(TrackDataItem *item) const;
+
+private:
+    struct CompletedEntry
+    {
+        ImporterBase::CompletedItem completed;		// the item and its parent
+        TrackDataItem *parent;				// parent to restore it to,
+							// null if it was discarded
+        int position;					// its index within that
+    };
+
+    bool mIncremental;
+    QVector<CompletedEntry> mCompletedItems;
+    int mCompletedTaken;
+    QMutex mCompletedLock;
+
+    QAtomicInt mCancelled;
+    QIODevice *mCompressedDevice;			// underlying compressed file
+    QString mSourcePath;
+    QAtomicInteger<qint64> mBytesRead;
+    QAtomicInteger<qint64> mBytesTotal;
+
 protected:
     // TODO: private with accessor
     TrackDataFile *mDataRoot;
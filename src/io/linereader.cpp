@@ -0,0 +1,215 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "linereader.h"
+
+#include <string.h>
+
+#include <qiodevice.h>
+#include <qdatetime.h>
+#include <qdebug.h>
+
+#include "trackdata.h"
+#include "xmltokenizer.h"
+
+
+static const int chunkSize = 256*1024;			// amount read from device
+static const int maxLineLength = 1024*1024;		// assume not text if longer
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  LineReader								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+LineReader::LineReader(QIODevice *dev)
+    : mDevice(dev)
+{
+    mStart = mEnd = 0;
+    mAtEnd = false;
+    mLineNumber = 0;
+    mPosition = 0;
+}
+
+
+// Move any incomplete line to the start of the buffer, then read
+// another chunk after it.  The buffer only needs to grow if a line
+// is longer than a chunk.
+
+bool LineReader::fillBuffer()
+{
+    const int remaining = mEnd-mStart;
+    if (remaining>maxLineLength)
+    {
+        mErrorString = "Line too long";
+        return (false);
+    }
+
+    if (mStart>0 && remaining>0) memmove(mBuffer.data(), mBuffer.constData()+mStart, remaining);
+    mStart = 0;
+    mEnd = remaining;
+
+    if (mBuffer.size()<(mEnd+chunkSize)) mBuffer.resize(mEnd+chunkSize);
+    const qint64 num = mDevice->read(mBuffer.data()+mEnd, chunkSize);
+    if (num<0)
+    {
+        mErrorString = mDevice->errorString();
+        return (false);
+    }
+
+    if (num==0) mAtEnd = true;				// no more to read
+    mEnd += num;
+    mPosition += num;
+    return (true);
+}
+
+
+bool LineReader::readLine(ByteView *line)
+{
+    if (hasError()) return (false);
+
+    while (true)
+    {
+        const char *start = mBuffer.constData()+mStart;
+        const int avail = mEnd-mStart;
+        const char *nl = static_cast<const char *>(avail>0 ? memchr(start, '\n', avail) : nullptr);
+        if (nl!=nullptr || (mAtEnd && avail>0))		// complete line, or last line
+        {
+            int len = (nl!=nullptr ? nl-start : avail);
+            mStart += (nl!=nullptr ? len+1 : len);
+            if (len>0 && start[len-1]=='\r') --len;	// CR-LF line ending
+
+            *line = ByteView(start, len);
+            ++mLineNumber;
+            return (true);
+        }
+
+        if (mAtEnd) return (false);			// no more lines
+        if (!fillBuffer()) return (false);		// read error
+    }
+}
+
+
+int LineReader::splitFields(const ByteView &line, char sep, ByteView *fields, int maxFields)
+{
+    const char *p = line.data();
+    const char *end = p+line.size();
+    int num = 0;
+
+    while (num<maxFields)
+    {
+        const char *start = p;
+        if (p<end && *p=='"')				// quoted field
+        {
+            ++start;
+            ++p;
+            while (p<end)
+            {
+                if (*p=='"')
+                {
+                    if ((p+1)<end && p[1]=='"') ++p;	// doubled quote
+                    else break;				// closing quote
+                }
+                ++p;
+            }
+
+            fields[num++] = ByteView(start, p-start);
+            while (p<end && *p!=sep) ++p;		// ignore after closing quote
+        }
+        else
+        {
+            const char *s = static_cast<const char *>(p<end ? memchr(p, sep, end-p) : nullptr);
+            p = (s!=nullptr ? s : end);
+            fields[num++] = ByteView(start, p-start);
+        }
+
+        if (p>=end) break;				// end of line
+        ++p;						// past the separator
+    }
+
+    return (num);
+}
+
+
+bool LineReader::parseDigits(const char *p, int len, int *result)
+{
+    int val = 0;
+    for (int i = 0; i<len; ++i)
+    {
+        if (p[i]<'0' || p[i]>'9') return (false);
+        val = val*10+(p[i]-'0');
+    }
+
+    *result = val;
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  TimeOfDayStitcher							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+static const int msecsPerDay = 24*3600*1000;
+
+
+TimeOfDayStitcher::TimeOfDayStitcher()
+{
+    mDayStart = TrackData::NoTime;
+    mLastTime = -1;
+}
+
+
+bool TimeOfDayStitcher::setDate(int year, int month, int day)
+{
+    const QDate date(year, month, day);
+    if (!date.isValid()) return (false);
+
+    // The Julian day number of 1 January 1970 is 2440588
+    mDayStart = (date.toJulianDay()-2440588)*msecsPerDay;
+    mLastTime = -1;					// no previous time today
+    return (true);
+}
+
+
+bool TimeOfDayStitcher::hasDate() const
+{
+    return (mDayStart!=TrackData::NoTime);
+}
+
+
+qint64 TimeOfDayStitcher::time(int msecs)
+{
+    if (!hasDate()) return (TrackData::NoTime);
+
+    if (mLastTime>=0 && msecs<(mLastTime-msecsPerDay/2))
+    {							// gone past midnight
+        mDayStart += msecsPerDay;
+        qDebug() << "advanced to day" << (mDayStart/msecsPerDay);
+    }
+
+    mLastTime = msecs;
+    return (mDayStart+msecs);
+}
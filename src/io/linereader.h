@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef LINEREADER_H
+#define LINEREADER_H
+
+#include <qstring.h>
+#include <qbytearray.h>
+
+class QIODevice;
+class ByteView;
+
+
+/**
+ * @short Reads lines of text from a device in large chunks.
+ *
+ * This is used for importing line-oriented formats such as NMEA or CSV.
+ * The device is read in chunks of a fixed size, and each line is returned
+ * as a ByteView referring directly into the chunk buffer, so that nothing
+ * is copied or converted unless the caller wants to keep it.  The device
+ * may be sequential, for example decompressing a file while it is read.
+ *
+ * Lines may end with LF or CR-LF, and the last line in the file does not
+ * need to be terminated.
+ *
+ * @author Jonathan Marten
+ **/
+
+class LineReader
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param dev The device to read from, which must already be open
+     **/
+    explicit LineReader(QIODevice *dev);
+
+    /**
+     * Destructor.
+     **/
+    ~LineReader() = default;
+
+    /**
+     * Read the next line.
+     *
+     * @param line The line is returned here, without the line terminator
+     * @return @c true if a line was read, @c false at the end of the
+     * data or if there was an error
+     *
+     * @note The returned line is only valid until the next call.
+     **/
+    bool readLine(ByteView *line);
+
+    bool hasError() const				{ return (!mErrorString.isNull()); }
+    const QString &errorString() const			{ return (mErrorString); }
+
+    /**
+     * Get the line number of the line last read.
+     *
+     * @return the line number, starting at 1
+     **/
+    qint64 lineNumber() const				{ return (mLineNumber); }
+
+    /**
+     * Get the current position within the device, for progress reporting.
+     *
+     * @return the number of bytes read from the device so far
+     **/
+    qint64 position() const				{ return (mPosition); }
+
+    /**
+     * Split a line into fields, without any copying or allocation.
+     *
+     * A field may be enclosed in double quotes, in which case it can
+     * contain the separator.  The returned field does not include the
+     * quotes, but a doubled quote within it is not reduced.
+     *
+     * @param line The line to split
+     * @param sep The field separator
+     * @param fields The fields are returned here
+     * @param maxFields The maximum number of fields to return
+     * @return the number of fields returned
+     **/
+    static int splitFields(const ByteView &line, char sep, ByteView *fields, int maxFields);
+
+    /**
+     * Parse a field, or part of one, consisting only of decimal digits.
+     *
+     * @param p The start of the digits
+     * @param len The number of digits
+     * @param result The value is returned here
+     * @return @c true if all of the characters were digits
+     **/
+    static bool parseDigits(const char *p, int len, int *result);
+
+private:
+    bool fillBuffer();
+
+private:
+    QIODevice *mDevice;
+    QByteArray mBuffer;
+    int mStart;						// start of unread data
+    int mEnd;						// end of valid data
+    bool mAtEnd;					// device has no more data
+    qint64 mLineNumber;
+    qint64 mPosition;
+    QString mErrorString;
+};
+
+
+/**
+ * @short Combines times of day with a date.
+ *
+ * GPS logs often record only the time of day for each point, with
+ * the date either given separately or not at all.  The date is set
+ * whenever it is known.  After that, if a time of day is more than
+ * 12 hours earlier than the previous one then midnight is assumed
+ * to have passed and the date is advanced.
+ *
+ * @author Jonathan Marten
+ **/
+
+class TimeOfDayStitcher
+{
+public:
+    TimeOfDayStitcher();
+    ~TimeOfDayStitcher() = default;
+
+    /**
+     * Set the current date.
+     *
+     * @param year The year
+     * @param month The month, 1-12
+     * @param day The day of the month, 1-31
+     * @return @c true if the date is valid
+     **/
+    bool setDate(int year, int month, int day);
+
+    bool hasDate() const;
+
+    /**
+     * Get the full time for a time of day.
+     *
+     * @param msecs The time of day in milliseconds since midnight UTC
+     * @return the time in milliseconds since the epoch, or
+     * TrackData::NoTime if no date has been set yet
+     **/
+    qint64 time(int msecs);
+
+private:
+    qint64 mDayStart;					// start of current day
+    int mLastTime;					// last time of day seen
+};
+
+#endif							// LINEREADER_H
@@ -0,0 +1,365 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "nmeaimporter.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <qdebug.h>
+
+#include <klocalizedstring.h>
+
+#include "trackdata.h"
+#include "dataindexer.h"
+#include "errorreporter.h"
+#include "xmltokenizer.h"
+
+
+#undef DEBUG_IMPORT
+
+#define PROGRESS_INTERVAL	4096			// lines between progress updates
+
+static const int maxFields = 24;			// more than any sentence used
+static const double knotsToMetresPerSecond = 1852.0/3600.0;
+
+
+NmeaImporter::NmeaImporter()
+    : ImporterBase()
+{
+    qDebug();
+}
+
+
+QString NmeaImporter::filter()
+{
+    return ("NMEA log files (*.nmea)");
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Field parsing							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// A time of day in the format "hhmmss" or "hhmmss.sss", with any number
+// of digits after the decimal point.
+
+static bool parseTimeOfDay(const ByteView &field, int *msecs)
+{
+    const char *p = field.data();
+    const int len = field.size();
+    int hh, mm, ss;
+    if (len<6 || !LineReader::parseDigits(p, 2, &hh) ||
+        !LineReader::parseDigits(p+2, 2, &mm) || !LineReader::parseDigits(p+4, 2, &ss)) return (false);
+    if (hh>23 || mm>59 || ss>60) return (false);
+
+    int ms = 0;
+    if (len>6)
+    {
+        if (p[6]!='.') return (false);
+        int scale = 100;				// for first fraction digit
+        for (int i = 7; i<len; ++i)
+        {
+            if (p[i]<'0' || p[i]>'9') return (false);
+            ms += (p[i]-'0')*scale;
+            scale /= 10;
+        }
+    }
+
+    *msecs = ((hh*60+mm)*60+ss)*1000+ms;
+    return (true);
+}
+
+
+// A date in the format "ddmmyy".  Two digit years are
+// assumed to be in the range 1980-2079.
+
+static bool parseDate(const ByteView &field, TimeOfDayStitcher *stitcher)
+{
+    int dd, mm, yy;
+    if (field.size()!=6 || !LineReader::parseDigits(field.data(), 2, &dd) ||
+        !LineReader::parseDigits(field.data()+2, 2, &mm) || !LineReader::parseDigits(field.data()+4, 2, &yy)) return (false);
+    return (stitcher->setDate((yy<80 ? 2000 : 1900)+yy, mm, dd));
+}
+
+
+// A latitude or longitude in the format "dddmm.mmmm",
+// followed by a separate hemisphere field.
+
+static bool parseCoordinate(const ByteView &field, const ByteView &hemisphere, double *result)
+{
+    double val;
+    if (!TrackData::parseDouble(field.data(), field.size(), &val) || val<0) return (false);
+
+    const double deg = floor(val/100);
+    const double min = val-deg*100;
+    if (min>=60) return (false);
+    val = deg+min/60;
+
+    if (hemisphere=="S" || hemisphere=="W") val = -val;
+    else if (hemisphere!="N" && hemisphere!="E") return (false);
+
+    *result = val;
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Reading sentences							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+bool NmeaImporter::loadFrom(QIODevice *dev)
+{
+    qDebug() << "starting";
+
+    mStitcher = TimeOfDayStitcher();
+    mTrack = nullptr;
+    mSegment = nullptr;
+    mPoint = nullptr;
+    mPointTime = 0;
+    mSatIndex = DataIndexer::index("sat");
+
+    mPointCount = 0;
+    mChecksumErrors = 0;
+    mUndatedPoints = 0;
+
+    LineReader reader(dev);
+    ByteView line;
+    bool cancelled = false;
+    while (reader.readLine(&line))
+    {
+        if ((reader.lineNumber()%PROGRESS_INTERVAL)==0 && !updateProgress(reader.position()))
+        {
+            cancelled = true;
+            break;
+        }
+
+        readSentence(line);
+    }
+
+    finishPoint();					// finish the last point
+    finishSegment();					// and its segment
+    qDebug() << "done, lines" << reader.lineNumber() << "points" << mPointCount;
+
+    if (cancelled || reader.hasError())
+    {
+        delete mTrack;					// not added to file yet
+        mTrack = nullptr;
+        if (cancelled) return (setError("Loading cancelled"));
+        return (setError(i18n("Cannot read file at line %1, %2", reader.lineNumber(), reader.errorString())));
+    }
+
+    if (mTrack==nullptr) return (setError(i18n("No valid position fixes found")));
+
+    if (mChecksumErrors>0)
+    {
+        reporter()->setError(ErrorReporter::Warning,
+                             i18np("%1 sentence with a checksum error was ignored",
+                                   "%1 sentences with checksum errors were ignored", mChecksumErrors));
+    }
+
+    if (mUndatedPoints>0)
+    {
+        reporter()->setError(ErrorReporter::Warning,
+                             i18np("No date was found for %1 point, its time is not known",
+                                   "No date was found for %1 points, their times are not known", mUndatedPoints));
+    }
+
+    addCompletedItem(mTrack);
+    mTrack = nullptr;
+    return (true);
+}
+
+
+// A sentence starts with a '$' and may end with a checksum, which
+// is the exclusive OR of all the characters between the '$' and the
+// '*' written as two hexadecimal digits.  Anything before the '$',
+// such as a time stamp added by the logger, is ignored.
+
+void NmeaImporter::readSentence(const ByteView &line)
+{
+    const char *start = static_cast<const char *>(memchr(line.data(), '$', line.size()));
+    if (start==nullptr) return;				// not a sentence
+    ++start;
+
+    const char *end = line.data()+line.size();
+    const char *star = static_cast<const char *>(memchr(start, '*', end-start));
+    if (star!=nullptr)					// there is a checksum
+    {
+        int sum = 0;
+        for (const char *p = start; p<star; ++p) sum ^= static_cast<unsigned char>(*p);
+
+        const ByteView given = ByteView(star+1, end-star-1).trimmed();
+        bool ok;
+        const int expected = QByteArray::fromRawData(given.data(), given.size()).toInt(&ok, 16);
+        if (!ok || expected!=sum)
+        {
+#ifdef DEBUG_IMPORT
+            qDebug() << "checksum error at line" << line.toByteArray();
+#endif
+            ++mChecksumErrors;
+            return;
+        }
+
+        end = star;
+    }
+
+    ByteView fields[maxFields];
+    const int num = LineReader::splitFields(ByteView(start, end-start), ',', fields, maxFields);
+
+    // The sentence identifier is a talker ID (e.g. "GP", "GN" or "GL")
+    // followed by the sentence type.
+    const ByteView &id = fields[0];
+    if (id.size()!=5) return;				// not a standard sentence
+    const ByteView type(id.data()+2, 3);
+
+    if (type=="RMC") readRmc(fields, num);
+    else if (type=="GGA") readGga(fields, num);
+}
+
+
+// RMC: time, status, latitude, N/S, longitude, E/W, speed (knots),
+// course (degrees true), date, and some that are not used.
+
+void NmeaImporter::readRmc(const ByteView *fields, int num)
+{
+    if (num<10) return;					// not enough fields
+
+    if (fields[2]!="A")					// not a valid fix
+    {
+        finishPoint();
+        finishSegment();
+    }
+    else if (startPoint(fields[1]))
+    {
+        double lat, lon;
+        if (parseCoordinate(fields[3], fields[4], &lat) &&
+            parseCoordinate(fields[5], fields[6], &lon)) mPoint->setLatLong(lat, lon);
+
+        double val;
+        if (TrackData::parseDouble(fields[7].data(), fields[7].size(), &val)) mPoint->setSpeed(val*knotsToMetresPerSecond);
+        if (TrackData::parseDouble(fields[8].data(), fields[8].size(), &val)) mPoint->setMetadata(DataIndexer::IndexHeading, val);
+    }
+
+    // The date applies to this point, any previous point
+    // has already been finished.
+    parseDate(fields[9], &mStitcher);
+}
+
+
+// GGA: time, latitude, N/S, longitude, E/W, fix quality, number of
+// satellites, HDOP, altitude, altitude units, and some that are not used.
+
+void NmeaImporter::readGga(const ByteView *fields, int num)
+{
+    if (num<11) return;					// not enough fields
+
+    if (fields[6].isEmpty() || fields[6]=="0")		// not a valid fix
+    {
+        finishPoint();
+        finishSegment();
+        return;
+    }
+
+    if (!startPoint(fields[1])) return;
+
+    double lat, lon;
+    if (parseCoordinate(fields[2], fields[3], &lat) &&
+        parseCoordinate(fields[4], fields[5], &lon)) mPoint->setLatLong(lat, lon);
+
+    int sats;
+    if (!fields[7].isEmpty() && LineReader::parseDigits(fields[7].data(), fields[7].size(), &sats)) mPoint->setMetadata(mSatIndex, sats);
+
+    double val;
+    if (TrackData::parseDouble(fields[8].data(), fields[8].size(), &val)) mPoint->setHdop(val);
+    if (fields[10]=="M" && TrackData::parseDouble(fields[9].data(), fields[9].size(), &val)) mPoint->setElevation(val);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Creating points							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// Start a new point for the time of a sentence, or continue with the
+// current point if it has the same time.  Returns false if the time
+// is not valid, in which case the sentence should be ignored.
+
+bool NmeaImporter::startPoint(const ByteView &timeField)
+{
+    int msecs;
+    if (!parseTimeOfDay(timeField, &msecs)) return (false);
+    if (mPoint!=nullptr && msecs==mPointTime) return (true);
+
+    finishPoint();
+    mPoint = new TrackDataTrackpoint;
+    mPointTime = msecs;
+    return (true);
+}
+
+
+// The point is completed before it is added to the segment, so
+// that setting its values does not need to invalidate any cached data.
+
+void NmeaImporter::finishPoint()
+{
+    if (mPoint==nullptr) return;
+
+    if (ISNAN(mPoint->latitude()) || ISNAN(mPoint->longitude()))
+    {							// no valid position
+        delete mPoint;
+        mPoint = nullptr;
+        return;
+    }
+
+    const qint64 t = mStitcher.time(mPointTime);
+    if (t==TrackData::NoTime) ++mUndatedPoints;
+    mPoint->setTimeMSecs(t);
+
+    if (mSegment==nullptr) mSegment = new TrackDataSegment;
+    mSegment->addChildItem(mPoint);
+    mPoint = nullptr;
+    ++mPointCount;
+}
+
+
+void NmeaImporter::finishSegment()
+{
+    if (mSegment==nullptr) return;
+
+    if (mTrack==nullptr) mTrack = new TrackDataTrack;
+    mTrack->addChildItem(mSegment);
+    mSegment = nullptr;
+}
+
+
+bool NmeaImporter::setError(const QString &msg)
+{
+    // See SnapshotImporter::setError()
+    reporter()->setError(ErrorReporter::Fatal, msg);
+    return (false);
+}
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef NMEAIMPORTER_H
+#define NMEAIMPORTER_H
+
+#include "importerbase.h"
+#include "linereader.h"
+
+class TrackDataTrack;
+class TrackDataSegment;
+class TrackDataTrackpoint;
+class ByteView;
+
+
+// Imports a log of NMEA 0183 sentences, as recorded by many GPS receivers
+// and loggers.  The position, time, speed, course, elevation and quality
+// of each fix are read from the RMC and GGA sentences, all other sentences
+// are ignored.  A receiver normally reports both of these for each fix,
+// so consecutive sentences with the same time are combined into a single
+// point.  A loss of fix ends the current segment.
+//
+// The GGA sentence only has the time of day, so the date is taken from
+// the RMC sentences and advanced if the log continues past midnight.
+
+class NmeaImporter : public ImporterBase
+{
+public:
+    NmeaImporter();
+    virtual ~NmeaImporter() = default;
+
+    static QString filter();
+
+    // ImporterBase
+    bool loadFrom(QIODevice *dev) override;
+
+private:
+    void readSentence(const ByteView &line);
+    void readRmc(const ByteView *fields, int num);
+    void readGga(const ByteView *fields, int num);
+
+    bool startPoint(const ByteView &timeField);
+    void finishPoint();
+    void finishSegment();
+
+    bool setError(const QString &msg);
+
+private:
+    TimeOfDayStitcher mStitcher;
+    TrackDataTrack *mTrack;
+    TrackDataSegment *mSegment;
+    TrackDataTrackpoint *mPoint;
+    int mPointTime;					// time of day of current point
+    int mSatIndex;					// DataIndexer index for "sat"
+
+    int mPointCount;
+    int mChecksumErrors;
+    int mUndatedPoints;
+};
+
+#endif							// NMEAIMPORTER_H
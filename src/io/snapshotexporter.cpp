@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "snapshotexporter.h"
+
+#include <string.h>
+
+#include <qdatastream.h>
+#include <qiodevice.h>
+#include <qendian.h>
+#include <qvector.h>
+#include <qdebug.h>
+
+#include "trackdata.h"
+#include "dataindexer.h"
+#include "snapshotformat.h"
+
+
+SnapshotExporter::SnapshotExporter()
+    : ExporterBase()
+{
+    qDebug();
+}
+
+
+QString SnapshotExporter::filter()
+{
+    return ("Umbrail snapshot files (*.umbrail)");
+}
+
+
+// Write a point column of 8 byte values, in little endian byte order.
+
+template<typename T> static void writeColumn(QDataStream &str, const T *data, int num)
+{
+    static_assert(sizeof(T)==8, "column values must be 8 bytes");
+#if Q_BYTE_ORDER==Q_LITTLE_ENDIAN
+    str.writeRawData(reinterpret_cast<const char *>(data), num*8);
+#else
+    QVector<quint64> buf(num);
+    for (int i = 0; i<num; ++i)
+    {
+        quint64 v;
+        memcpy(&v, data+i, 8);
+        buf[i] = qToLittleEndian(v);
+    }
+    str.writeRawData(reinterpret_cast<const char *>(buf.constData()), num*8);
+#endif
+}
+
+
+// Write the flags, name and general metadata of an item.  Only the
+// general metadata is written, accessed using the base class function
+// so that the values stored directly in a point are not included.
+
+static void writeHeader(const TrackDataItem *item, QDataStream &str)
+{
+    const bool explicitName = item->hasExplicitName();
+    str << quint8(explicitName ? SnapshotFormat::FlagExplicitName : 0);
+    if (explicitName) str << item->name();
+
+    const int cnt = item->metadataCount();
+    quint32 num = 0;
+    for (int idx = 0; idx<cnt; ++idx)
+    {
+        if (!item->TrackDataItem::metadata(idx).isNull()) ++num;
+    }
+
+    str << num;
+    for (int idx = 0; idx<cnt; ++idx)
+    {
+        const QVariant v = item->TrackDataItem::metadata(idx);
+        if (!v.isNull()) str << quint32(idx) << v;
+    }
+}
+
+
+void SnapshotExporter::writeItem(const TrackDataItem *item, QDataStream &str) const
+{
+    str << quint8(item->type());
+    writeHeader(item, str);
+
+    const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item);
+    if (tdp!=nullptr)					// values stored in point
+    {
+        str << tdp->latitude() << tdp->longitude()
+            << tdp->elevation() << tdp->speed() << tdp->hdop() << tdp->timeMSecs();
+    }
+
+    str << quint32(item->childCount());
+    if (TrackData::cast<TrackDataSegment>(item)!=nullptr ||
+        TrackData::cast<TrackDataRoute>(item)!=nullptr) writePoints(item, str);
+    else
+    {
+        const int num = item->childCount();
+        for (int i = 0; i<num; ++i) writeItem(item->childAt(i), str);
+    }
+}
+
+
+// The points of a segment or route are written as columns.  Each column
+// is gathered from all of the points in turn into a buffer, which is
+// reused for all of the columns of the same type.
+
+void SnapshotExporter::writePoints(const TrackDataItem *item, QDataStream &str) const
+{
+    const int num = item->childCount();
+    if (num==0) return;					// no points to write
+
+    str << quint8(item->childAt(0)->type());		// all points are the same type
+
+    // The size of the block is not known until it has been written,
+    // so write a placeholder and then go back to fill it in.
+    QIODevice *dev = str.device();
+    const qint64 sizePos = dev->pos();
+    str << quint64(0);
+
+    QVector<const TrackDataAbstractPoint *> points(num);
+    for (int i = 0; i<num; ++i)
+    {
+        points[i] = TrackData::cast<TrackDataAbstractPoint>(item->childAt(i));
+        Q_ASSERT(points[i]!=nullptr);
+    }
+
+    // In the order of SnapshotFormat::PointColumn
+    QVector<double> values(num);
+    double *v = values.data();
+    for (int i = 0; i<num; ++i) v[i] = points[i]->latitude();
+    writeColumn(str, v, num);
+    for (int i = 0; i<num; ++i) v[i] = points[i]->longitude();
+    writeColumn(str, v, num);
+    for (int i = 0; i<num; ++i) v[i] = points[i]->elevation();
+    writeColumn(str, v, num);
+    for (int i = 0; i<num; ++i) v[i] = points[i]->speed();
+    writeColumn(str, v, num);
+    for (int i = 0; i<num; ++i) v[i] = points[i]->hdop();
+    writeColumn(str, v, num);
+    QVector<qint64> times(num);
+    for (int i = 0; i<num; ++i) times[i] = points[i]->timeMSecs();
+    writeColumn(str, times.constData(), num);
+
+    for (int i = 0; i<num; ++i) writeHeader(item->childAt(i), str);
+
+    const qint64 endPos = dev->pos();
+    dev->seek(sizePos);
+    str << quint64(endPos-(sizePos+sizeof(quint64)));
+    dev->seek(endPos);
+}
+
+
+bool SnapshotExporter::saveTo(QIODevice *dev, const TrackDataFile *item)
+{
+    qDebug() << "item" << item->name();
+
+    QDataStream str(dev);
+    str.writeRawData(SnapshotFormat::magic, SnapshotFormat::magicLength);
+    str.setByteOrder(QDataStream::LittleEndian);
+    str.setVersion(SnapshotFormat::streamVersion);
+    str << SnapshotFormat::version;
+
+    // The namespace table
+    const QList<QByteArray> namespaces = DataIndexer::namespacesWithUri();
+    str << quint32(namespaces.count());
+    for (const QByteArray &nsp : namespaces) str << nsp << DataIndexer::uriForNamespace(nsp);
+
+    // The string table
+    const int cnt = DataIndexer::count();
+    str << quint32(cnt);
+    for (int idx = 0; idx<cnt; ++idx) str << DataIndexer::nameWithNamespace(idx);
+
+    writeItem(item, str);				// the complete tree
+
+    if (str.status()!=QDataStream::Ok)
+    {
+        qDebug() << "data stream writing failed!";
+        return (false);
+    }
+
+    return (true);
+}
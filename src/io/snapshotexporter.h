@@ -0,0 +1,55 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef SNAPSHOTEXPORTER_H
+#define SNAPSHOTEXPORTER_H
+
+#include "exporterbase.h"
+
+class QDataStream;
+class TrackDataItem;
+
+
+// Saves the complete tree in the binary snapshot format, see
+// SnapshotFormat.  This is intended for saving a project, so the
+// selection is not taken into account.
+
+class SnapshotExporter : public ExporterBase
+{
+public:
+    SnapshotExporter();
+    virtual ~SnapshotExporter() = default;
+
+    static QString filter();
+
+protected:
+    bool saveTo(QIODevice *dev, const TrackDataFile *item) override;
+
+private:
+    void writeItem(const TrackDataItem *item, QDataStream &str) const;
+    void writePoints(const TrackDataItem *item, QDataStream &str) const;
+};
+
+#endif							// SNAPSHOTEXPORTER_H
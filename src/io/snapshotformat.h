@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef SNAPSHOTFORMAT_H
+#define SNAPSHOTFORMAT_H
+
+#include <qdatastream.h>
+
+/**
+ * @short Definitions for the binary snapshot file format.
+ *
+ * A snapshot holds a complete TrackDataFile tree in a form that can be
+ * loaded much more quickly than a GPX file, for reopening a large
+ * project.  It is not intended as an interchange format, GPX should
+ * be used for that.  The file is written by SnapshotExporter and read
+ * by SnapshotImporter.
+ *
+ * The file starts with an 8 byte magic string and a version number,
+ * followed by a QDataStream (in little endian byte order) containing:
+ *
+ * @li the namespace table, the number of entries followed by the tag
+ *     and URI of each namespace known to the DataIndexer;
+ * @li the string table, the number of entries followed by the qualified
+ *     name of each DataIndexer index.  Metadata indexes in the file are
+ *     indexes into this table, so that they do not depend on the order
+ *     in which names were allocated when the file was saved;
+ * @li the root item record, which includes all of the others.
+ *
+ * An item record is the item type (a TrackData::Type) and flags, the
+ * name if it is explicitly set, the general metadata as a count followed
+ * by (index, QVariant) pairs, the position and values if it is a point
+ * and then the number of children followed by the children.
+ *
+ * The children of a segment or route, which are all points of the same
+ * type, are not written as item records.  If there are any, then the
+ * point type is written followed by the size of the point block (since
+ * version 2), so that it can be skipped over.  The block contains the
+ * point values as raw little endian arrays, one for each of latitude,
+ * longitude, elevation, speed, HDOP (as doubles) and time (as qint64
+ * milliseconds, see TrackData::NoTime).  These can be used directly from
+ * a memory mapped file without being parsed.  They are followed by the
+ * flags, name and general metadata for each point in turn.
+ *
+ * Since the point blocks can be skipped, the points of a segment do not
+ * need to be loaded until they are needed.  See DeferredPointSource.
+ *
+ * @author Jonathan Marten
+ **/
+
+namespace SnapshotFormat
+{
+    // The file magic string, 8 bytes with no terminator
+    constexpr const char *magic = "UMBRSNAP";
+    constexpr int magicLength = 8;
+
+    // The current format version.  This must be increased if the format
+    // changes in any incompatible way, and older versions may continue
+    // to be supported by SnapshotImporter.
+    constexpr quint32 version = 2;
+
+    // The QDataStream version used for the file contents, so that the
+    // encoding of QVariant's does not depend on the Qt version in use.
+    constexpr int streamVersion = QDataStream::Qt_5_12;
+
+    // Segments with fewer points than this are loaded immediately,
+    // larger ones are only loaded when they are needed.
+    constexpr int deferMinimumPoints = 1000;
+
+    // Item flags
+    enum ItemFlag
+    {
+        FlagExplicitName = 0x01				// item has an explicit name
+    };
+
+    // Order of the point columns
+    enum PointColumn
+    {
+        ColumnLatitude,
+        ColumnLongitude,
+        ColumnElevation,
+        ColumnSpeed,
+        ColumnHdop,
+        ColumnTime,
+        ColumnCount					// must be last
+    };
+}
+
+#endif							// SNAPSHOTFORMAT_H
@@ -0,0 +1,502 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#include "snapshotimporter.h"
+
+#include <string.h>
+#include <limits>
+
+#include <qfile.h>
+#include <qbuffer.h>
+#include <qdatastream.h>
+#include <qendian.h>
+#include <qdatetime.h>
+#include <qdebug.h>
+
+#include <klocalizedstring.h>
+
+#include "trackdata.h"
+#include "dataindexer.h"
+#include "errorreporter.h"
+#include "snapshotformat.h"
+
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Reading point blocks						//
+//									//
+//  These are used both while loading the file and for loading the	//
+//  points of a deferred segment.					//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// Get a value from a point column, which is in little endian byte order.
+
+template<typename T> static inline T columnValue(const char *col, int i)
+{
+    static_assert(sizeof(T)==8, "column values must be 8 bytes");
+    const quint64 v = qFromLittleEndian<quint64>(col+qint64(i)*8);
+    T result;
+    memcpy(&result, &v, 8);
+    return (result);
+}
+
+
+static TrackDataItem *createItem(quint8 type)
+{
+    switch (type)
+    {
+case TrackData::Track:		return (new TrackDataTrack);
+case TrackData::Segment:	return (new TrackDataSegment);
+case TrackData::Folder:		return (new TrackDataFolder);
+case TrackData::Route:		return (new TrackDataRoute);
+case TrackData::Trackpoint:	return (new TrackDataTrackpoint);
+case TrackData::Waypoint:	return (new TrackDataWaypoint);
+case TrackData::Routepoint:	return (new TrackDataRoutepoint);
+default:			return (nullptr);
+    }
+}
+
+
+static QDateTime pointTime(qint64 t)
+{
+    if (t==TrackData::NoTime) return (QDateTime());
+    return (QDateTime::fromMSecsSinceEpoch(t, Qt::UTC));
+}
+
+
+// Read the flags, name and general metadata of an item.  Returns false
+// if the data is not valid.
+
+static bool readHeader(TrackDataItem *item, QDataStream &str, const QVector<int> &indexMap)
+{
+    quint8 flags;
+    str >> flags;
+    if (flags & SnapshotFormat::FlagExplicitName)
+    {
+        QString name;
+        str >> name;
+        item->setName(name, true);
+    }
+
+    quint32 num;
+    str >> num;
+    if (str.status()!=QDataStream::Ok) return (false);
+    for (quint32 i = 0; i<num; ++i)
+    {
+        quint32 idx;
+        QVariant v;
+        str >> idx >> v;
+        if (str.status()!=QDataStream::Ok) return (false);
+        if (idx>=quint32(indexMap.count())) return (false);
+        item->setMetadata(indexMap.at(idx), v);
+    }
+
+    return (true);
+}
+
+
+// Create the points of a block and add them to the container.  The point
+// values are used directly from the column arrays, and the stream must
+// be positioned at the point headers which follow the columns.  Each
+// point is completed before it is added to the container, so that
+// setting its values does not need to invalidate any cached data.
+
+static bool readPointBlock(TrackDataItem *item, int num, quint8 pointType, const char *cols,
+                           QDataStream &str, const QVector<int> &indexMap)
+{
+    const qint64 colSize = qint64(num)*8;		// size of each column
+    const char *lats = cols+colSize*SnapshotFormat::ColumnLatitude;
+    const char *lons = cols+colSize*SnapshotFormat::ColumnLongitude;
+    const char *eles = cols+colSize*SnapshotFormat::ColumnElevation;
+    const char *spds = cols+colSize*SnapshotFormat::ColumnSpeed;
+    const char *hdops = cols+colSize*SnapshotFormat::ColumnHdop;
+    const char *times = cols+colSize*SnapshotFormat::ColumnTime;
+
+    for (int i = 0; i<num; ++i)
+    {
+        TrackDataAbstractPoint *tdp = static_cast<TrackDataAbstractPoint *>(createItem(pointType));
+        tdp->setLatLong(columnValue<double>(lats, i), columnValue<double>(lons, i));
+        tdp->setElevation(columnValue<double>(eles, i));
+        tdp->setSpeed(columnValue<double>(spds, i));
+        tdp->setHdop(columnValue<double>(hdops, i));
+        tdp->setTimeMSecs(columnValue<qint64>(times, i));
+
+        if (!readHeader(tdp, str, indexMap))
+        {
+            delete tdp;
+            return (false);
+        }
+
+        item->addChildItem(tdp);
+    }
+
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  SnapshotPointSource							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+// The source of the points for a deferred segment.  All of the sources
+// for a file share the same open file, which remains open until the last
+// of them is loaded or deleted.  Keeping the file open means that it can
+// still be read even if it has been renamed, which happens when a backup
+// is made on saving.  If it has been changed in any way since it was
+// loaded, then the points cannot be loaded.
+
+class SnapshotPointSource : public DeferredPointSource
+{
+public:
+    SnapshotPointSource(const QSharedPointer<QFile> &file, const QVector<int> &indexMap,
+                        quint8 pointType, int count, qint64 offset, qint64 size);
+    virtual ~SnapshotPointSource() = default;
+
+    bool loadPoints(TrackDataSegment *seg) override;
+
+private:
+    QSharedPointer<QFile> mFile;
+    qint64 mFileSize;
+    QDateTime mFileTime;
+    QVector<int> mIndexMap;				// implicitly shared
+    quint8 mPointType;
+    int mCount;
+    qint64 mOffset;					// start of point block
+    qint64 mSize;					// size of point block
+};
+
+
+SnapshotPointSource::SnapshotPointSource(const QSharedPointer<QFile> &file, const QVector<int> &indexMap,
+                                         quint8 pointType, int count, qint64 offset, qint64 size)
+    : mFile(file),
+      mIndexMap(indexMap),
+      mPointType(pointType),
+      mCount(count),
+      mOffset(offset),
+      mSize(size)
+{
+    mFileSize = file->size();
+    mFileTime = file->fileTime(QFileDevice::FileModificationTime);
+}
+
+
+bool SnapshotPointSource::loadPoints(TrackDataSegment *seg)
+{
+    bool ok = (mFile->size()==mFileSize && mFile->fileTime(QFileDevice::FileModificationTime)==mFileTime);
+    if (!ok) qWarning() << "file" << mFile->fileName() << "has changed";
+
+    uchar *map = (ok ? mFile->map(mOffset, mSize) : nullptr);
+    if (map!=nullptr)
+    {
+        QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(map), mSize);
+        QBuffer buf(&data);
+        buf.open(QIODevice::ReadOnly);
+        QDataStream str(&buf);
+        str.setByteOrder(QDataStream::LittleEndian);
+        str.setVersion(SnapshotFormat::streamVersion);
+
+        buf.seek(qint64(mCount)*8*SnapshotFormat::ColumnCount);
+        ok = readPointBlock(seg, mCount, mPointType, data.constData(), str, mIndexMap);
+        buf.close();
+        mFile->unmap(map);
+    }
+    else ok = false;
+
+    if (!ok)						// could not read points
+    {
+        qWarning() << "cannot load points from" << mFile->fileName();
+        // Replace any that were read with empty points, so that the
+        // segment has the number of points expected.
+        while (seg->childCount()>0) delete seg->takeLastChildItem();
+        for (int i = 0; i<mCount; ++i) seg->addChildItem(createItem(mPointType));
+    }
+
+    return (ok);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  SnapshotImporter							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+SnapshotImporter::SnapshotImporter()
+    : ImporterBase()
+{
+    qDebug();
+    mData = nullptr;
+    mVersion = 0;
+}
+
+
+QString SnapshotImporter::filter()
+{
+    return ("Umbrail snapshot files (*.umbrail)");
+}
+
+
+bool SnapshotImporter::loadFrom(QIODevice *dev)
+{
+    qDebug() << "starting";
+
+    // A local file is mapped into memory, so that the point columns
+    // can be used directly from it.  Anything else, for example a
+    // compressed file, has to be read into memory first.
+    QFile *file = qobject_cast<QFile *>(dev);
+    const qint64 size = (file!=nullptr ? file->size() : 0);
+    if (size>std::numeric_limits<int>::max()) return (setError(i18n("The file is too large to load")));
+    uchar *map = (size>0 ? file->map(0, size) : nullptr);
+
+    QByteArray data;
+    if (map!=nullptr) data = QByteArray::fromRawData(reinterpret_cast<const char *>(map), size);
+    else data = dev->readAll();
+    qDebug() << "mapped?" << (map!=nullptr) << "size" << data.size();
+
+    // The points of large segments need only be loaded from the file
+    // when they are needed, as long as the file will still be there.
+    // The file is opened again, because the device that it is being
+    // read from now will be closed when the load has finished.
+    if (map!=nullptr && !sourcePath().isEmpty())
+    {
+        mSourceFile.reset(new QFile(sourcePath()));
+        if (!mSourceFile->open(QIODevice::ReadOnly)) mSourceFile.reset();
+    }
+
+    QBuffer buf(&data);
+    buf.open(QIODevice::ReadOnly);
+    QDataStream str(&buf);
+    mData = data.constData();
+
+    const bool ok = readFile(str);
+    qDebug() << "done, ok" << ok;
+
+    buf.close();
+    mData = nullptr;
+    mIndexMap.clear();
+    mSourceFile.reset();				// now only used by segments
+    if (map!=nullptr) file->unmap(map);			// finished with file mapping
+    return (ok);
+}
+
+
+bool SnapshotImporter::readFile(QDataStream &str)
+{
+    char magic[SnapshotFormat::magicLength];
+    if (str.readRawData(magic, SnapshotFormat::magicLength)!=SnapshotFormat::magicLength ||
+        memcmp(magic, SnapshotFormat::magic, SnapshotFormat::magicLength)!=0)
+    {
+        return (setError(i18n("The file is not an Umbrail snapshot")));
+    }
+
+    str.setByteOrder(QDataStream::LittleEndian);
+    str.setVersion(SnapshotFormat::streamVersion);
+
+    str >> mVersion;
+    qDebug() << "format version" << mVersion;
+    if (mVersion==0 || mVersion>SnapshotFormat::version)
+    {
+        return (setError(i18n("Unsupported snapshot format version %1", mVersion)));
+    }
+
+    if (!readTables(str)) return (false);
+
+    quint8 type;
+    str >> type;
+    if (type!=TrackData::File) return (setError(i18n("The file does not start with a file item")));
+    if (!readItem(mDataRoot, str, true)) return (false);
+
+    if (str.status()!=QDataStream::Ok) return (setError(i18n("The file is truncated or corrupted")));
+    return (true);
+}
+
+
+bool SnapshotImporter::readTables(QDataStream &str)
+{
+    // The namespace table
+    quint32 num;
+    str >> num;
+    if (!checkCount(num, str)) return (false);
+    for (quint32 i = 0; i<num; ++i)
+    {
+        QByteArray nsp;
+        QByteArray uri;
+        str >> nsp >> uri;
+        DataIndexer::setUriForNamespace(nsp, uri);
+    }
+
+    // The string table
+    str >> num;
+    if (!checkCount(num, str)) return (false);
+    mIndexMap.resize(num);
+    for (quint32 i = 0; i<num; ++i)
+    {
+        QByteArray qnm;
+        str >> qnm;
+        mIndexMap[i] = DataIndexer::indexWithNamespace(qnm);
+    }
+
+    if (str.status()!=QDataStream::Ok) return (setError(i18n("The file is truncated or corrupted")));
+    return (true);
+}
+
+
+// Each item is read completely before it is added to its parent,
+// so that changing its data does not need to invalidate the cached
+// data of all of its parents.
+
+bool SnapshotImporter::readItem(TrackDataItem *item, QDataStream &str, bool topLevel)
+{
+    if (!readHeader(item, str, mIndexMap)) return (setError(i18n("The file is truncated or corrupted")));
+
+    TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item);
+    if (tdp!=nullptr)					// values stored in point
+    {
+        double lat, lon, ele, spd, hdop;
+        qint64 t;
+        str >> lat >> lon >> ele >> spd >> hdop >> t;
+        tdp->setLatLong(lat, lon);
+        tdp->setElevation(ele);
+        tdp->setSpeed(spd);
+        tdp->setHdop(hdop);
+        tdp->setTimeMSecs(t);
+    }
+
+    quint32 num;
+    str >> num;
+    if (!checkCount(num, str)) return (false);
+
+    const TrackData::Type type = item->type();
+    if (type==TrackData::Segment || type==TrackData::Route) return (readPoints(item, num, str));
+
+    for (quint32 i = 0; i<num; ++i)
+    {
+        quint8 childType;
+        str >> childType;
+        TrackDataItem *child = createItem(childType);
+        if (child==nullptr) return (setError(i18n("Unknown item type %1", childType)));
+
+        if (!readItem(child, str))
+        {
+            delete child;
+            return (false);
+        }
+
+        if (topLevel)					// a track, route or folder
+        {
+            addCompletedItem(child);
+            if (!updateProgress(str.device()->pos())) return (setError("Loading cancelled"));
+        }
+        else item->addChildItem(child);
+    }
+
+    return (true);
+}
+
+
+// Read the points of a segment or route.  If the segment is large enough
+// and the file remains available, then only a summary of the points
+// is obtained and they are left to be loaded when they are needed.
+
+bool SnapshotImporter::readPoints(TrackDataItem *item, int num, QDataStream &str)
+{
+    if (num==0) return (true);				// no points to read
+
+    quint8 pointType;
+    str >> pointType;
+    const TrackData::Type expected = (item->type()==TrackData::Segment ? TrackData::Trackpoint : TrackData::Routepoint);
+    if (pointType!=expected) return (setError(i18n("Unexpected point type %1", pointType)));
+
+    qint64 blockSize = -1;				// not known before version 2
+    if (mVersion>=2)
+    {
+        quint64 size;
+        str >> size;
+        blockSize = size;
+    }
+
+    QIODevice *dev = str.device();
+    const qint64 pos = dev->pos();			// start of point block
+    const qint64 colsSize = qint64(num)*8*SnapshotFormat::ColumnCount;
+    if (str.status()!=QDataStream::Ok || pos+colsSize>dev->size() ||
+        (blockSize!=-1 && (blockSize<colsSize || pos+blockSize>dev->size())))
+    {
+        return (setError(i18n("The file is truncated or corrupted")));
+    }
+
+    const char *cols = mData+pos;
+    if (blockSize!=-1 && !mSourceFile.isNull() &&
+        item->type()==TrackData::Segment && num>=SnapshotFormat::deferMinimumPoints)
+    {
+        // The summary is the same as would be calculated from the points,
+        // see TrackDataItem::boundingArea() and TrackDataSegment::timeSpan().
+        const qint64 colSize = qint64(num)*8;
+        const char *lats = cols+colSize*SnapshotFormat::ColumnLatitude;
+        const char *lons = cols+colSize*SnapshotFormat::ColumnLongitude;
+        const char *times = cols+colSize*SnapshotFormat::ColumnTime;
+
+        BoundingArea area;
+        for (int i = 0; i<num; ++i) area = area.united(BoundingArea(columnValue<double>(lats, i), columnValue<double>(lons, i)));
+        const TimeRange span(pointTime(columnValue<qint64>(times, 0)), pointTime(columnValue<qint64>(times, num-1)));
+
+        SnapshotPointSource *source = new SnapshotPointSource(mSourceFile, mIndexMap, pointType, num, pos, blockSize);
+        static_cast<TrackDataSegment *>(item)->setDeferredPoints(source, num, area, span);
+        dev->seek(pos+blockSize);			// skip over the points
+    }
+    else
+    {
+        dev->seek(pos+colsSize);			// to the point headers
+        if (!readPointBlock(item, num, pointType, cols, str, mIndexMap) ||
+            (blockSize!=-1 && dev->pos()!=pos+blockSize))
+        {
+            return (setError(i18n("The file is truncated or corrupted")));
+        }
+    }
+
+    if (!updateProgress(dev->pos())) return (setError("Loading cancelled"));
+    return (true);
+}
+
+
+// A count read from the file cannot be valid if there are not enough
+// bytes remaining for at least one byte per entry.  This guards against
+// a corrupted file causing a huge allocation or a very long loop.
+
+bool SnapshotImporter::checkCount(quint32 num, QDataStream &str)
+{
+    if (str.status()!=QDataStream::Ok) return (setError(i18n("The file is truncated or corrupted")));
+    if (num>(str.device()->size()-str.device()->pos())) return (setError(i18n("The file is truncated or corrupted")));
+    return (true);
+}
+
+
+bool SnapshotImporter::setError(const QString &msg)
+{
+    // Setting a fatal error is necessary so that FilesController::importFile()
+    // will recognise the failure, display the errors and give up.
+    reporter()->setError(ErrorReporter::Fatal, msg);
+    return (false);
+}
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef SNAPSHOTIMPORTER_H
+#define SNAPSHOTIMPORTER_H
+
+#include <qvector.h>
+#include <qsharedpointer.h>
+
+#include "importerbase.h"
+
+class QDataStream;
+class QFile;
+class TrackDataItem;
+
+
+// Loads a file in the binary snapshot format, see SnapshotFormat.
+// If possible the file is memory mapped, so that the point columns
+// can be read directly from it.  The points of large segments in a
+// local file are not loaded until they are needed.
+
+class SnapshotImporter : public ImporterBase
+{
+public:
+    SnapshotImporter();
+    virtual ~SnapshotImporter() = default;
+
+    static QString filter();
+
+    // ImporterBase
+    bool loadFrom(QIODevice *dev) override;
+
+private:
+    bool readFile(QDataStream &str);
+    bool readTables(QDataStream &str);
+    bool readItem(TrackDataItem *item, QDataStream &str, bool topLevel = false);
+    bool readPoints(TrackDataItem *item, int num, QDataStream &str);
+
+    bool checkCount(quint32 num, QDataStream &str);
+    bool setError(const QString &msg);
+
+private:
+    const char *mData;					// start of file data
+    quint32 mVersion;					// format version of file
+    QVector<int> mIndexMap;				// file to DataIndexer index
+    QSharedPointer<QFile> mSourceFile;			// for deferred points
+};
+
+#endif							// SNAPSHOTIMPORTER_H
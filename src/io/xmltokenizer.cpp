@@ -0,0 +1,725 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#undef DEBUG_TOKENIZER
+
+#include "xmltokenizer.h"
+
+#include <qdebug.h>
+
+
+static inline bool isSpace(char c)
+{
+    return (c==' ' || c=='\t' || c=='\n' || c=='\r');
+}
+
+
+static inline bool isNameEnd(char c)
+{
+    return (isSpace(c) || c=='>' || c=='/' || c=='=' || c=='?');
+}
+
+
+static inline bool startsWith(const char *p, const char *end, const char *str, int len)
+{
+    return ((end-p)>=len && memcmp(p, str, len)==0);
+}
+
+
+// Find the value of a pseudo-attribute, such as "version" or "encoding",
+// within the XML declaration.
+
+static ByteView declarationValue(const char *p, const char *end, const char *key)
+{
+    const int len = strlen(key);
+    while (p<end)
+    {
+        p = static_cast<const char *>(memchr(p, key[0], end-p));
+        if (p==nullptr) break;
+
+        if (startsWith(p, end, key, len))
+        {
+            const char *q = p+len;
+            while (q<end && isSpace(*q)) ++q;
+            if (q<end && *q=='=')
+            {
+                ++q;
+                while (q<end && isSpace(*q)) ++q;
+                if (q<end && (*q=='"' || *q=='\''))
+                {
+                    const char quote = *q++;
+                    const char *val = q;
+                    while (q<end && *q!=quote) ++q;
+                    if (q<end) return (ByteView(val, q-val));
+                }
+            }
+        }
+        ++p;
+    }
+
+    return (ByteView());
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  ByteView								//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+ByteView ByteView::trimmed() const
+{
+    int start = 0;
+    int end = mSize;
+    while (start<end && isSpace(mData[start])) ++start;
+    while (end>start && isSpace(mData[end-1])) --end;
+    return (ByteView(mData+start, end-start));
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  XmlTokenizer							//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+XmlTokenizer::XmlTokenizer(const char *data, qint64 size)
+    : mData(data),
+      mEnd(data+size),
+      mPos(data),
+      mTokenType(NoToken),
+      mAtEnd(false),
+      mSeenRoot(false),
+      mPendingEnd(false),
+      mTextIsCData(false),
+      mLinePos(data),
+      mLineCount(1)
+{
+    if (startsWith(mPos, mEnd, "\xEF\xBB\xBF", 3)) mPos += 3;
+}
+
+
+bool XmlTokenizer::canRead(const char *data, qint64 size)
+{
+    if (size<2) return (false);
+    const char *p = data;
+    const char *end = data+size;
+
+    if (startsWith(p, end, "\xEF\xBB\xBF", 3)) p += 3;	// UTF-8 byte order mark
+    else if (p[0]=='\0' || p[1]=='\0') return (false);	// UTF-16 or UTF-32
+    else if (uchar(p[0])==0xFE || uchar(p[0])==0xFF) return (false);
+
+    // Look through the prolog, up to the start of the root element,
+    // for the XML declaration and any document type declaration.
+    while (p<end)
+    {
+        p = static_cast<const char *>(memchr(p, '<', end-p));
+        if (p==nullptr) return (false);			// no root element
+
+        if (startsWith(p, end, "<?xml", 5) && (end-p)>5 && isSpace(p[5]))
+        {
+            const char *declEnd = p;
+            while (declEnd<end && !startsWith(declEnd, end, "?>", 2)) ++declEnd;
+
+            const ByteView enc = declarationValue(p+5, declEnd, "encoding");
+            if (!enc.isNull())
+            {
+                const QByteArray encoding = enc.toByteArray().toLower();
+                if (encoding!="utf-8" && encoding!="utf8" &&
+                    encoding!="us-ascii" && encoding!="ascii")
+                {
+                    qDebug() << "cannot read encoding" << encoding;
+                    return (false);
+                }
+            }
+            p = declEnd;
+        }
+        else if (startsWith(p, end, "<?", 2))		// processing instruction
+        {
+            ++p;
+        }
+        else if (startsWith(p, end, "<!--", 4))		// comment
+        {
+            p += 4;
+            while (p<end && !startsWith(p, end, "-->", 3)) ++p;
+        }
+        else if (startsWith(p, end, "<!", 2))		// DOCTYPE or similar
+        {
+            qDebug() << "cannot read document type declaration";
+            return (false);
+        }
+        else return (true);				// start of root element
+    }
+
+    return (false);
+}
+
+
+void XmlTokenizer::raiseError(const QString &msg)
+{
+#ifdef DEBUG_TOKENIZER
+    qDebug() << msg << "at line" << lineNumber();
+#endif
+    mErrorString = (msg.isEmpty() ? QString("XML parsing failed") : msg);
+    mTokenType = Invalid;
+    mAtEnd = true;
+}
+
+
+qint64 XmlTokenizer::lineNumber() const
+{
+    // Newlines are counted incrementally from the last time that
+    // this was called, since the position only ever moves forwards.
+    while (mLinePos<mPos)
+    {
+        const char *nl = static_cast<const char *>(memchr(mLinePos, '\n', mPos-mLinePos));
+        if (nl==nullptr)
+        {
+            mLinePos = mPos;
+            break;
+        }
+
+        ++mLineCount;
+        mLinePos = nl+1;
+    }
+
+    return (mLineCount);
+}
+
+
+QByteArray XmlTokenizer::namespaceUri() const
+{
+    if (mPrefix.isEmpty()) return (QByteArray());
+    return (mNamespaces.value(QByteArray::fromRawData(mPrefix.data(), mPrefix.size())));
+}
+
+
+ByteView XmlTokenizer::attribute(const char *name)
+{
+    for (const Attribute &att : qAsConst(mAttributes))
+    {
+        if (att.name!=name) continue;
+        if (memchr(att.value.data(), '&', att.value.size())==nullptr) return (att.value);
+
+        mDecodeBuffer.resize(0);
+        if (!decode(att.value, &mDecodeBuffer)) return (ByteView());
+        return (ByteView(mDecodeBuffer));
+    }
+
+    return (ByteView());				// attribute not present
+}
+
+
+ByteView XmlTokenizer::text()
+{
+    if (mTextIsCData || memchr(mText.data(), '&', mText.size())==nullptr) return (mText);
+
+    mDecodeBuffer.resize(0);
+    if (!decode(mText, &mDecodeBuffer)) return (ByteView());
+    return (ByteView(mDecodeBuffer));
+}
+
+
+bool XmlTokenizer::isWhitespace() const
+{
+    if (mTextIsCData) return (false);
+
+    const char *p = mText.data();
+    const char *end = p+mText.size();
+    while (p<end)
+    {
+        if (!isSpace(*p)) return (false);
+        ++p;
+    }
+
+    return (true);
+}
+
+
+void XmlTokenizer::skipSpace()
+{
+    while (mPos<mEnd && isSpace(*mPos)) ++mPos;
+}
+
+
+// Advance to just past the next occurrence of the string.  If it is
+// not found, then the position is left at the end of the buffer.
+
+bool XmlTokenizer::skipPast(const char *str, int len)
+{
+    const char *p = mPos;
+    while (p<mEnd)
+    {
+        p = static_cast<const char *>(memchr(p, str[0], mEnd-p));
+        if (p==nullptr) break;
+        if (startsWith(p, mEnd, str, len))
+        {
+            mPos = p+len;
+            return (true);
+        }
+        ++p;
+    }
+
+    mPos = mEnd;
+    return (false);
+}
+
+
+ByteView XmlTokenizer::readName()
+{
+    const char *start = mPos;
+    while (mPos<mEnd && !isNameEnd(*mPos)) ++mPos;
+    return (ByteView(start, mPos-start));
+}
+
+
+void XmlTokenizer::setElementName(const ByteView &qName)
+{
+    mQualifiedName = qName;
+
+    const char *colon = static_cast<const char *>(memchr(qName.data(), ':', qName.size()));
+    if (colon!=nullptr)
+    {
+        mPrefix = ByteView(qName.data(), colon-qName.data());
+        mName = ByteView(colon+1, qName.size()-mPrefix.size()-1);
+    }
+    else
+    {
+        mPrefix = ByteView(qName.data(), 0);
+        mName = qName;
+    }
+}
+
+
+// Append the resolved value of some raw text to the result.  The
+// only entities recognised are the predefined ones and numeric
+// character references.
+
+bool XmlTokenizer::decode(const ByteView &raw, QByteArray *result)
+{
+    const char *p = raw.data();
+    const char *end = p+raw.size();
+
+    while (p<end)
+    {
+        const char *amp = static_cast<const char *>(memchr(p, '&', end-p));
+        if (amp==nullptr)				// no more references
+        {
+            result->append(p, end-p);
+            break;
+        }
+
+        result->append(p, amp-p);
+        const char *semi = static_cast<const char *>(memchr(amp, ';', end-amp));
+        if (semi==nullptr)
+        {
+            raiseError("Unterminated entity reference.");
+            return (false);
+        }
+
+        const ByteView ent(amp+1, semi-amp-1);
+        if (ent=="lt") result->append('<');
+        else if (ent=="gt") result->append('>');
+        else if (ent=="amp") result->append('&');
+        else if (ent=="quot") result->append('"');
+        else if (ent=="apos") result->append('\'');
+        else if (ent.size()>1 && ent.at(0)=='#')	// character reference
+        {
+            bool ok;
+            uint code;
+            if (ent.at(1)=='x') code = QByteArray(ent.data()+2, ent.size()-2).toUInt(&ok, 16);
+            else code = QByteArray(ent.data()+1, ent.size()-1).toUInt(&ok, 10);
+            if (!ok || code==0 || code>0x10FFFF)
+            {
+                raiseError("Invalid character reference.");
+                return (false);
+            }
+
+            result->append(QString::fromUcs4(&code, 1).toUtf8());
+        }
+        else
+        {
+            raiseError(QString("Entity '%1' not declared.").arg(ent.toString()));
+            return (false);
+        }
+
+        p = semi+1;
+    }
+
+    return (true);
+}
+
+
+// Append the current character data token to the result.
+
+bool XmlTokenizer::appendText(QByteArray *result)
+{
+    if (!mTextIsCData) return (decode(mText, result));
+
+    result->append(mText.data(), mText.size());
+    return (true);
+}
+
+
+bool XmlTokenizer::readXmlDeclaration()
+{
+    const char *start = mPos+5;				// past the "<?xml"
+    if (!skipPast("?>", 2))
+    {
+        raiseError("Premature end of document.");
+        return (false);
+    }
+
+    mDocumentVersion = declarationValue(start, mPos-2, "version");
+    mDocumentEncoding = declarationValue(start, mPos-2, "encoding");
+    return (true);
+}
+
+
+bool XmlTokenizer::readStartTag()
+{
+    if (mSeenRoot && mElementStack.isEmpty())
+    {
+        raiseError("Extra content at end of document.");
+        return (false);
+    }
+
+    ++mPos;						// past the '<'
+    const ByteView qName = readName();
+    if (qName.isEmpty())
+    {
+        raiseError("Invalid element name.");
+        return (false);
+    }
+
+    setElementName(qName);
+    mAttributes.clear();				// capacity is retained
+
+    for (;;)						// read the attributes
+    {
+        skipSpace();
+        if (mPos>=mEnd)
+        {
+            raiseError("Premature end of document.");
+            return (false);
+        }
+
+        if (*mPos=='>')					// end of start tag
+        {
+            ++mPos;
+            break;
+        }
+
+        if (*mPos=='/')					// empty element tag
+        {
+            if (startsWith(mPos, mEnd, "/>", 2))
+            {
+                mPos += 2;
+                mPendingEnd = true;			// report end element next
+                break;
+            }
+
+            raiseError("Expected '>'.");
+            return (false);
+        }
+
+        const ByteView attName = readName();
+        skipSpace();
+        if (attName.isEmpty() || mPos>=mEnd || *mPos!='=')
+        {
+            raiseError("Expected '='.");
+            return (false);
+        }
+
+        ++mPos;						// past the '='
+        skipSpace();
+        if (mPos>=mEnd || (*mPos!='"' && *mPos!='\''))
+        {
+            raiseError("Expected quoted attribute value.");
+            return (false);
+        }
+
+        const char quote = *mPos++;
+        const char *val = mPos;
+        const char *q = static_cast<const char *>(memchr(mPos, quote, mEnd-mPos));
+        if (q==nullptr)
+        {
+            raiseError("Premature end of document.");
+            return (false);
+        }
+
+        mPos = q+1;
+        const ByteView attValue(val, q-val);
+
+        if (attName.size()>6 && memcmp(attName.data(), "xmlns:", 6)==0)
+        {						// namespace declaration
+            QByteArray uri;
+            if (!decode(attValue, &uri)) return (false);
+            mNamespaces.insert(QByteArray(attName.data()+6, attName.size()-6), uri);
+        }
+
+        mAttributes.append({ attName, attValue });
+    }
+
+    mElementStack.append(qName);
+    mSeenRoot = true;
+    mTokenType = StartElement;
+    return (true);
+}
+
+
+bool XmlTokenizer::readEndTag()
+{
+    mPos += 2;						// past the "</"
+    const ByteView qName = readName();
+    skipSpace();
+    if (mPos>=mEnd || *mPos!='>')
+    {
+        raiseError("Expected '>'.");
+        return (false);
+    }
+
+    ++mPos;						// past the '>'
+    if (mElementStack.isEmpty() || mElementStack.last()!=qName)
+    {
+        raiseError("Opening and ending tag mismatch.");
+        return (false);
+    }
+
+    mElementStack.removeLast();
+    setElementName(qName);
+    mAttributes.clear();
+    mTokenType = EndElement;
+    return (true);
+}
+
+
+bool XmlTokenizer::readMarkup()
+{
+    if (startsWith(mPos, mEnd, "<?", 2))		// processing instruction
+    {
+        mPos += 2;
+        if (!skipPast("?>", 2))
+        {
+            raiseError("Premature end of document.");
+            return (false);
+        }
+
+        mTokenType = ProcessingInstruction;
+    }
+    else if (startsWith(mPos, mEnd, "<!--", 4))		// comment
+    {
+        mPos += 4;
+        if (!skipPast("-->", 3))
+        {
+            raiseError("Premature end of document.");
+            return (false);
+        }
+
+        mTokenType = Comment;
+    }
+    else if (startsWith(mPos, mEnd, "<![CDATA[", 9))	// CDATA section
+    {
+        if (mElementStack.isEmpty())
+        {
+            raiseError("CDATA section outside of element.");
+            return (false);
+        }
+
+        mPos += 9;
+        const char *start = mPos;
+        if (!skipPast("]]>", 3))
+        {
+            raiseError("Premature end of document.");
+            return (false);
+        }
+
+        mText = ByteView(start, mPos-3-start);
+        mTextIsCData = true;
+        mTokenType = Characters;
+    }
+    else						// DOCTYPE or other declaration
+    {
+        raiseError("Unsupported markup declaration.");
+        return (false);
+    }
+
+    return (true);
+}
+
+
+XmlTokenizer::TokenType XmlTokenizer::readNext()
+{
+    if (mAtEnd) return (mTokenType);			// nothing more to read
+
+    mText = ByteView();
+    mTextIsCData = false;
+
+    if (mTokenType==NoToken)				// start of document
+    {
+        if (startsWith(mPos, mEnd, "<?xml", 5) && (mEnd-mPos)>5 && isSpace(mPos[5]))
+        {
+            if (!readXmlDeclaration()) return (mTokenType);
+        }
+
+        mTokenType = StartDocument;
+        return (mTokenType);
+    }
+
+    if (mPendingEnd)					// after an empty element tag
+    {
+        mPendingEnd = false;
+        mElementStack.removeLast();
+        mAttributes.clear();
+        mTokenType = EndElement;
+        return (mTokenType);
+    }
+
+    for (;;)						// until a token is found
+    {
+        if (mPos>=mEnd)					// end of the buffer
+        {
+            if (!mSeenRoot || !mElementStack.isEmpty()) raiseError("Premature end of document.");
+            else
+            {
+                mTokenType = EndDocument;
+                mAtEnd = true;
+            }
+            return (mTokenType);
+        }
+
+        if (*mPos!='<')					// character data
+        {
+            const char *start = mPos;
+            const char *lt = static_cast<const char *>(memchr(mPos, '<', mEnd-mPos));
+            mPos = (lt!=nullptr ? lt : mEnd);
+            mText = ByteView(start, mPos-start);
+
+            // Whitespace outside the root element is not reported.
+            if (!mElementStack.isEmpty())
+            {
+                mTokenType = Characters;
+                return (mTokenType);
+            }
+
+            if (!isWhitespace())
+            {
+                raiseError("Start tag expected.");
+                return (mTokenType);
+            }
+
+            mText = ByteView();
+            continue;
+        }
+
+        if ((mEnd-mPos)<2)
+        {
+            raiseError("Premature end of document.");
+            return (mTokenType);
+        }
+
+        const char c = mPos[1];
+        if (c=='/') readEndTag();
+        else if (c=='!' || c=='?') readMarkup();
+        else readStartTag();
+
+#ifdef DEBUG_TOKENIZER
+        qDebug() << "token" << mTokenType << "name" << mQualifiedName.toString();
+#endif
+        return (mTokenType);
+    }
+}
+
+
+ByteView XmlTokenizer::readElementText()
+{
+    if (mTokenType!=StartElement) return (ByteView());
+
+    ByteView first;					// first run of character data
+    bool firstCData = false;
+    int pieces = 0;
+
+    for (;;)
+    {
+        switch (readNext())
+        {
+case Characters:
+            if (pieces==0)				// note the first one,
+            {						// in case it is the only one
+                first = mText;
+                firstCData = mTextIsCData;
+            }
+            else					// collect in the buffer
+            {
+                if (pieces==1)
+                {
+                    mTextBuffer.resize(0);
+                    if (firstCData) mTextBuffer.append(first.data(), first.size());
+                    else if (!decode(first, &mTextBuffer)) return (ByteView());
+                }
+                if (!appendText(&mTextBuffer)) return (ByteView());
+            }
+            ++pieces;
+            break;
+
+case Comment:
+case ProcessingInstruction:
+            break;
+
+case EndElement:
+            if (pieces==0) return (ByteView(mPos, 0));	// empty but not null
+            if (pieces>1) return (ByteView(mTextBuffer));
+
+            // The usual case, a single run of character data.  It can
+            // be returned directly if it does not need to be decoded.
+            if (firstCData || memchr(first.data(), '&', first.size())==nullptr) return (first);
+            mTextBuffer.resize(0);
+            if (!decode(first, &mTextBuffer)) return (ByteView());
+            return (ByteView(mTextBuffer));
+
+case StartElement:
+            raiseError("Expected character data.");
+            return (ByteView());
+
+default:						// error or end of document
+            return (ByteView());
+        }
+    }
+}
+
+
+void XmlTokenizer::skipCurrentElement()
+{
+    int depth = 1;
+    while (depth>0 && !mAtEnd)
+    {
+        switch (readNext())
+        {
+case StartElement:  ++depth;  break;
+case EndElement:    --depth;  break;
+default:                      break;
+        }
+    }
+}
@@ -0,0 +1,325 @@
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Project:	Umbrail - GPX track viewer and editor			//
+//									//
+//////////////////////////////////////////////////////////////////////////
+//									//
+//  Copyright (c) 2022 Jonathan Marten <jjm@keelhaul.me.uk>		//
+//  Home and download page: <http://github.com/martenjj/umbrail>	//
+//									//
+//  This program is free software; you can redistribute it and/or	//
+//  modify it under the terms of the GNU General Public License as	//
+//  published by the Free Software Foundation, either version 3 of	//
+//  the License or (at your option) any later version.			//
+//									//
+//  It is distributed in the hope that it will be useful, but		//
+//  WITHOUT ANY WARRANTY;  without even the implied warranty of		//
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the	//
+//  GNU General Public License for more details.			//
+//									//
+//  You should have received a copy of the GNU General Public License	//
+//  along with this program;  see the file COPYING for further		//
+//  details.  If not, see <http://gnu.org/licenses/gpl>.      		//
+//									//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef XMLTOKENIZER_H
+#define XMLTOKENIZER_H
+
+#include <string.h>
+
+#include <qbytearray.h>
+#include <qstring.h>
+#include <qvector.h>
+#include <qhash.h>
+
+
+/**
+ * @short A non-owning view of a sequence of bytes.
+ *
+ * This refers to bytes held elsewhere, normally within the buffer
+ * being parsed by an XmlTokenizer, so that the names and values of
+ * XML elements can be examined without copying them.  The view is only
+ * valid for as long as the referenced bytes are.
+ *
+ * @author Jonathan Marten
+ **/
+
+class ByteView
+{
+public:
+    ByteView() : mData(nullptr), mSize(0)		{}
+    ByteView(const char *data, int size) : mData(data), mSize(size) {}
+    explicit ByteView(const QByteArray &ba) : mData(ba.constData()), mSize(ba.size()) {}
+
+    const char *data() const				{ return (mData); }
+    int size() const					{ return (mSize); }
+    bool isNull() const					{ return (mData==nullptr); }
+    bool isEmpty() const				{ return (mSize==0); }
+    char at(int i) const				{ return (mData[i]); }
+
+    bool operator==(const char *s) const		{ return (size_t(mSize)==strlen(s) && memcmp(mData, s, mSize)==0); }
+    bool operator!=(const char *s) const		{ return (!operator==(s)); }
+    bool operator==(const ByteView &v) const		{ return (v.mSize==mSize && memcmp(mData, v.mData, mSize)==0); }
+    bool operator!=(const ByteView &v) const		{ return (!operator==(v)); }
+
+    /**
+     * Get the view with any leading and trailing whitespace removed.
+     *
+     * @return the trimmed view
+     **/
+    ByteView trimmed() const;
+
+    QByteArray toByteArray() const			{ return (QByteArray(mData, mSize)); }
+    QString toString() const				{ return (QString::fromUtf8(mData, mSize)); }
+
+private:
+    const char *mData;
+    int mSize;
+};
+
+
+/**
+ * @short A minimal XML tokenizer working in place on a UTF-8 buffer.
+ *
+ * This reads XML from a buffer in memory, normally a memory-mapped file,
+ * and reports the same token sequence as QXmlStreamReader does for the
+ * subset of XML that is used by GPX files.  Element names, attribute
+ * values and character data are returned as ByteView's referring directly
+ * into the buffer, so that nothing needs to be copied or converted unless
+ * the caller wants to keep it.
+ *
+ * The buffer must be encoded in UTF-8 (or its subset ASCII) and must
+ * not contain a document type declaration, because no entities other
+ * than the predefined and numeric character references are supported.
+ * Use canRead() to check whether a buffer is suitable;  if it is not,
+ * then QXmlStreamReader must be used instead.
+ *
+ * Namespace processing is limited to recording the prefixes declared
+ * by "xmlns:" attributes so that namespaceUri() can report them.  An
+ * undefined prefix is not an error.
+ *
+ * @author Jonathan Marten
+ **/
+
+class XmlTokenizer
+{
+public:
+    /**
+     * Token types.  These correspond to the equivalent
+     * QXmlStreamReader::TokenType values.
+     **/
+    enum TokenType
+    {
+        NoToken,					///< Nothing read yet
+        Invalid,					///< An error has occurred
+        StartDocument,					///< Start of the document
+        EndDocument,					///< End of the document
+        StartElement,					///< Start of an element
+        EndElement,					///< End of an element
+        Characters,					///< Character data or CDATA
+        Comment,					///< A comment
+        DTD,						///< A document type declaration
+        ProcessingInstruction				///< A processing instruction
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param data The buffer to be parsed
+     * @param size The size of the buffer
+     *
+     * @note The buffer is not copied, and must remain valid for as
+     * long as the tokenizer or any of the ByteView's returned by it
+     * are in use.
+     **/
+    XmlTokenizer(const char *data, qint64 size);
+
+    /**
+     * Destructor.
+     **/
+    ~XmlTokenizer() = default;
+
+    /**
+     * Check whether a buffer can be parsed by the tokenizer.
+     *
+     * @param data The buffer to be parsed
+     * @param size The size of the buffer
+     * @return @c true if the buffer is UTF-8 or ASCII and has no
+     * document type declaration
+     **/
+    static bool canRead(const char *data, qint64 size);
+
+    /**
+     * Read the next token.
+     *
+     * @return the token type
+     **/
+    TokenType readNext();
+
+    TokenType tokenType() const				{ return (mTokenType); }
+    bool atEnd() const					{ return (mAtEnd); }
+    bool isStartElement() const				{ return (mTokenType==StartElement); }
+    bool hasError() const				{ return (!mErrorString.isNull()); }
+    const QString &errorString() const			{ return (mErrorString); }
+
+    /**
+     * Stop parsing with an error.  No further tokens will be read.
+     *
+     * @param msg The error message
+     **/
+    void raiseError(const QString &msg);
+
+    /**
+     * Get the line number of the current token.
+     *
+     * @return the line number, starting at 1
+     **/
+    qint64 lineNumber() const;
+
+    /**
+     * Get the current position within the buffer.
+     *
+     * @return the number of bytes read so far
+     **/
+    qint64 position() const				{ return (mPos-mData); }
+
+    /**
+     * The local name of the current element, without any namespace prefix.
+     **/
+    ByteView name() const				{ return (mName); }
+
+    /**
+     * The qualified name of the current element, including any
+     * namespace prefix.
+     **/
+    ByteView qualifiedName() const			{ return (mQualifiedName); }
+
+    /**
+     * The namespace prefix of the current element, empty if there is none.
+     **/
+    ByteView prefix() const				{ return (mPrefix); }
+
+    /**
+     * The namespace URI declared for the prefix of the current element.
+     *
+     * @return the URI, or a null byte array if the element has no
+     * prefix or the prefix is not declared
+     **/
+    QByteArray namespaceUri() const;
+
+    /**
+     * Get the value of an attribute of the current element.  Any entity
+     * or character references within the value are resolved.
+     *
+     * @param name The qualified name of the attribute
+     * @return the attribute value, or a null view if the element does
+     * not have the attribute.
+     *
+     * @note If the value needed to be decoded then the view refers to
+     * an internal buffer, and is only valid until the next call.
+     **/
+    ByteView attribute(const char *name);
+
+    /**
+     * The raw text of the current character data or CDATA token.  Entity
+     * and character references are not resolved;  use text() for that.
+     **/
+    ByteView rawText() const				{ return (mText); }
+
+    /**
+     * The text of the current character data or CDATA token, with any
+     * entity and character references resolved.
+     *
+     * @note If the value needed to be decoded then the view refers to
+     * an internal buffer, and is only valid until the next call.
+     **/
+    ByteView text();
+
+    /**
+     * Whether the current character data token consists only of whitespace.
+     **/
+    bool isWhitespace() const;
+
+    /**
+     * The XML version from the XML declaration, if there was one.
+     **/
+    ByteView documentVersion() const			{ return (mDocumentVersion); }
+
+    /**
+     * The encoding from the XML declaration, if there was one.
+     **/
+    ByteView documentEncoding() const			{ return (mDocumentEncoding); }
+
+    /**
+     * Read the text contained within the current element.  This is
+     * the equivalent of QXmlStreamReader::readElementText() with the
+     * default option @c ErrorOnUnexpectedElement.  The current token
+     * must be a StartElement, and the tokenizer is left at the
+     * corresponding EndElement.
+     *
+     * @return the text of the element.  If it was a single run of
+     * character data without any references, as it normally will be,
+     * then the view refers directly to the buffer being parsed.
+     * Otherwise it refers to an internal buffer, and is only valid
+     * until the next call.
+     **/
+    ByteView readElementText();
+
+    /**
+     * Skip the remainder of the current element, including any nested
+     * elements.  The current token must be a StartElement, and the
+     * tokenizer is left at the corresponding EndElement.
+     **/
+    void skipCurrentElement();
+
+private:
+    struct Attribute
+    {
+        ByteView name;
+        ByteView value;
+    };
+
+    void setElementName(const ByteView &qName);
+    bool skipPast(const char *str, int len);
+    void skipSpace();
+    ByteView readName();
+    bool readStartTag();
+    bool readEndTag();
+    bool readMarkup();
+    bool readXmlDeclaration();
+    bool decode(const ByteView &raw, QByteArray *result);
+    bool appendText(QByteArray *result);
+
+private:
+    const char *mData;
+    const char *mEnd;
+    const char *mPos;
+
+    TokenType mTokenType;
+    bool mAtEnd;
+    bool mSeenRoot;
+    bool mPendingEnd;
+    QString mErrorString;
+
+    ByteView mName;
+    ByteView mQualifiedName;
+    ByteView mPrefix;
+    QVector<Attribute> mAttributes;
+    QVector<ByteView> mElementStack;
+
+    ByteView mText;
+    bool mTextIsCData;
+
+    ByteView mDocumentVersion;
+    ByteView mDocumentEncoding;
+
+    QHash<QByteArray,QByteArray> mNamespaces;
+    QByteArray mDecodeBuffer;
+    QByteArray mTextBuffer;
+
+    mutable const char *mLinePos;
+    mutable qint64 mLineCount;
+};
+
+#endif							// XMLTOKENIZER_H
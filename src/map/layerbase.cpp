@@ -36,8 +36,11 @@
 
 #include <marble/GeoPainter.h>
 #include <marble/GeoDataPlacemark.h>
+#include <marble/GeoDataLatLonAltBox.h>
+#include <marble/ViewportParams.h>
 
 #include "filesmodel.h"
+#include "pointindex.h"
 #include "filesview.h"
 #include "mapcontroller.h"
 #include "mapview.h"
@@ -169,6 +172,11 @@ void LayerBase::paintDataTree(const TrackDataItem *item, GeoPainter *painter,
 {
     if (item==nullptr) return;				// nothing to paint
 
+    // Nothing within the item can be visible if its bounding area is not
+    // within the map view.  Not painting it saves the time taken, and also
+    // means that any deferred points within it do not need to be loaded.
+    if (!isInView(item)) return;
+
     bool isSelected = parentSelected || (item->selectionId()==mSelectionId);
 #ifdef DEBUG_PAINTING
     qDebug() << className(this).constData() << item->name() << "isselected" << isSelected << "doselected" << doSelected;
@@ -201,41 +209,50 @@ void LayerBase::paintDataTree(const TrackDataItem *item, GeoPainter *painter,
 
 
 
-const TrackDataAbstractPoint *LayerBase::findClickedPoint(const TrackDataItem *item)
+bool LayerBase::isInView(const TrackDataItem *item) const
 {
-    if (item==nullptr) return (nullptr);		// nothing to do
+    if (mViewport==nullptr) return (true);		// no view to check against
+    const BoundingArea area = item->boundingArea();
+    if (!area.isValid()) return (true);			// cannot tell, so assume so
+
+    const GeoDataLatLonAltBox &box = mViewport->viewLatLonAltBox();
+    if (area.south()>box.north(GeoDataCoordinates::Degree)) return (false);
+    if (area.north()<box.south(GeoDataCoordinates::Degree)) return (false);
+    if (box.crossesDateLine()) return (true);		// not worth checking further
+    if (area.west()>box.east(GeoDataCoordinates::Degree)) return (false);
+    if (area.east()<box.west(GeoDataCoordinates::Degree)) return (false);
+    return (true);
+}
 
-    if (this->isApplicableItem(item))			// consider this item itself?
-    {
-        const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(item);
-        if (tdp!=nullptr)				// applicable type of point
-        {
-            const double lat = tdp->latitude();
-            const double lon = tdp->longitude();
-            if (lat>=mLatMin && lat<=mLatMax &&
-                lon>=mLonMin && lon<=mLonMax)
-            {						// check within tolerance
-#ifdef DEBUG_SELECTING
-                qDebug() << className(this).constData() << "found point" << tdp->name();
-#endif
-                return (tdp);				// clicked point found
-            }
-        }
 
-        return (nullptr);				// applicable but not clicked
-    }
 
-    if (this->isIndirectContainer(item))		// can contain applicable items?
+const TrackDataAbstractPoint *LayerBase::findClickedPoint(const FilesModel *model) const
+{
+    // Find all of the points within the click tolerance box, and
+    // choose the applicable one closest to the centre of the box.
+    const QVector<const TrackDataAbstractPoint *> points = model->pointIndex()->pointsWithin(mLatMin, mLonMin,
+                                                                                              mLatMax, mLonMax);
+    const double lat = (mLatMin+mLatMax)/2;
+    const double lon = (mLonMin+mLonMax)/2;
+
+    const TrackDataAbstractPoint *result = nullptr;
+    double closestDist = 0.0;
+    for (const TrackDataAbstractPoint *tdp : points)
     {
-        for (int i = 0; i<item->childCount(); ++i)	// recurse to search children
+        if (!this->isApplicableItem(tdp)) continue;	// not for this layer
+
+        const double dist = tdp->distanceTo(lat, lon);
+        if (result==nullptr || dist<closestDist)	// closest so far?
         {
-            const TrackDataItem *childItem = item->childAt(i);
-            const TrackDataAbstractPoint *childPoint = findClickedPoint(childItem);
-            if (childPoint!=nullptr) return (childPoint);
-        }						// this point found
-     }
+            result = tdp;
+            closestDist = dist;
+        }
+    }
 
-    return (nullptr);					// nothing found
+#ifdef DEBUG_SELECTING
+    if (result!=nullptr) qDebug() << className(this).constData() << "found point" << result->name();
+#endif
+    return (result);					// clicked point, if any
 }
 
 
@@ -253,6 +270,8 @@ bool LayerBase::testClickTolerance(const QMouseEvent *mev) const
 void LayerBase::findSelectionInTree(const TrackDataItem *item)
 {
     if (item==nullptr) return;				// nothing to search
+    // Points which have not been loaded cannot be selected
+    if (item->hasDeferredChildren()) return;
     int cnt = item->childCount();
 
     if (this->isDirectContainer(item))			// look at contained items?
@@ -266,7 +285,7 @@ void LayerBase::findSelectionInTree(const TrackDataItem *item)
         SelectionRun run;
         for (int i = 0; i<cnt; ++i)
         {
-            const TrackDataAbstractPoint *tdp = dynamic_cast<const TrackDataAbstractPoint *>(item->childAt(i));
+            const TrackDataAbstractPoint *tdp = TrackData::cast<TrackDataAbstractPoint>(item->childAt(i));
             if (tdp==nullptr) continue;
 
 #ifdef DEBUG_SELECTING
@@ -281,7 +300,7 @@ void LayerBase::findSelectionInTree(const TrackDataItem *item)
 #endif
                     if (i>0)				// not first point in container
                     {
-                        const TrackDataAbstractPoint *prev = dynamic_cast<const TrackDataAbstractPoint *>(item->childAt(i-1));
+                        const TrackDataAbstractPoint *prev = TrackData::cast<TrackDataAbstractPoint>(item->childAt(i-1));
                         if (prev!=nullptr)
                         {
 #ifdef DEBUG_SELECTING
@@ -391,7 +410,7 @@ bool LayerBase::eventFilter(QObject *obj, QEvent *ev)
 #ifdef DEBUG_DRAGGING
         qDebug() << "  tolerance box" << mLatMin << mLonMin << "-" << mLatMax << mLonMax;
 #endif
-        const TrackDataAbstractPoint *tdp = findClickedPoint(filesModel->rootFileItem());
+        const TrackDataAbstractPoint *tdp = findClickedPoint(filesModel);
         if (tdp!=nullptr)				// a point was found
         {
             mClickedPoint = tdp;			// record for release event
@@ -453,7 +472,7 @@ bool LayerBase::eventFilter(QObject *obj, QEvent *ev)
 #endif
                 mClickTimer->invalidate();
 
-                const TrackDataAbstractPoint *tdp = findClickedPoint(filesModel->rootFileItem());
+                const TrackDataAbstractPoint *tdp = findClickedPoint(filesModel);
                 if (tdp!=nullptr && tdp->selectionId()!=mSelectionId)
                 {
 #ifdef DEBUG_DRAGGING
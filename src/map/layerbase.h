@@ -39,6 +39,7 @@ class QElapsedTimer;
 class QPainter;
 class TrackDataItem;
 class TrackDataAbstractPoint;
+class FilesModel;
 class MapView;
 
 
@@ -110,7 +111,8 @@ protected:
 
 private:
     void paintDataTree(const TrackDataItem *item, GeoPainter *painter, bool doSelected, bool parentSelected);
-    const TrackDataAbstractPoint *findClickedPoint(const TrackDataItem *item);
+    bool isInView(const TrackDataItem *item) const;
+    const TrackDataAbstractPoint *findClickedPoint(const FilesModel *model) const;
     bool testClickTolerance(const QMouseEvent *mev) const;
     virtual void findSelectionInTree(const TrackDataItem *item);
 
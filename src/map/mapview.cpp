@@ -42,6 +42,7 @@
 #include <marble/AbstractFloatItem.h>
 
 #include "trackdata.h"
+#include "dataindexer.h"
 #include "mapcontroller.h"
 #include "settings.h"
 #include "trackslayer.h"
@@ -286,7 +287,7 @@ void MapView::slotShowLayer()
 }
 
 
-static QColor resolveColour(const TrackDataItem *item, const char *key, const QColor &appDefault)
+static QColor resolveColour(const TrackDataItem *item, int idx, const QColor &appDefault)
 {
     // Resolving a colour is not a trivial operation - needing to examine not only
     // the metadata of the item, but also all of its parents, up to the top level file,
@@ -298,7 +299,7 @@ static QColor resolveColour(const TrackDataItem *item, const char *key, const QC
 
     while (item!=nullptr)				// search to root of tree
     {
-        const QVariant v = item->metadata(key);		// metadata from this item
+        const QVariant v = item->metadata(idx);		// metadata from this item
         if (!v.isNull()) return (v.value<QColor>());	// colour value from that
         item = item->parent();				// up to parent item
     }
@@ -309,7 +310,7 @@ static QColor resolveColour(const TrackDataItem *item, const char *key, const QC
 
 QColor MapView::resolveLineColour(const TrackDataItem *tdi)
 {
-    return (resolveColour(tdi, "linecolor", Settings::lineColour()));
+    return (resolveColour(tdi, DataIndexer::IndexLinecolor, Settings::lineColour()));
 }
 
 
@@ -319,9 +320,9 @@ QColor MapView::resolvePointColour(const TrackDataItem *tdi)
     // then it will be used, otherwise waypoints will use the default icon
     // and other sorts of points will use the application setting.
 
-    //return (resolveColour(tdi, "pointcolour", Settings::pointColour()));
+    //return (resolveColour(tdi, DataIndexer::IndexPointcolor, Settings::pointColour()));
 
-    const QVariant v = tdi->metadata("pointcolor");	// metadata from this item
+    const QVariant v = tdi->metadata(DataIndexer::IndexPointcolor);	// metadata from this item
     if (!v.isNull()) return (v.value<QColor>());	// colour value from that
     return (QColor());					// no colour set
 }
@@ -80,7 +80,7 @@ RoutesLayer::~RoutesLayer()
 bool RoutesLayer::isApplicableItem(const TrackDataItem *item) const
 {
     // We are only interested in routepoints
-    return (dynamic_cast<const TrackDataRoutepoint *>(item)!=nullptr);
+    return (TrackData::cast<TrackDataRoutepoint>(item)!=nullptr);
 }
 
 
@@ -88,7 +88,7 @@ bool RoutesLayer::isApplicableItem(const TrackDataItem *item) const
 bool RoutesLayer::isDirectContainer(const TrackDataItem *item) const
 {
     // Only routes contain routepoints to be drawn
-    return (dynamic_cast<const TrackDataRoute *>(item)!=nullptr);
+    return (TrackData::cast<TrackDataRoute>(item)!=nullptr);
 }
 
 
@@ -96,8 +96,8 @@ bool RoutesLayer::isDirectContainer(const TrackDataItem *item) const
 bool RoutesLayer::isIndirectContainer(const TrackDataItem *item) const
 {
     // Files or routes can include routepoints
-    return (dynamic_cast<const TrackDataFile *>(item)!=nullptr ||
-            dynamic_cast<const TrackDataRoute *>(item)!=nullptr);
+    return (TrackData::cast<TrackDataFile>(item)!=nullptr ||
+            TrackData::cast<TrackDataRoute>(item)!=nullptr);
 }
 
 
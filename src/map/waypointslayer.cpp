@@ -88,7 +88,7 @@ WaypointsLayer::~WaypointsLayer()
 bool WaypointsLayer::isApplicableItem(const TrackDataItem *item) const
 {
     // We are only interested in waypoints
-    return (dynamic_cast<const TrackDataWaypoint *>(item)!=nullptr);
+    return (TrackData::cast<TrackDataWaypoint>(item)!=nullptr);
 }
 
 
@@ -96,7 +96,7 @@ bool WaypointsLayer::isApplicableItem(const TrackDataItem *item) const
 bool WaypointsLayer::isDirectContainer(const TrackDataItem *item) const
 {
     // Only folders contain waypoints to be drawn
-    return (dynamic_cast<const TrackDataFolder *>(item)!=nullptr);
+    return (TrackData::cast<TrackDataFolder>(item)!=nullptr);
 }
 
 
@@ -104,8 +104,8 @@ bool WaypointsLayer::isDirectContainer(const TrackDataItem *item) const
 bool WaypointsLayer::isIndirectContainer(const TrackDataItem *item) const
 {
     // Files or folders can include waypoints
-    return (dynamic_cast<const TrackDataFile *>(item)!=nullptr ||
-            dynamic_cast<const TrackDataFolder *>(item)!=nullptr);
+    return (TrackData::cast<TrackDataFile>(item)!=nullptr ||
+            TrackData::cast<TrackDataFolder>(item)!=nullptr);
 }
 
 
@@ -119,7 +119,7 @@ void WaypointsLayer::doPaintItem(const TrackDataItem *item, GeoPainter *painter,
 
     for (int i = 0; i<cnt; ++i)
     {
-        const TrackDataWaypoint *tdw = dynamic_cast<const TrackDataWaypoint *>(item->childAt(i));
+        const TrackDataWaypoint *tdw = TrackData::cast<TrackDataWaypoint>(item->childAt(i));
         if (tdw==nullptr) continue;
 
 #ifdef DEBUG_PAINTING
@@ -156,7 +156,7 @@ void WaypointsLayer::doPaintItem(const TrackDataItem *item, GeoPainter *painter,
         painter->setBrush(QBrush());
 
         // First of all the bearing lines, if there are any
-        const QString brg = tdw->metadata("bearingline").toString();
+        const QString brg = tdw->metadata(DataIndexer::IndexBearingline).toString();
         if (!brg.isEmpty())
         {
             const QStringList brgs = brg.split(';', Qt::SkipEmptyParts);
@@ -177,7 +177,7 @@ void WaypointsLayer::doPaintItem(const TrackDataItem *item, GeoPainter *painter,
         }
 
         // The the range rings, if there are any
-        const QString rng = tdw->metadata("rangering").toString();
+        const QString rng = tdw->metadata(DataIndexer::IndexRangering).toString();
         if (!rng.isEmpty())
         {
             const QStringList rngs = rng.split(';', Qt::SkipEmptyParts);
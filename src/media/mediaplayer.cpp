@@ -47,6 +47,7 @@
 #include <kfdialog/recentsaver.h>
 
 #include "trackdata.h"
+#include "dataindexer.h"
 #include "settings.h"
 #include "videoviewer.h"
 #include "photoviewer.h"
@@ -61,8 +62,8 @@ static QUrl findMediaFile(const TrackDataWaypoint *item, TrackData::WaypointType
         return (QUrl());
     }
 
-    QVariant n = item->metadata("link");		// first try saved media name
-    if (n.isNull()) n = item->metadata("media");	// compatibility with old metadata
+    QVariant n = item->metadata(DataIndexer::IndexLink);	// first try saved media name
+    if (n.isNull()) n = item->metadata(DataIndexer::IndexMedia);	// compatibility with old metadata
     if (n.isNull()) n = item->name();			// then the waypoint name
     qDebug() << "item" << item->name() << "link" << n.toString();
 